@@ -0,0 +1,97 @@
+#include "MeshCodec.hpp"
+
+// STD
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Matches the check in MeshCodec.cpp
+#if defined(__SSSE3__) || defined(__AVX__)
+static constexpr const char* DECODER = "SSSE3";
+#else
+static constexpr const char* DECODER = "scalar";
+#endif
+
+// Same layout as Model::Vertex, position, color, normal and uv as floats
+static constexpr size_t VERTEX_FLOATS = 11;
+
+// A tessellated sphere in row order, neighbouring vertices are close like after MeshOptimizer's fetch reordering
+static std::vector<float> makeSphere(uint32_t p_rings, uint32_t p_segments) {
+	std::vector<float> vertices = {};
+	vertices.reserve(static_cast<size_t>(p_rings + 1) * (p_segments + 1) * VERTEX_FLOATS);
+
+	for(uint32_t ring = 0; ring <= p_rings; ring++) {
+		float theta = 3.14159265f * ring / p_rings;
+
+		for(uint32_t segment = 0; segment <= p_segments; segment++) {
+			float phi = 2.0f * 3.14159265f * segment / p_segments;
+			float normal[3] = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+
+			vertices.insert(vertices.end(), {normal[0], normal[1], normal[2], 1.0f, 1.0f, 1.0f, normal[0], normal[1], normal[2], static_cast<float>(segment) / p_segments, static_cast<float>(ring) / p_rings});
+		}
+	}
+
+	return vertices;
+}
+
+// Times MeshCodec::decodeVertices and decodeIndices on a generated mesh and prints their throughput
+// The MeshCodecBenchScalar target is the same benchmark built without SSSE3, run both to compare the decoders
+// Usage: MeshCodecBench [iterations]
+int main(int argc, char** argv) {
+	int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+
+	std::vector<float> vertices = makeSphere(512, 1024);
+	size_t vertexSize = VERTEX_FLOATS * sizeof(float);
+	size_t vertexCount = vertices.size() / VERTEX_FLOATS;
+
+	std::vector<uint32_t> indices = {};
+	for(uint32_t ring = 0; ring < 512; ring++) {
+		for(uint32_t segment = 0; segment < 1024; segment++) {
+			uint32_t a = ring * 1025 + segment, b = a + 1025;
+			indices.insert(indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+		}
+	}
+
+	std::vector<uint8_t> encodedVertices = FFL::MeshCodec::encodeVertices(vertices.data(), vertexCount, vertexSize);
+	std::vector<uint8_t> encodedIndices = FFL::MeshCodec::encodeIndices(indices.data(), indices.size());
+
+	std::vector<float> decodedVertices(vertices.size());
+	std::vector<uint32_t> decodedIndices(indices.size());
+
+	auto startTime = std::chrono::steady_clock::now();
+	for(int i = 0; i < iterations; i++) {
+		if(!FFL::MeshCodec::decodeVertices(decodedVertices.data(), vertexCount, vertexSize, encodedVertices.data(), encodedVertices.size())) {
+			std::cerr << "Failed to decode vertices" << '\n';
+			return EXIT_FAILURE;
+		}
+	}
+	double vertexSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() / iterations;
+
+	startTime = std::chrono::steady_clock::now();
+	for(int i = 0; i < iterations; i++) {
+		if(!FFL::MeshCodec::decodeIndices(decodedIndices.data(), indices.size(), encodedIndices.data(), encodedIndices.size())) {
+			std::cerr << "Failed to decode indices" << '\n';
+			return EXIT_FAILURE;
+		}
+	}
+	double indexSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count() / iterations;
+
+	if(memcmp(decodedVertices.data(), vertices.data(), vertices.size() * sizeof(float)) != 0) {
+		std::cerr << "Vertices did not round-trip" << '\n';
+		return EXIT_FAILURE;
+	}
+
+	double vertexBytes = static_cast<double>(vertices.size() * sizeof(float));
+	double indexBytes = static_cast<double>(indices.size() * sizeof(uint32_t));
+
+	std::cout << DECODER << " decoder, " << iterations << " iterations" << '\n';
+	std::cout << "Vertices: " << vertexCount << " x " << vertexSize << " bytes, ratio " << vertexBytes / encodedVertices.size() << ", " << vertexBytes / vertexSeconds / 1e9 << " GB/s" << '\n';
+	std::cout << "Indices:  " << indices.size() << ", ratio " << indexBytes / encodedIndices.size() << ", " << indexBytes / indexSeconds / 1e9 << " GB/s" << '\n';
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,379 @@
+#include "Buffer.hpp"
+#include "Descriptors.hpp"
+#include "Device.hpp"
+#include "FrameInfo.hpp"
+#include "MemoryAllocator.hpp"
+#include "Model.hpp"
+#include "Pipeline.hpp"
+#include "PipelineVariantCache.hpp"
+#include "Systems/SimpleRenderSystem.hpp"
+#include "Window.hpp"
+
+// Libraries
+#define GLFW_INCLUDE_VULKAN
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+static constexpr uint32_t WIDTH = 1920;
+static constexpr uint32_t HEIGHT = 1080;
+static constexpr VkFormat COLOR_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+static constexpr int WARMUP_ITERATIONS = 5;
+static constexpr int ITERATIONS = 50;
+
+// Same layout as SimplePushConstantData in SimpleRenderSystem.cpp
+struct PushConstantData {
+	glm::mat4 modelMatrix{1.0f};
+	glm::mat4 normalMatrix{1.0f};
+};
+
+// Color target the size of a 1080p frame, rendered to instead of a swapchain image
+class OffscreenTarget {
+public:
+	OffscreenTarget(FFL::Device& p_device) : m_device{p_device} {
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = {WIDTH, HEIGHT, 1};
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = COLOR_FORMAT;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		m_device.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_image, m_imageMemory);
+
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = m_image;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+		viewInfo.format = COLOR_FORMAT;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.layerCount = 1;
+
+		if(vkCreateImageView(m_device.device(), &viewInfo, nullptr, &m_imageView) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create offscreen image view!");
+		}
+
+		VkAttachmentDescription colorAttachment = {};
+		colorAttachment.format = COLOR_FORMAT;
+		colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+		colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+		colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkAttachmentReference colorAttachmentRef = {};
+		colorAttachmentRef.attachment = 0;
+		colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		VkSubpassDescription subpass = {};
+		subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+		subpass.colorAttachmentCount = 1;
+		subpass.pColorAttachments = &colorAttachmentRef;
+
+		VkRenderPassCreateInfo renderPassInfo = {};
+		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+		renderPassInfo.attachmentCount = 1;
+		renderPassInfo.pAttachments = &colorAttachment;
+		renderPassInfo.subpassCount = 1;
+		renderPassInfo.pSubpasses = &subpass;
+
+		if(vkCreateRenderPass(m_device.device(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create offscreen render pass!");
+		}
+
+		VkFramebufferCreateInfo framebufferInfo = {};
+		framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+		framebufferInfo.renderPass = m_renderPass;
+		framebufferInfo.attachmentCount = 1;
+		framebufferInfo.pAttachments = &m_imageView;
+		framebufferInfo.width = WIDTH;
+		framebufferInfo.height = HEIGHT;
+		framebufferInfo.layers = 1;
+
+		if(vkCreateFramebuffer(m_device.device(), &framebufferInfo, nullptr, &m_framebuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create offscreen framebuffer!");
+		}
+	}
+
+	~OffscreenTarget() {
+		vkDestroyFramebuffer(m_device.device(), m_framebuffer, nullptr);
+		vkDestroyRenderPass(m_device.device(), m_renderPass, nullptr);
+		vkDestroyImageView(m_device.device(), m_imageView, nullptr);
+		vkDestroyImage(m_device.device(), m_image, nullptr);
+		m_device.memoryAllocator().free(m_imageMemory);
+	}
+
+	// Delete copy-constructors
+	OffscreenTarget(const OffscreenTarget&) = delete;
+	OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+	VkRenderPass getRenderPass() const {return m_renderPass;}
+	VkFramebuffer getFramebuffer() const {return m_framebuffer;}
+private:
+	FFL::Device& m_device;
+	VkImage m_image = VK_NULL_HANDLE;
+	FFL::MemoryAllocation m_imageMemory = {};
+	VkImageView m_imageView = VK_NULL_HANDLE;
+	VkRenderPass m_renderPass = VK_NULL_HANDLE;
+	VkFramebuffer m_framebuffer = VK_NULL_HANDLE;
+};
+
+// A quad filling the screen with an identity camera, facing it
+static std::unique_ptr<FFL::Model> createScreenQuad(FFL::Device& p_device) {
+	FFL::Model::Builder builder = {};
+	builder.vertices = {
+		{{-1.0f, -1.0f, 0.5f}, {0.8f, 0.8f, 0.8f}, {0.0f, 0.0f, -1.0f}, {0.0f, 0.0f}},
+		{{1.0f, -1.0f, 0.5f}, {0.8f, 0.8f, 0.8f}, {0.0f, 0.0f, -1.0f}, {1.0f, 0.0f}},
+		{{1.0f, 1.0f, 0.5f}, {0.8f, 0.8f, 0.8f}, {0.0f, 0.0f, -1.0f}, {1.0f, 1.0f}},
+		{{-1.0f, 1.0f, 0.5f}, {0.8f, 0.8f, 0.8f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f}}
+	};
+	builder.indices = {0, 1, 2, 2, 3, 0};
+
+	return std::make_unique<FFL::Model>(p_device, builder);
+}
+
+// Lights spread in front of the quad, the shader reads the first numLights
+static FFL::GlobalUniformBufferObject createUniforms(int p_lightCount) {
+	FFL::GlobalUniformBufferObject ubo = {};
+
+	for(int i = 0; i < MAX_LIGHTS; i++) {
+		float x = -0.9f + 1.8f * static_cast<float>(i) / (MAX_LIGHTS - 1);
+		ubo.pointLights[i].position = glm::vec4{x, (i % 2 == 0) ? -0.5f : 0.5f, 0.2f, 1.0f};
+		ubo.pointLights[i].color = glm::vec4{1.0f, 1.0f, 1.0f, 0.2f};
+	}
+
+	ubo.numLights = p_lightCount;
+
+	return ubo;
+}
+
+// Draws the quad p_layerCount times over the whole target with p_pipeline, returns the GPU time in milliseconds
+static double timeDraws(FFL::Device& p_device, const OffscreenTarget& p_target, FFL::Pipeline& p_pipeline, VkPipelineLayout p_pipelineLayout, VkDescriptorSet p_globalSet, FFL::Model& p_model, uint32_t p_layerCount, VkQueryPool p_queryPool) {
+	VkCommandBuffer commandBuffer = p_device.beginSingleTimeCommands();
+
+	vkCmdResetQueryPool(commandBuffer, p_queryPool, 0, 2);
+
+	VkClearValue clearValue = {};
+	clearValue.color = {{0.0f, 0.0f, 0.0f, 1.0f}};
+
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = p_target.getRenderPass();
+	renderPassInfo.framebuffer = p_target.getFramebuffer();
+	renderPassInfo.renderArea.extent = {WIDTH, HEIGHT};
+	renderPassInfo.clearValueCount = 1;
+	renderPassInfo.pClearValues = &clearValue;
+
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkViewport viewport = {0.0f, 0.0f, static_cast<float>(WIDTH), static_cast<float>(HEIGHT), 0.0f, 1.0f};
+	VkRect2D scissor = {{0, 0}, {WIDTH, HEIGHT}};
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+	p_pipeline.bind(commandBuffer);
+
+	uint32_t uniformOffset = 0;
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_pipelineLayout, 0, 1, &p_globalSet, 1, &uniformOffset);
+
+	PushConstantData push = {};
+	push.modelMatrix = p_model.getPositionTransform();
+	vkCmdPushConstants(commandBuffer, p_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstantData), &push);
+
+	p_model.bind(commandBuffer);
+
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, p_queryPool, 0);
+	for(uint32_t i = 0; i < p_layerCount; i++) {
+		p_model.draw(commandBuffer);
+	}
+	vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, p_queryPool, 1);
+
+	vkCmdEndRenderPass(commandBuffer);
+
+	p_device.endSingleTimeCommands(commandBuffer);
+
+	uint64_t timestamps[2] = {};
+	if(vkGetQueryPoolResults(p_device.device(), p_queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT) != VK_SUCCESS) {
+		throw std::runtime_error("failed to read timestamps!");
+	}
+
+	return static_cast<double>(timestamps[1] - timestamps[0]) * p_device.properties.limits.timestampPeriod / 1e6;
+}
+
+static int run(uint32_t p_layerCount) {
+	// The device needs a surface to pick a queue that can present, the window is never shown
+	glfwInit();
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+	FFL::Window window{WIDTH, HEIGHT, "PipelineVariantBench"};
+	FFL::Device device{window};
+
+	if(!device.properties.limits.timestampComputeAndGraphics) {
+		std::cerr << "The device has no graphics timestamps" << '\n';
+		return EXIT_FAILURE;
+	}
+
+	OffscreenTarget target{device};
+	std::unique_ptr<FFL::Model> quad = createScreenQuad(device);
+
+	std::unique_ptr<FFL::DescriptorPool> globalPool = FFL::DescriptorPool::Builder(device)
+		.setMaxSets(1)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
+		.build();
+
+	std::unique_ptr<FFL::DescriptorSetLayout> globalSetLayout = FFL::DescriptorSetLayout::Builder(device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS)
+		.build();
+
+	FFL::Buffer uniformBuffer{device, sizeof(FFL::GlobalUniformBufferObject), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, device.properties.limits.minUniformBufferOffsetAlignment};
+	uniformBuffer.map();
+
+	VkDescriptorSet globalSet = VK_NULL_HANDLE;
+	VkDescriptorBufferInfo bufferInfo = uniformBuffer.descriptorInfo(sizeof(FFL::GlobalUniformBufferObject));
+	FFL::DescriptorWriter(*globalSetLayout, *globalPool)
+		.writeBuffer(0, &bufferInfo)
+		.build(globalSet);
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	pushConstantRange.size = sizeof(PushConstantData);
+
+	VkDescriptorSetLayout setLayout = globalSetLayout->getDescriptorSetLayout();
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = 1;
+	pipelineLayoutInfo.pSetLayouts = &setLayout;
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	if(vkCreatePipelineLayout(device.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	// Every layer covers the whole target, without a depth test each one shades every pixel
+	FFL::PipelineConfigInfo pipelineConfig = {};
+	FFL::Pipeline::defaultPipelineConfigInfo(pipelineConfig);
+	pipelineConfig.renderPass = target.getRenderPass();
+	pipelineConfig.pipelineLayout = pipelineLayout;
+	pipelineConfig.depthStencilInfo.depthTestEnable = VK_FALSE;
+	pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+
+#ifdef FFL_QUANTIZED_VERTICES
+	const char* vertPath = "shaders/simple_shader_quantized.vert.spv";
+#else
+	const char* vertPath = "shaders/simple_shader.vert.spv";
+#endif
+
+	std::unique_ptr<FFL::PipelineVariantCache> variants = std::make_unique<FFL::PipelineVariantCache>(device, pipelineConfig, vertPath, "shaders/simple_shader.frag.spv", FFL::SimpleRenderSystem::configureVariant);
+
+	VkQueryPoolCreateInfo queryPoolInfo = {};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = 2;
+
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	if(vkCreateQueryPool(device.device(), &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create query pool!");
+	}
+
+	struct Variant {
+		const char* name;
+		uint64_t key;
+	};
+
+	uint64_t genericKey = FFL::SimpleRenderSystem::variantKey(MAX_LIGHTS, FFL::SimpleRenderSystem::ALL_FEATURES);
+
+	std::cout << WIDTH << "x" << HEIGHT << ", " << p_layerCount << " layers, median of " << ITERATIONS << " frames" << '\n';
+	std::cout << std::fixed << std::setprecision(3);
+
+	for(int lightCount : {1, 2, 4, 8, MAX_LIGHTS}) {
+		FFL::GlobalUniformBufferObject ubo = createUniforms(lightCount);
+		uniformBuffer.write(&ubo, sizeof(ubo), 0);
+		uniformBuffer.flushDirty();
+
+		std::vector<Variant> variantList = {
+			{"generic", genericKey},
+			{"specialized", FFL::SimpleRenderSystem::variantKey(lightCount, FFL::SimpleRenderSystem::ALL_FEATURES)},
+			{"specialized, no specular", FFL::SimpleRenderSystem::variantKey(lightCount, 0)}
+		};
+
+		double genericTime = 0.0;
+
+		for(const Variant& variant : variantList) {
+			FFL::Pipeline& pipeline = variants->get(variant.key);
+
+			for(int i = 0; i < WARMUP_ITERATIONS; i++) {
+				timeDraws(device, target, pipeline, pipelineLayout, globalSet, *quad, p_layerCount, queryPool);
+			}
+
+			std::vector<double> times = {};
+			for(int i = 0; i < ITERATIONS; i++) {
+				times.push_back(timeDraws(device, target, pipeline, pipelineLayout, globalSet, *quad, p_layerCount, queryPool));
+			}
+
+			std::nth_element(times.begin(), times.begin() + times.size() / 2, times.end());
+			double median = times[times.size() / 2];
+
+			if(variant.key == genericKey) {
+				genericTime = median;
+			}
+
+			std::cout << lightCount << " lights, " << variant.name << ": " << median << " ms";
+			if(variant.key != genericKey && median > 0.0) {
+				std::cout << " (" << genericTime / median << "x generic)";
+			}
+			std::cout << '\n';
+		}
+	}
+
+	vkDeviceWaitIdle(device.device());
+
+	vkDestroyQueryPool(device.device(), queryPool, nullptr);
+	variants = nullptr;
+	vkDestroyPipelineLayout(device.device(), pipelineLayout, nullptr);
+
+	return EXIT_SUCCESS;
+}
+
+// Times simple_shader.frag's generic variant against the specialized ones SimpleRenderSystem picks, for a range
+// of light counts, drawing full-screen layers into an offscreen target and reading GPU timestamps
+// Usage: PipelineVariantBench [layers]
+int main(int argc, char** argv) {
+	uint32_t layerCount = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 16;
+
+	if(layerCount == 0) {
+		std::cerr << "Usage: " << argv[0] << " [layers]" << '\n';
+		return EXIT_FAILURE;
+	}
+
+	try {
+		return run(layerCount);
+	} catch(const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return EXIT_FAILURE;
+	}
+}
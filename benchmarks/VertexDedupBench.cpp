@@ -0,0 +1,125 @@
+#include "IndexHashTable.hpp"
+#include "Model.hpp"
+#include "Utils.hpp"
+
+// Libraries
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+// STD
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// The hash Model::Builder::loadObj used with std::unordered_map before IndexHashTable
+struct MapVertexHash {
+	size_t operator()(const FFL::Model::Vertex& p_vertex) const {
+		size_t seed = 0;
+
+		FFL::hashCombine(seed, p_vertex.position, p_vertex.color, p_vertex.normal, p_vertex.uv);
+
+		return seed;
+	}
+};
+
+struct TableVertexHash {
+	uint64_t operator()(const FFL::Model::Vertex& p_vertex) const {
+		return p_vertex.hash();
+	}
+};
+
+struct TableVertexEqual {
+	bool operator()(const FFL::Model::Vertex& p_a, const FFL::Model::Vertex& p_b) const {
+		return p_a == p_b;
+	}
+};
+
+template<typename F>
+static double timeMilliseconds(F&& p_function) {
+	auto startTime = std::chrono::steady_clock::now();
+	p_function();
+
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+// Deduplicates the same stream of corners with IndexHashTable and with the std::unordered_map path it replaced,
+// checks that both produce the same index buffer and prints their timings
+// Usage: VertexDedupBench [unique vertices] [corners]
+int main(int argc, char** argv) {
+	size_t uniqueCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 500000;
+	size_t cornerCount = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 3000000;
+
+	if(uniqueCount == 0) {
+		std::cerr << "Usage: " << argv[0] << " [unique vertices] [corners]" << '\n';
+		return EXIT_FAILURE;
+	}
+
+	std::mt19937 random{1234};
+	std::uniform_real_distribution<float> value{-1.0f, 1.0f};
+
+	std::vector<FFL::Model::Vertex> unique(uniqueCount);
+	for(FFL::Model::Vertex& vertex : unique) {
+		vertex.position = {value(random), value(random), value(random)};
+		vertex.color = {1.0f, 1.0f, 1.0f};
+		vertex.normal = {value(random), value(random), value(random)};
+		vertex.uv = {value(random), value(random)};
+	}
+
+	// Neighbouring corners mostly share vertices, like triangles of a mesh do
+	std::vector<FFL::Model::Vertex> corners(cornerCount);
+	std::uniform_int_distribution<size_t> jitter{0, 15};
+	for(size_t i = 0; i < cornerCount; i++) {
+		corners[i] = unique[(i / 6 + jitter(random)) % uniqueCount];
+	}
+
+	std::vector<uint32_t> tableIndices = {};
+	std::vector<uint32_t> mapIndices = {};
+
+	double tableTime = timeMilliseconds([&]() {
+		std::vector<FFL::Model::Vertex> vertices = {};
+		FFL::IndexHashTable<FFL::Model::Vertex, TableVertexHash, TableVertexEqual> table = {};
+		table.reserve(cornerCount);
+		tableIndices.reserve(cornerCount);
+
+		for(const FFL::Model::Vertex& vertex : corners) {
+			uint32_t newIndex = static_cast<uint32_t>(vertices.size());
+			uint32_t index = table.findOrInsert(vertex, vertices.data(), newIndex);
+
+			if(index == newIndex) {
+				vertices.push_back(vertex);
+			}
+
+			tableIndices.push_back(index);
+		}
+	});
+
+	double mapTime = timeMilliseconds([&]() {
+		std::vector<FFL::Model::Vertex> vertices = {};
+		std::unordered_map<FFL::Model::Vertex, uint32_t, MapVertexHash> map = {};
+		mapIndices.reserve(cornerCount);
+
+		for(const FFL::Model::Vertex& vertex : corners) {
+			if(map.count(vertex) == 0) {
+				map[vertex] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(vertex);
+			}
+
+			mapIndices.push_back(map[vertex]);
+		}
+	});
+
+	std::cout << cornerCount << " corners, " << uniqueCount << " unique vertices" << '\n';
+	std::cout << "IndexHashTable:     " << tableTime << " ms" << '\n';
+	std::cout << "std::unordered_map: " << mapTime << " ms" << '\n';
+
+	if(tableIndices != mapIndices) {
+		std::cerr << "Index buffers differ" << '\n';
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -4,6 +4,7 @@
 #include "Descriptors.hpp"
 #include "Device.hpp"
 #include "GameObject.hpp"
+#include "ModelRegistry.hpp"
 #include "Renderer.hpp"
 #include "Window.hpp"
 
@@ -30,6 +31,7 @@ private:
 	Window m_window{SCREEN_WIDTH, SCREEN_HEIGHT, "Vulkan_C++"};
 	Device m_device{m_window};
 	Renderer m_renderer{m_window, m_device};
+	ModelRegistry m_modelRegistry{m_device};
 
 	// NOTE: Order of declarations matters
 	std::unique_ptr<DescriptorPool> m_globalPool = {};
@@ -2,12 +2,15 @@
 #define BUFFER_HPP
 
 #include "Device.hpp"
+#include "FrameArena.hpp"
+#include "MemoryAllocator.hpp"
 
 // Libraries
 #include <vulkan/vulkan_core.h>
 
 // STD
 #include <cstdint>
+#include <vector>
 
 namespace FFL {
 
@@ -28,13 +31,27 @@ public:
 	VkDeviceSize getBufferSize() const {return m_bufferSize;}
 	VkMemoryPropertyFlags getMemoryPropertyFlags() const {return m_memoryPropertyFlags;}
 	VkDeviceSize getAlignmentSize() const {return m_alignmentSize;}
+	const MemoryAllocation& getAllocation() const {return m_allocation;}
 
+	// Host visible memory stays mapped by the allocator, map() only hands out the pointer
 	VkResult map(VkDeviceSize p_size = VK_WHOLE_SIZE, VkDeviceSize p_offset = 0);
 	void unmap();
 
 	void writeToBuffer(void* p_data, VkDeviceSize p_size = VK_WHOLE_SIZE, VkDeviceSize p_offset = 0);
+	// Copies only p_size bytes and records them as dirty for flushDirty()
+	void write(const void* p_data, VkDeviceSize p_size, VkDeviceSize p_offset);
+	// For writes made through getMappedMemory()
+	void markDirty(VkDeviceSize p_size, VkDeviceSize p_offset);
+	bool isDirty() const {return !m_dirtyRanges.empty();}
+	// Flushes every dirty range in one call, a no-op on coherent memory
+	VkResult flushDirty();
+	// Same for several buffers, still in one call
+	static VkResult flushDirty(Device& p_device, const std::vector<Buffer*>& p_buffers);
+
+	// Rounds out to whole atoms and drops the dirty ranges it covers
 	VkResult flush(VkDeviceSize p_size = VK_WHOLE_SIZE, VkDeviceSize p_offset = 0);
 	VkDescriptorBufferInfo descriptorInfo(VkDeviceSize p_size = VK_WHOLE_SIZE, VkDeviceSize p_offset = 0);
+	// Also rounds out to whole atoms, unflushed writes next to the range are discarded with it
 	VkResult invalidate(VkDeviceSize p_size = VK_WHOLE_SIZE, VkDeviceSize p_offset = 0);
 
 	void writeToIndex(void* p_data, int p_index);
@@ -42,9 +59,15 @@ public:
 	VkDescriptorBufferInfo descriptorInfoForIndex(int p_index);
 	VkResult invalidateIndex(int p_index);
 private:
+	// Byte range relative to the start of the buffer, rounded out to nonCoherentAtomSize
+	struct DirtyRange {
+		VkDeviceSize begin = 0;
+		VkDeviceSize end = 0;
+	};
+
 	void* m_mapped = nullptr;
 	VkBuffer m_buffer = VK_NULL_HANDLE;
-	VkDeviceMemory m_memory = VK_NULL_HANDLE;
+	MemoryAllocation m_allocation = {};
 
 	Device& m_device;
 	VkDeviceSize m_instanceSize;
@@ -54,6 +77,14 @@ private:
 	VkMemoryPropertyFlags m_memoryPropertyFlags;
 	VkDeviceSize m_alignmentSize;
 
+	// Sorted and disjoint, touching ranges are merged
+	std::vector<DirtyRange> m_dirtyRanges = {};
+
+	DirtyRange atomRange(VkDeviceSize p_size, VkDeviceSize p_offset) const;
+	void clearDirty(const DirtyRange& p_range);
+	void appendDirtyRanges(FrameVector<VkMappedMemoryRange>& p_ranges) const;
+	VkMappedMemoryRange mappedRange(VkDeviceSize p_size, VkDeviceSize p_offset) const;
+
 	static VkDeviceSize getAlignment(VkDeviceSize p_instanceSize, VkDeviceSize p_minOffsetAlignment);
 };
 
@@ -2,6 +2,7 @@
 #define DESCRIPTORS_HPP
 
 #include "Device.hpp"
+#include "FrameArena.hpp"
 
 // Libraries
 #include <vulkan/vulkan_core.h>
@@ -79,6 +80,7 @@ private:
 	friend class DescriptorWriter;
 };
 
+// Short-lived, its writes come from the frame arena
 class DescriptorWriter {
 public:
 	DescriptorWriter(DescriptorSetLayout& p_setLayout, DescriptorPool& p_pool);
@@ -91,7 +93,7 @@ public:
 private:
 	DescriptorSetLayout& m_setLayout;
 	DescriptorPool& m_pool;
-	std::vector<VkWriteDescriptorSet> m_writes;
+	FrameVector<VkWriteDescriptorSet> m_writes;
 };
 
 } // FFL
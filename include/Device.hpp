@@ -1,14 +1,23 @@
 #ifndef DEVICE_HPP
 #define DEVICE_HPP
 
+#include "MemoryAllocator.hpp"
 #include "Window.hpp"
 
 // STD
+#include <memory>
 #include <optional>
 #include <vector>
 
 namespace FFL {
 
+class MeshPool;
+class PipelineBuildService;
+class PipelineCache;
+class ShaderLibrary;
+class ShaderReloader;
+class UploadBatcher;
+
 struct SwapChainSupportDetails {
 	VkSurfaceCapabilitiesKHR capabilities;
 	std::vector<VkSurfaceFormatKHR> formats;
@@ -47,17 +56,42 @@ public:
 	VkQueue graphicsQueue() {return m_graphicsQueue;}
 	VkQueue presentQueue() {return m_presentQueue;}
 	VkCommandPool getCommandPool() {return m_commandPool;}
+	VkPhysicalDevice physicalDevice() {return m_physicalDevice;}
 	QueueFamilyIndices findPhysicalQueueFamilies() {return findQueueFamilies(m_physicalDevice);}
 	SwapChainSupportDetails getSwapChainSupport() {return querySwapChainSupport(m_physicalDevice);}
+	bool supportsMultiDrawIndirect() const {return m_multiDrawIndirect;}
+	// VK_EXT_memory_budget, optional
+	bool supportsMemoryBudget() const {return m_memoryBudget;}
+	// Integrated and software devices whose device-local memory the host can write directly, without staging
+	bool hasUnifiedMemory() const {return m_unifiedMemory;}
+	// VK_KHR_maintenance5, optional, pipelines take SPIR-V directly and no shader modules are created
+	bool supportsInlineShaders() const {return m_inlineShaders;}
+	// VK_EXT_graphics_pipeline_library with fast linking, optional
+	bool supportsPipelineLibraries() const {return m_pipelineLibraries;}
+	// Current per-heap budget and usage of the whole process, only valid when supportsMemoryBudget()
+	void getMemoryBudget(VkPhysicalDeviceMemoryBudgetPropertiesEXT& p_budget);
+	UploadBatcher& uploadBatcher() {return *m_uploadBatcher;}
+	MeshPool& meshPool() {return *m_meshPool;}
+	MemoryAllocator& memoryAllocator() {return *m_memoryAllocator;}
+	// Shared by every pipeline creation, persisted to disk on destruction
+	PipelineCache& pipelineCache() {return *m_pipelineCache;}
+	ShaderLibrary& shaderLibrary() {return *m_shaderLibrary;}
+	ShaderReloader& shaderReloader() {return *m_shaderReloader;}
+	PipelineBuildService& pipelineBuilds() {return *m_pipelineBuilds;}
 
 	uint32_t findMemoryType(uint32_t p_typeFilter, VkMemoryPropertyFlags p_properties);
 	VkFormat findSupportedFormat(const std::vector<VkFormat>& p_candidates, VkImageTiling p_tiling, VkFormatFeatureFlags p_features);
-	void createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer& p_buffer, VkDeviceMemory& p_bufferMemory);
+	// Memory comes from memoryAllocator(), release it there after destroying the buffer or image
+	void createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer& p_buffer, MemoryAllocation& p_allocation);
 	VkCommandBuffer beginSingleTimeCommands();
 	void endSingleTimeCommands(VkCommandBuffer p_commandBuffer);
+	// Submits without waiting, poll the returned fence and then hand both back to releaseSingleTimeCommands
+	VkFence submitSingleTimeCommands(VkCommandBuffer p_commandBuffer);
+	void releaseSingleTimeCommands(VkCommandBuffer p_commandBuffer, VkFence p_fence);
+	// Synchronous, record into uploadBatcher() instead to batch many copies behind one fence
 	void copyBuffer(VkBuffer p_src, VkBuffer p_dst, VkDeviceSize p_size);
 	void copyBufferToImage(VkBuffer p_buffer, VkImage p_image, uint32_t p_w, uint32_t p_h, uint32_t p_layerCount);
-	void createImageWithInfo(const VkImageCreateInfo& p_imageInfo, VkMemoryPropertyFlags p_properties, VkImage& p_image, VkDeviceMemory& p_imageMemory);
+	void createImageWithInfo(const VkImageCreateInfo& p_imageInfo, VkMemoryPropertyFlags p_properties, VkImage& p_image, MemoryAllocation& p_allocation);
 private:
 	const std::vector<const char*> m_validationLayers = {"VK_LAYER_KHRONOS_validation"};
 	const std::vector<const char*> m_deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
@@ -70,12 +104,28 @@ private:
 
 	VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
 	VkDevice m_device;
+	bool m_multiDrawIndirect = false;
+	bool m_memoryBudget = false;
+	bool m_unifiedMemory = false;
+	bool m_inlineShaders = false;
+	bool m_pipelineLibraries = false;
+	uint32_t m_apiVersion = VK_API_VERSION_1_0;
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR m_getMemoryProperties2 = nullptr;
 
 	VkQueue m_graphicsQueue;
 	VkQueue m_presentQueue;
 
 	VkCommandPool m_commandPool;
 
+	// NOTE: Destroyed last, everything below allocates from it
+	std::unique_ptr<MemoryAllocator> m_memoryAllocator;
+	std::unique_ptr<UploadBatcher> m_uploadBatcher;
+	std::unique_ptr<MeshPool> m_meshPool;
+	std::unique_ptr<PipelineCache> m_pipelineCache;
+	std::unique_ptr<ShaderLibrary> m_shaderLibrary;
+	std::unique_ptr<ShaderReloader> m_shaderReloader;
+	std::unique_ptr<PipelineBuildService> m_pipelineBuilds;
+
 	void createInstance();
 	void setupDebugMessenger();
 	void createSurface();
@@ -90,6 +140,8 @@ private:
 	bool isDeviceSuitable(VkPhysicalDevice p_device);
 	QueueFamilyIndices findQueueFamilies(VkPhysicalDevice p_device);
 	bool checkDeviceExtensionSupport(VkPhysicalDevice p_device);
+	bool isDeviceExtensionSupported(VkPhysicalDevice p_device, const char* p_extension);
+	bool isInstanceExtensionSupported(const char* p_extension);
 	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice p_device);
 };
 
@@ -0,0 +1,100 @@
+#ifndef FRAMEARENA_HPP
+#define FRAMEARENA_HPP
+
+// STD
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace FFL {
+
+// Bump allocator for CPU memory that only lives until the end of a frame, every thread allocates from chunks of its
+// own so allocating never locks
+// Renderer::beginFrame resets it, nothing allocated from it may be used past that
+class FrameArena {
+public:
+	static constexpr size_t DEFAULT_CHUNK_SIZE = 256 * 1024;
+
+	struct Stats {
+		size_t frameBytes = 0; // Allocated by all threads during the last finished frame
+		size_t highWaterBytes = 0; // Largest frameBytes so far
+		size_t threadHighWaterBytes = 0; // Largest amount a single thread allocated in one frame
+		size_t reservedBytes = 0; // Chunk memory held by all threads
+		uint32_t threadCount = 0;
+	};
+
+	// Delete copy-constructors
+	FrameArena(const FrameArena&) = delete;
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	static FrameArena& shared();
+
+	void* allocate(size_t p_size, size_t p_alignment = alignof(std::max_align_t));
+	// Only gives the memory back when it was the calling thread's latest allocation, so growing containers reuse it
+	void deallocate(void* p_pointer, size_t p_size);
+
+	// Workers may still hold memory of the old frame until they next allocate, they must not use it any more
+	void reset();
+
+	Stats getStats();
+private:
+	struct ThreadState {
+		std::vector<std::unique_ptr<char[]>> chunks = {};
+		std::vector<size_t> chunkSizes = {};
+		size_t chunk = 0; // Chunk allocations currently come from
+		char* head = nullptr;
+		char* end = nullptr;
+
+		// Read by getStats() and reset() from other threads
+		std::atomic<uint64_t> frame = 0; // Frame usedBytes belongs to
+		std::atomic<size_t> usedBytes = 0;
+		std::atomic<size_t> highWaterBytes = 0;
+		std::atomic<size_t> reservedBytes = 0;
+
+		bool owned = false; // By a running thread, states of finished threads are handed to new ones
+	};
+
+	std::mutex m_mutex;
+	std::vector<std::unique_ptr<ThreadState>> m_threads = {};
+	std::atomic<uint64_t> m_frame = 0;
+	size_t m_frameBytes = 0;
+	size_t m_highWaterBytes = 0;
+
+	FrameArena() = default;
+
+	friend struct ThreadRegistration;
+
+	ThreadState& threadState();
+	void releaseThreadState(ThreadState* p_state);
+	void beginThreadFrame(ThreadState& p_state, uint64_t p_frame);
+	void addChunk(ThreadState& p_state, size_t p_minSize);
+};
+
+// Lets standard containers allocate from FrameArena::shared(), deallocation is mostly a no-op
+template<typename T>
+class FrameAllocator {
+public:
+	using value_type = T;
+
+	FrameAllocator() = default;
+	template<typename U>
+	FrameAllocator(const FrameAllocator<U>&) {}
+
+	T* allocate(size_t p_count) {return static_cast<T*>(FrameArena::shared().allocate(p_count * sizeof(T), alignof(T)));}
+	void deallocate(T* p_pointer, size_t p_count) {FrameArena::shared().deallocate(p_pointer, p_count * sizeof(T));}
+
+	template<typename U>
+	bool operator==(const FrameAllocator<U>&) const {return true;}
+	template<typename U>
+	bool operator!=(const FrameAllocator<U>&) const {return false;}
+};
+
+template<typename T>
+using FrameVector = std::vector<T, FrameAllocator<T>>;
+
+} // FFL
+
+#endif // FRAMEARENA_HPP
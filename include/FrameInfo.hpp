@@ -2,6 +2,7 @@
 #define FRAMEINFO_HPP
 
 #include "Camera.hpp"
+#include "FrameRing.hpp"
 #include "GameObject.hpp"
 
 // Libraries
@@ -31,7 +32,10 @@ struct FrameInfo {
 	VkCommandBuffer commandBuffer;
 	Camera& camera;
 	VkDescriptorSet globalDescriptorSet;
+	uint32_t globalUniformOffset; // Dynamic offset of this frame's GlobalUniformBufferObject
 	GameObject::Map& gameObjects;
+	FrameRing& frameRing;
+	int numLights = 0; // Set once PointLightSystem::update has filled the uniform buffer
 };
 
 } // FFL
@@ -0,0 +1,77 @@
+#ifndef FRAMERING_HPP
+#define FRAMERING_HPP
+
+#include "Buffer.hpp"
+#include "Device.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace FFL {
+
+// Linear allocator for data that lives for one frame (uniforms, instance data, indirect arguments), bump-allocated
+// out of one persistently mapped buffer with a region per frame in flight
+// Bind slices through *_DYNAMIC descriptors written with descriptorInfo() and pass their offset when binding
+class FrameRing {
+public:
+	static constexpr VkDeviceSize DEFAULT_FRAME_CAPACITY = 4 * 1024 * 1024;
+
+	struct Slice {
+		void* data = nullptr;
+		VkDeviceSize offset = 0; // From the start of getBuffer()
+		VkDeviceSize size = 0;
+
+		uint32_t dynamicOffset() const {return static_cast<uint32_t>(offset);}
+	};
+
+	FrameRing(Device& p_device, VkDeviceSize p_frameCapacity = DEFAULT_FRAME_CAPACITY);
+
+	// Delete copy-constructors
+	FrameRing(const FrameRing&) = delete;
+	FrameRing& operator=(const FrameRing&) = delete;
+
+	// Call after Renderer::beginFrame, which waited for the fence of the frame that last used p_frameIndex's region
+	void beginFrame(int p_frameIndex);
+
+	// Throws when the frame's region is full, p_alignment must be a power of two
+	Slice allocate(VkDeviceSize p_size, VkDeviceSize p_alignment);
+	Slice allocateUniform(VkDeviceSize p_size) {return allocate(p_size, m_uniformAlignment);}
+	Slice allocateStorage(VkDeviceSize p_size) {return allocate(p_size, m_storageAlignment);}
+	Slice allocateIndirect(VkDeviceSize p_size) {return allocate(p_size, sizeof(uint32_t));}
+
+	template<typename T>
+	Slice writeUniform(const T& p_value) {
+		Slice slice = allocateUniform(sizeof(T));
+		memcpy(slice.data, &p_value, sizeof(T));
+
+		return slice;
+	}
+
+	VkBuffer getBuffer() const {return m_buffer->getBuffer();}
+	// p_range is the size the shader sees at each dynamic offset
+	VkDescriptorBufferInfo descriptorInfo(VkDeviceSize p_range) const {return {m_buffer->getBuffer(), 0, p_range};}
+
+	VkDeviceSize getFrameCapacity() const {return m_frameCapacity;}
+	// Bytes the current frame has allocated so far
+	VkDeviceSize getFrameUsage() const {return m_head - m_frameStart;}
+private:
+	Device& m_device;
+	VkDeviceSize m_frameCapacity;
+	VkDeviceSize m_uniformAlignment;
+	VkDeviceSize m_storageAlignment;
+
+	std::unique_ptr<Buffer> m_buffer;
+	char* m_mapped = nullptr;
+
+	VkDeviceSize m_frameStart = 0;
+	VkDeviceSize m_head = 0;
+};
+
+} // FFL
+
+#endif // FRAMERING_HPP
@@ -0,0 +1,95 @@
+#ifndef INDEXHASHTABLE_HPP
+#define INDEXHASHTABLE_HPP
+
+// STD
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FFL {
+
+// Open-addressing hash set over the elements of an external array, storing only 32-bit indices
+// Each slot also keeps the upper hash bits, so probes rarely touch the array itself and a lookup that misses
+// can insert in the same pass. Hash must return uint64_t, Equal compares two elements
+template<typename T, typename Hash, typename Equal>
+class IndexHashTable {
+public:
+	static constexpr uint32_t EMPTY = UINT32_MAX;
+
+	// Sizes the table so p_count elements fit under the load factor without growing, call before inserting
+	void reserve(size_t p_count) {
+		assert(m_size == 0 && "Cannot reserve a table that already holds elements");
+
+		size_t capacity = 16;
+		while(capacity < p_count + p_count / 2) {
+			capacity *= 2;
+		}
+
+		if(capacity > m_slots.size()) {
+			rehash(capacity, nullptr);
+		}
+	}
+
+	// Returns the index of an element equal to p_value, or inserts p_newIndex for it and returns p_newIndex
+	// p_elements must already hold every index previously inserted
+	uint32_t findOrInsert(const T& p_value, const T* p_elements, uint32_t p_newIndex) {
+		if((m_size + 1) * 3 > m_slots.size() * 2) {
+			rehash(m_slots.empty() ? 16 : m_slots.size() * 2, p_elements);
+		}
+
+		uint64_t hash = Hash{}(p_value);
+		uint32_t tag = static_cast<uint32_t>(hash >> 32);
+		size_t mask = m_slots.size() - 1;
+
+		for(size_t slot = static_cast<size_t>(hash) & mask;; slot = (slot + 1) & mask) {
+			Slot& entry = m_slots[slot];
+
+			if(entry.index == EMPTY) {
+				entry.index = p_newIndex;
+				entry.tag = tag;
+				m_size++;
+				return p_newIndex;
+			}
+
+			if(entry.tag == tag && Equal{}(p_elements[entry.index], p_value)) {
+				return entry.index;
+			}
+		}
+	}
+
+	size_t size() const {return m_size;}
+private:
+	struct Slot {
+		uint32_t index = EMPTY;
+		uint32_t tag = 0;
+	};
+
+	std::vector<Slot> m_slots = {};
+	size_t m_size = 0;
+
+	void rehash(size_t p_capacity, const T* p_elements) {
+		std::vector<Slot> old(p_capacity);
+		old.swap(m_slots);
+
+		size_t mask = m_slots.size() - 1;
+		for(const Slot& entry : old) {
+			if(entry.index == EMPTY) {
+				continue;
+			}
+
+			uint64_t hash = Hash{}(p_elements[entry.index]);
+
+			size_t slot = static_cast<size_t>(hash) & mask;
+			while(m_slots[slot].index != EMPTY) {
+				slot = (slot + 1) & mask;
+			}
+
+			m_slots[slot] = entry;
+		}
+	}
+};
+
+} // FFL
+
+#endif // INDEXHASHTABLE_HPP
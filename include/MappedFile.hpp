@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace FFL {
+
+// Read-only memory mapping of a whole file, pages are faulted in on first access
+class MappedFile {
+public:
+	MappedFile(const std::string& p_filePath);
+	~MappedFile();
+
+	// Delete copy-constructors
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const uint8_t* data() const {return m_data;}
+	size_t size() const {return m_size;}
+private:
+	const uint8_t* m_data = nullptr;
+	size_t m_size = 0;
+
+#ifdef _WIN32
+	void* m_file = nullptr;
+	void* m_mapping = nullptr;
+#else
+	int m_fileDescriptor = -1;
+#endif
+};
+
+} // FFL
+
+#endif // MAPPEDFILE_HPP
@@ -0,0 +1,144 @@
+#ifndef MEMORYALLOCATOR_HPP
+#define MEMORYALLOCATOR_HPP
+
+#include "RangeAllocator.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace FFL {
+
+class Device;
+
+// Range of device memory handed out by MemoryAllocator, bind resources at memory + offset
+struct MemoryAllocation {
+	static constexpr uint32_t DEDICATED = UINT32_MAX;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	uint32_t pool = 0;
+	uint32_t block = DEDICATED;
+	void* mapped = nullptr; // Start of the allocation in the persistent mapping, null unless host visible
+	bool coherent = false; // Host writes need no flush, the memory type may be coherent without being asked to
+};
+
+// Sub-allocates resources out of large VkDeviceMemory blocks, one set of blocks per memory type
+// Buffers and optimal-tiling images never share a block, which keeps them bufferImageGranularity apart without
+// padding every allocation. Host visible blocks stay mapped for their whole lifetime, since a VkDeviceMemory can
+// only be mapped once
+class MemoryAllocator {
+public:
+	static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+	struct Stats {
+		uint32_t blockCount = 0;
+		uint32_t allocationCount = 0; // Including dedicated ones
+		uint32_t dedicatedAllocationCount = 0;
+		VkDeviceSize blockBytes = 0; // Allocated from the driver for blocks
+		VkDeviceSize usedBytes = 0; // Handed out of blocks
+		VkDeviceSize dedicatedBytes = 0;
+	};
+
+	struct HeapBudget {
+		VkDeviceSize size = 0;
+		VkDeviceSize budget = 0; // What the process can use before the driver starts paging
+		VkDeviceSize usage = 0; // By the whole process, only this allocator's without VK_EXT_memory_budget
+		VkDeviceSize allocatedBytes = 0; // This allocator's blocks and dedicated allocations
+		VkDeviceSize usedBytes = 0; // Handed out to resources
+		bool deviceLocal = false;
+	};
+
+	struct TypeStats {
+		uint32_t heap = 0;
+		VkMemoryPropertyFlags propertyFlags = 0;
+		uint32_t allocationCount = 0;
+		VkDeviceSize allocatedBytes = 0;
+		VkDeviceSize usedBytes = 0;
+		VkDeviceSize bufferBytes = 0; // Linear resources
+		VkDeviceSize imageBytes = 0; // Optimal-tiling images, including the swapchain's depth attachments
+	};
+
+	// Called from update() with the heap's index for every heap over the threshold, until enough has been freed
+	using BudgetCallback = std::function<void(uint32_t p_heap, const HeapBudget& p_budget)>;
+
+	static constexpr float DEFAULT_BUDGET_THRESHOLD = 0.9f;
+
+	MemoryAllocator(Device& p_device, VkDeviceSize p_blockSize = DEFAULT_BLOCK_SIZE);
+	~MemoryAllocator();
+
+	// Delete copy-constructors
+	MemoryAllocator(const MemoryAllocator&) = delete;
+	MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+	// Resources larger than half a block get a VkDeviceMemory of their own, p_linear is false for optimal-tiling images
+	MemoryAllocation allocate(const VkMemoryRequirements& p_requirements, VkMemoryPropertyFlags p_properties, bool p_linear);
+	void free(const MemoryAllocation& p_allocation);
+
+	Stats getStats() const;
+	// Blocks allocated from the driver plus dedicated allocations, counts towards maxMemoryAllocationCount
+	uint32_t getDeviceAllocationCount() const {return m_deviceAllocationCount;}
+
+	// Without VK_EXT_memory_budget the budget is estimated as 80% of the heap
+	std::vector<HeapBudget> getHeapBudgets() const;
+	const std::vector<TypeStats>& getTypeStats() const {return m_typeStats;}
+	void writeJson(std::ostream& p_stream) const;
+
+	void addBudgetCallback(BudgetCallback p_callback) {m_budgetCallbacks.push_back(std::move(p_callback));}
+	// Fraction of a heap's budget at which the callbacks start firing
+	void setBudgetThreshold(float p_threshold) {m_budgetThreshold = p_threshold;}
+	// Rewrites p_filePath with writeJson() every p_interval from update(), an empty path stops it
+	void setJsonDump(const std::string& p_filePath, std::chrono::milliseconds p_interval);
+
+	// Call once per frame
+	void update();
+private:
+	struct Block {
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+		RangeAllocator ranges = {};
+		void* mapped = nullptr;
+		uint32_t allocationCount = 0;
+	};
+
+	struct Pool {
+		uint32_t memoryType = 0;
+		std::vector<Block> blocks = {};
+	};
+
+	Device& m_device;
+	VkDeviceSize m_blockSize;
+	VkPhysicalDeviceMemoryProperties m_memoryProperties = {};
+	VkDeviceSize m_nonCoherentAtomSize = 1;
+
+	// Two pools per memory type, linear resources first
+	std::vector<Pool> m_pools = {};
+	uint32_t m_deviceAllocationCount = 0;
+	uint32_t m_dedicatedAllocationCount = 0;
+	VkDeviceSize m_dedicatedBytes = 0;
+	std::vector<TypeStats> m_typeStats = {};
+
+	std::vector<BudgetCallback> m_budgetCallbacks = {};
+	float m_budgetThreshold = DEFAULT_BUDGET_THRESHOLD;
+
+	std::string m_jsonDumpPath = {};
+	std::chrono::milliseconds m_jsonDumpInterval = {};
+	std::chrono::steady_clock::time_point m_lastJsonDump = {};
+
+	VkDeviceMemory allocateDeviceMemory(VkDeviceSize p_size, uint32_t p_memoryType, void** p_mapped);
+	void freeDeviceMemory(VkDeviceMemory p_memory, VkDeviceSize p_size, uint32_t p_memoryType, bool p_mapped);
+	void trackResource(const MemoryAllocation& p_allocation, bool p_allocate);
+	bool isHostVisible(uint32_t p_memoryType) const;
+	bool isHostCoherent(uint32_t p_memoryType) const;
+};
+
+} // FFL
+
+#endif // MEMORYALLOCATOR_HPP
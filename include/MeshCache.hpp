@@ -0,0 +1,74 @@
+#ifndef MESHCACHE_HPP
+#define MESHCACHE_HPP
+
+#include "Model.hpp"
+
+// STD
+#include <cstdint>
+#include <string>
+
+namespace FFL {
+
+// Binary mesh cache stored next to the source file (models/foo.obj -> models/foo.mesh)
+// Holds the deduplicated vertex and index arrays, the LOD table and the meshlets exactly as they are uploaded, so loading is a single mmap
+// Compressed caches store the vertex and index arrays with MeshCodec and decode them on load
+class MeshCache {
+public:
+	static constexpr uint32_t MAGIC = 0x4d4c4646; // "FFLM"
+	static constexpr uint32_t VERSION = 5;
+
+	// Header flags, the processing that was applied to the stored mesh
+	static constexpr uint32_t FLAG_VERTEX_CACHE_OPTIMIZED = 1 << 0;
+	static constexpr uint32_t FLAG_OVERDRAW_OPTIMIZED = 1 << 1;
+	static constexpr uint32_t FLAG_MESHLETS = 1 << 2;
+	static constexpr uint32_t FLAG_COMPRESSED = 1 << 3; // Vertex and index sections are MeshCodec streams
+	static constexpr uint32_t FLAG_LOD_COUNT_SHIFT = 8; // Requested LOD count in bits 8-15, the chain may be shorter
+	static constexpr uint32_t FLAG_LOD_COUNT_MASK = 0xff << FLAG_LOD_COUNT_SHIFT;
+
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexStride;
+		uint32_t flags;
+		uint64_t sourceSize;
+		int64_t sourceModifiedTime;
+		uint64_t sourceHash;
+		uint32_t vertexCount;
+		uint32_t indexCount;
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+		uint32_t lodCount;
+		uint32_t meshletCount;
+		uint64_t lodOffset;
+		uint64_t meshletOffset;
+		uint64_t vertexBytes; // Size of the vertex section, smaller than vertexCount * vertexStride when compressed
+		uint64_t indexBytes;
+	};
+
+	static std::string cachePathFor(const std::string& p_sourcePath);
+
+	static uint32_t flagsFor(const Model::Builder::Options& p_options);
+
+	// Maps the cache into p_builder, returns false if missing, corrupt, older than p_sourcePath or processed
+	// with different p_builder.options
+	static bool load(const std::string& p_cachePath, const std::string& p_sourcePath, Model::Builder& p_builder);
+	static void write(const std::string& p_cachePath, const std::string& p_sourcePath, const Model::Builder& p_builder);
+
+	// Content hash stored in the header, identifies sources independent of their path
+	static uint64_t hashSource(const std::string& p_sourcePath);
+private:
+	struct SourceInfo {
+		bool exists = false;
+		uint64_t size = 0;
+		int64_t modifiedTime = 0;
+	};
+
+	static SourceInfo querySource(const std::string& p_sourcePath);
+	// Matches the header against the options and the source, refreshes the stored timestamp of a source that
+	// was touched but still hashes the same
+	static bool checkHeader(const std::string& p_cachePath, const std::string& p_sourcePath, const Model::Builder::Options& p_options);
+};
+
+} // FFL
+
+#endif // MESHCACHE_HPP
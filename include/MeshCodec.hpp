@@ -0,0 +1,29 @@
+#ifndef MESHCODEC_HPP
+#define MESHCODEC_HPP
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FFL {
+
+// Lossless compression of mesh data for the mesh cache, independent of the vertex format
+// Indices are stored per triangle as variable length deltas, vertices as byte planes of deltas between consecutive
+// vertices packed into 0, 2, 4 or 8 bits per group of 16. Both work best on meshes that went through
+// MeshOptimizer, whose first-use vertex order keeps neighbouring indices and vertices close together
+class MeshCodec {
+public:
+	// Triangles come back rotated so their largest index is first, the winding and the triangle order are kept
+	static std::vector<uint8_t> encodeIndices(const uint32_t* p_indices, size_t p_indexCount);
+	// Returns false if p_data is truncated or corrupt
+	static bool decodeIndices(uint32_t* p_destination, size_t p_indexCount, const uint8_t* p_data, size_t p_size);
+
+	static std::vector<uint8_t> encodeVertices(const void* p_vertices, size_t p_vertexCount, size_t p_vertexSize);
+	// Returns false if p_data is truncated or corrupt, uses SSSE3 when the build targets it
+	static bool decodeVertices(void* p_destination, size_t p_vertexCount, size_t p_vertexSize, const uint8_t* p_data, size_t p_size);
+};
+
+} // FFL
+
+#endif // MESHCODEC_HPP
@@ -0,0 +1,37 @@
+#ifndef MESHOPTIMIZER_HPP
+#define MESHOPTIMIZER_HPP
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FFL {
+
+// Reorders indexed triangle lists for the GPU, independent of the vertex format
+// Typical use is optimizeVertexCache, then optionally optimizeOverdraw, then buildFetchRemap to sort the vertices
+class MeshOptimizer {
+public:
+	struct CacheStatistics {
+		float acmr = 0.0f; // Vertex shader invocations per triangle, 0.5 is ideal for a regular grid and 3 is the worst case
+		float atvr = 0.0f; // Vertex shader invocations per unique vertex, 1.0 is ideal
+	};
+
+	// Simulates a FIFO post-transform cache of p_cacheSize entries over the triangle list
+	static CacheStatistics analyzeVertexCache(const uint32_t* p_indices, size_t p_indexCount, size_t p_vertexCount, uint32_t p_cacheSize = 16);
+
+	// Greedy triangle reordering for post-transform cache hit rate (Forsyth's linear-speed algorithm)
+	static void optimizeVertexCache(uint32_t* p_indices, size_t p_indexCount, size_t p_vertexCount);
+
+	// Splits a cache optimized list into clusters whose ACMR stays within p_threshold of the original and draws
+	// outward-facing clusters first, so they occlude the rest. p_positions points at the first vertex's xyz
+	static void optimizeOverdraw(uint32_t* p_indices, size_t p_indexCount, const float* p_positions, size_t p_vertexCount, size_t p_vertexStride, float p_threshold);
+
+	// Renumbers p_indices so vertices are referenced in first-use order and fills p_remap[old] = new
+	// (UINT32_MAX for unreferenced vertices), returns the number of referenced vertices
+	static uint32_t buildFetchRemap(uint32_t* p_indices, size_t p_indexCount, size_t p_vertexCount, std::vector<uint32_t>& p_remap);
+};
+
+} // FFL
+
+#endif // MESHOPTIMIZER_HPP
@@ -0,0 +1,155 @@
+#ifndef MESHPOOL_HPP
+#define MESHPOOL_HPP
+
+#include "Buffer.hpp"
+#include "RangeAllocator.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace FFL {
+
+class Device;
+class UploadBatcher;
+
+// Sub-allocates the vertex and index ranges of every mesh out of a few large device-local buffers, so a frame binds
+// them once per block instead of once per object
+// Both index types share a block's index buffer, a mesh's first index is its byte offset divided by its index size
+// With a position stride the positions get a buffer of their own per block, indexed by the same vertex offsets
+// On unified memory the blocks are host visible and meshes are written in place instead of staged
+// defragment() moves live meshes towards the front of the first blocks with GPU copies, owners always look their
+// ranges up through the handle so they follow without being told
+class MeshPool {
+public:
+	using Handle = uint32_t;
+	static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+	static constexpr uint32_t DEFAULT_BLOCK_VERTICES = 1 << 20;
+	static constexpr VkDeviceSize DEFAULT_BLOCK_INDEX_BYTES = 16 * 1024 * 1024;
+	// Bytes of vertex and index data defragment() copies per call
+	static constexpr VkDeviceSize DEFAULT_DEFRAGMENT_BUDGET = 4 * 1024 * 1024;
+	// CPU time defragment() spends looking for and recording moves per call
+	static constexpr std::chrono::microseconds DEFAULT_DEFRAGMENT_TIME_BUDGET{500};
+	// defragment() returns right away while getFragmentation() is below this
+	static constexpr float DEFAULT_DEFRAGMENT_THRESHOLD = 0.1f;
+
+	struct Allocation {
+		uint32_t block = 0;
+		uint32_t vertexOffset = 0;
+		uint32_t vertexCount = 0;
+		VkDeviceSize indexByteOffset = 0;
+		uint32_t indexCount = 0;
+		VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+
+		uint32_t indexSize() const {return indexType == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);}
+		uint32_t firstIndex() const {return static_cast<uint32_t>(indexByteOffset / indexSize());}
+	};
+
+	// p_vertexStride excludes the positions when p_positionStride is not 0
+	MeshPool(Device& p_device, uint32_t p_vertexStride, uint32_t p_positionStride = 0);
+	~MeshPool();
+
+	// Delete copy-constructors
+	MeshPool(const MeshPool&) = delete;
+	MeshPool& operator=(const MeshPool&) = delete;
+
+	// The handle starts with one reference
+	Handle allocate(uint32_t p_vertexCount, uint32_t p_indexCount, VkIndexType p_indexType);
+	// Adds a reference for another model drawing the same mesh
+	void retain(Handle p_handle);
+	// Drops a reference, the ranges of the last one stay reserved until every frame that may still draw from them
+	// has finished
+	void free(Handle p_handle);
+	// Same delay for a buffer that frames in flight may still read
+	void deferDestroy(std::shared_ptr<Buffer> p_buffer);
+
+	// Call once per frame after Renderer::beginFrame, the oldest frame in flight has finished by then
+	void nextFrame();
+
+	// Records copies that move meshes into lower free ranges, up to the byte and time budgets, and points their handles
+	// at the new ranges, the old ones are released once this frame has finished
+	// Does nothing while the pool is less fragmented than the threshold
+	// Call outside a render pass, after the frame's uploads have been submitted and before anything draws from the pool
+	// Returns the bytes moved
+	VkDeviceSize defragment(VkCommandBuffer p_commandBuffer);
+	void setDefragmentBudget(VkDeviceSize p_defragmentBudget) {m_defragmentBudget = p_defragmentBudget;}
+	void setDefragmentTimeBudget(std::chrono::microseconds p_defragmentTimeBudget) {m_defragmentTimeBudget = p_defragmentTimeBudget;}
+	void setDefragmentThreshold(float p_defragmentThreshold) {m_defragmentThreshold = p_defragmentThreshold;}
+	// Share of the free space that is not part of its block's largest free range, 0 when every block's free space is
+	// one contiguous range
+	float getFragmentation() const;
+
+	const Allocation& get(Handle p_handle) const {return m_allocations[p_handle];}
+	VkBuffer getVertexBuffer(const Allocation& p_allocation) const {return m_blocks[p_allocation.block].vertexBuffer->getBuffer();}
+	VkBuffer getIndexBuffer(const Allocation& p_allocation) const {return m_blocks[p_allocation.block].indexBuffer->getBuffer();}
+	VkDeviceSize getVertexByteOffset(const Allocation& p_allocation) const {return static_cast<VkDeviceSize>(p_allocation.vertexOffset) * m_vertexStride;}
+	VkBuffer getPositionBuffer(const Allocation& p_allocation) const {return m_blocks[p_allocation.block].positionBuffer->getBuffer();}
+	VkDeviceSize getPositionByteOffset(const Allocation& p_allocation) const {return static_cast<VkDeviceSize>(p_allocation.vertexOffset) * m_positionStride;}
+	bool hasPositionStream() const {return m_positionStride != 0;}
+	uint32_t getBlockCount() const {return static_cast<uint32_t>(m_blocks.size());}
+
+	// Memory to write the allocation's data into, the block itself on unified memory and staging memory in
+	// p_uploadBatcher otherwise
+	void* writeVertices(const Allocation& p_allocation, UploadBatcher& p_uploadBatcher) const;
+	void* writePositions(const Allocation& p_allocation, UploadBatcher& p_uploadBatcher) const;
+	void* writeIndices(const Allocation& p_allocation, UploadBatcher& p_uploadBatcher) const;
+	bool isHostWritable() const {return m_hostWritable;}
+
+	// Binds the allocation's block, draws then pass firstIndex() and vertexOffset
+	void bind(VkCommandBuffer p_commandBuffer, const Allocation& p_allocation) const;
+	// Binds the position buffer to binding 0, or the interleaved vertex buffer without a position stream
+	void bindPositions(VkCommandBuffer p_commandBuffer, const Allocation& p_allocation) const;
+	// True if p_a and p_b can be drawn without binding again
+	static bool sharesBinding(const Allocation& p_a, const Allocation& p_b) {return p_a.block == p_b.block && p_a.indexType == p_b.indexType;}
+private:
+	struct Block {
+		std::unique_ptr<Buffer> vertexBuffer = nullptr;
+		std::unique_ptr<Buffer> positionBuffer = nullptr;
+		std::unique_ptr<Buffer> indexBuffer = nullptr;
+		RangeAllocator vertices = {};
+		RangeAllocator indexBytes = {};
+	};
+
+	struct PendingRelease {
+		uint64_t frame = 0;
+		Handle handle = INVALID_HANDLE;
+		std::shared_ptr<Buffer> buffer = nullptr;
+		Allocation ranges = {}; // Left behind by defragment(), valid when moved is set
+		bool moved = false;
+	};
+
+	Device& m_device;
+	uint32_t m_vertexStride;
+	uint32_t m_positionStride;
+	bool m_hostWritable;
+
+	std::vector<Block> m_blocks = {};
+	std::vector<Allocation> m_allocations = {};
+	std::vector<uint32_t> m_referenceCounts = {};
+	std::vector<Handle> m_freeHandles = {};
+
+	uint64_t m_frame = 0;
+	std::vector<PendingRelease> m_pendingReleases = {};
+
+	VkDeviceSize m_defragmentBudget = DEFAULT_DEFRAGMENT_BUDGET;
+	std::chrono::microseconds m_defragmentTimeBudget = DEFAULT_DEFRAGMENT_TIME_BUDGET;
+	float m_defragmentThreshold = DEFAULT_DEFRAGMENT_THRESHOLD;
+
+	void createBlock(uint32_t p_vertexCapacity, VkDeviceSize p_indexCapacity);
+	bool tryAllocate(uint32_t p_block, Allocation& p_allocation);
+	void freeRanges(const Allocation& p_allocation);
+	void release(Handle p_handle);
+	// Destroys the buffers of blocks nothing is allocated from, keeping at least one block
+	void releaseEmptyBlocks();
+	void copyMesh(VkCommandBuffer p_commandBuffer, const Allocation& p_src, const Allocation& p_dst) const;
+};
+
+} // FFL
+
+#endif // MESHPOOL_HPP
@@ -0,0 +1,36 @@
+#ifndef MESHSIMPLIFIER_HPP
+#define MESHSIMPLIFIER_HPP
+
+// STD
+#include <cstddef>
+#include <cstdint>
+
+namespace FFL {
+
+// Quadric error edge-collapse simplification of indexed triangle lists
+// Collapses move a vertex onto a neighbour instead of creating new ones, so every level of detail can index the
+// original vertex buffer. Vertices that share a position are collapsed together, each corner then picks the wedge
+// (vertex at the new position) whose attributes are closest to the ones it had, which keeps normal and uv seams intact
+class MeshSimplifier {
+public:
+	// p_positions and p_attributes point at the first vertex's data, both with p_vertexStride bytes between vertices
+	// p_attributes is compared as p_attributeCount floats, pass 0 when there is only one vertex per position
+	struct Mesh {
+		const uint32_t* indices = nullptr;
+		size_t indexCount = 0;
+		const float* positions = nullptr;
+		const float* attributes = nullptr;
+		size_t attributeCount = 0;
+		size_t vertexCount = 0;
+		size_t vertexStride = 0;
+	};
+
+	// Writes at most p_mesh.indexCount indices to p_destination and returns how many, stops at p_targetIndexCount or
+	// when every remaining collapse would move the surface further than p_targetError. p_resultError receives the
+	// largest distance any collapse moved the surface, in the units of the positions
+	static size_t simplify(uint32_t* p_destination, const Mesh& p_mesh, size_t p_targetIndexCount, float p_targetError, float* p_resultError = nullptr);
+};
+
+} // FFL
+
+#endif // MESHSIMPLIFIER_HPP
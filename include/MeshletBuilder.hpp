@@ -0,0 +1,39 @@
+#ifndef MESHLETBUILDER_HPP
+#define MESHLETBUILDER_HPP
+
+// Libraries
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace FFL {
+
+// Cluster of consecutive triangles in the index buffer, laid out to match the std430 struct in meshlet_cull.comp
+struct Meshlet {
+	glm::vec4 boundingSphere = {}; // Model space center and radius
+	glm::vec4 cone = {}; // Axis and cutoff, the cluster is back-facing for any viewer outside the cone
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	uint32_t vertexCount = 0;
+	uint32_t padding = 0;
+};
+
+class MeshletBuilder {
+public:
+	static constexpr uint32_t MAX_VERTICES = 64;
+	static constexpr uint32_t MAX_TRIANGLES = 124;
+
+	// Splits the triangle list into runs of at most MAX_VERTICES unique vertices and MAX_TRIANGLES triangles
+	// Triangles keep their order, so the input should already be vertex cache optimized for compact clusters
+	// Cone normals follow the engine's clockwise front faces (see Pipeline::defaultPipelineConfigInfo)
+	static std::vector<Meshlet> build(const uint32_t* p_indices, size_t p_indexCount, const float* p_positions, size_t p_vertexCount, size_t p_vertexStride);
+};
+
+} // FFL
+
+#endif // MESHLETBUILDER_HPP
@@ -3,6 +3,12 @@
 
 #include "Device.hpp"
 #include "Buffer.hpp"
+#include "MappedFile.hpp"
+#include "MeshletBuilder.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshPool.hpp"
+#include "UploadBatcher.hpp"
+#include "VertexFormat.hpp"
 
 // Libraries
 #define GLM_FORCE_RADIANS
@@ -12,6 +18,7 @@
 // STD
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace FFL {
@@ -24,21 +31,102 @@ public:
 		glm::vec3 normal = {};
 		glm::vec2 uv = {};
 
-		static std::vector<VkVertexInputBindingDescription> getBindingDescriptions();
-		static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions();
-
 		bool operator==(const Vertex& p_other) const {
 			return position == p_other.position && color == p_other.color && normal == p_other.normal && uv == p_other.uv;
 		}
+
+		// Consistent with operator==, -0.0 and 0.0 hash the same
+		uint64_t hash() const;
+	};
+
+	// Format of the vertex buffer on the GPU, Vertex stays the loading and cache format
+	// Locations 0-3 are position, color, normal and uv, the quantized layout is 20 bytes instead of 44
+#ifdef FFL_QUANTIZED_VERTICES
+	using VertexFormat = VertexLayout<PositionSnorm16, ColorUnorm8, NormalOct16, UvHalf2>;
+#else
+	using VertexFormat = VertexLayout<PositionFloat3, ColorFloat3, NormalFloat3, UvFloat2>;
+#endif
+
+	// Positions in their own buffer next to the other attributes, see VertexLayout::getSplitBindingDescriptions
+#ifdef FFL_SPLIT_POSITIONS
+	static constexpr bool SPLIT_POSITIONS = true;
+#else
+	static constexpr bool SPLIT_POSITIONS = false;
+#endif
+
+	// Range of the shared index buffer drawing one level of detail, error is the largest distance the surface
+	// moved from level 0 in model space
+	struct Lod {
+		uint32_t firstIndex = 0;
+		uint32_t indexCount = 0;
+		float error = 0.0f;
 	};
 
 	struct Builder {
+		// Post-load processing, part of the mesh cache key so changing them regenerates the cache
+		struct Options {
+			bool optimizeVertexCache = true;
+			bool optimizeOverdraw = false;
+			float overdrawThreshold = 1.05f; // Allowed ACMR increase when splitting into clusters
+			uint32_t lodCount = 4; // Levels of detail including the full mesh, 1 disables simplification
+			float lodReduction = 0.5f; // Triangle count of each level relative to the one before
+			bool buildMeshlets = true; // Clusters of level 0 for GPU culling
+			// Store vertices and indices with MeshCodec, decoded on load instead of mapped, not part of the key
+			bool compressCache = false;
+		};
+
+		struct OptimizationReport {
+			MeshOptimizer::CacheStatistics before = {};
+			MeshOptimizer::CacheStatistics after = {};
+		};
+
+		Options options = {};
 		std::vector<Vertex> vertices = {};
 		std::vector<uint32_t> indices = {};
+		std::vector<Lod> lods = {};
+		std::vector<Meshlet> meshlets = {};
 
+		// Loads from the mesh cache when it is up to date, otherwise parses the OBJ, builds the LOD chain, optimizes
+		// and regenerates the cache
 		void loadModel(const std::string& p_filePath);
+		void loadObj(const std::string& p_filePath);
+		// Simplifies the mesh into options.lodCount levels appended to indices, only valid after loadObj
+		void generateLods();
+		// Reorders triangles of every level and then vertices according to options, only valid after loadObj
+		OptimizationReport optimize();
+		// Splits level 0 into meshlets, call last since it records index ranges and vertex positions
+		void buildMeshlets();
+
+		// Data to upload, points into the mapped mesh cache instead of vertices/indices when loaded from an uncompressed one
+		const Vertex* vertexData() const {return m_mapping ? m_mappedVertices : vertices.data();}
+		const uint32_t* indexData() const {return m_mapping ? m_mappedIndices : indices.data();}
+		uint32_t vertexCount() const {return m_mapping ? m_mappedVertexCount : static_cast<uint32_t>(vertices.size());}
+		uint32_t indexCount() const {return m_mapping ? m_mappedIndexCount : static_cast<uint32_t>(indices.size());}
+		const Lod* lodData() const {return m_mapping ? m_mappedLods : lods.data();}
+		uint32_t lodCount() const {return m_mapping ? m_mappedLodCount : static_cast<uint32_t>(lods.size());}
+		const Meshlet* meshletData() const {return m_mapping ? m_mappedMeshlets : meshlets.data();}
+		uint32_t meshletCount() const {return m_mapping ? m_mappedMeshletCount : static_cast<uint32_t>(meshlets.size());}
+		// Content hash of the source file, known after loadModel, 0 otherwise
+		uint64_t sourceHash() const {return m_sourceHash;}
+	private:
+		std::unique_ptr<MappedFile> m_mapping = nullptr;
+		const Vertex* m_mappedVertices = nullptr;
+		const uint32_t* m_mappedIndices = nullptr;
+		uint32_t m_mappedVertexCount = 0;
+		uint32_t m_mappedIndexCount = 0;
+		const Lod* m_mappedLods = nullptr;
+		uint32_t m_mappedLodCount = 0;
+		const Meshlet* m_mappedMeshlets = nullptr;
+		uint32_t m_mappedMeshletCount = 0;
+		uint32_t m_processFlags = 0; // MeshCache::FLAG_* describing the processing that was applied
+		uint64_t m_sourceHash = 0;
+
+		friend class MeshCache;
 	};
 
+	// Empty and not ready, ModelLoader fills it in once the mesh is parsed and uploaded
+	explicit Model(Device& p_device);
+	// Uploads p_builder and waits for the copies to finish
 	Model(Device& p_device, const Model::Builder& p_builder);
 	~Model();
 
@@ -48,20 +136,58 @@ public:
 
 	static std::unique_ptr<Model> createModelFromFile(Device& p_device, const std::string& p_filePath);
 
+	// False while an asynchronous upload is in flight, nothing else may be called on the model until then
+	bool isReady() const {return m_ready;}
+
 	void bind(VkCommandBuffer p_commandBuffer);
-	void draw(VkCommandBuffer p_commandBuffer);
+	// Binds only the positions for pipelines made with Pipeline::positionOnlyPipelineConfigInfo
+	void bindPositions(VkCommandBuffer p_commandBuffer);
+	void draw(VkCommandBuffer p_commandBuffer, uint32_t p_lod = 0);
+
+	// Coarsest level whose error times p_errorScale stays within p_maxError, 0 when there is no LOD chain
+	uint32_t selectLod(float p_errorScale, float p_maxError) const;
+	uint32_t getLodCount() const {return static_cast<uint32_t>(m_lods.size());}
+
+	// Meshlets of level 0 in a storage buffer, meshes that fit in a single meshlet are not worth culling per cluster
+	bool hasMeshlets() const {return m_meshletCount > 1;}
+	uint32_t getMeshletCount() const {return m_meshletCount;}
+	VkDescriptorBufferInfo getMeshletBufferInfo() const {return m_meshletBuffer->descriptorInfo();}
+
+	// Device memory of the vertex, index and meshlet data, which may be shared with other models
+	VkDeviceSize getResidentBytes() const;
+
+	// Maps the stored positions back to model space, multiply into the model matrix when drawing
+	const glm::mat4& getPositionTransform() const {return m_positionTransform;}
+	VkIndexType getIndexType() const {return m_indexType;}
+	// Where the mesh lives in the device's MeshPool, draws of meshes that share its binding need no bind() in between
+	const MeshPool::Allocation& getMeshAllocation() const {return m_device.meshPool().get(m_meshHandle);}
 private:
 	Device& m_device;
+	bool m_ready = false;
 
-	std::unique_ptr<Buffer> m_vertexBuffer;
-	uint32_t m_vertexCount;
+	MeshPool::Handle m_meshHandle = MeshPool::INVALID_HANDLE;
+	uint32_t m_vertexCount = 0;
+	glm::mat4 m_positionTransform{1.0f};
 
 	bool m_hasIndexBuffer = false;
-	std::unique_ptr<Buffer> m_indexBuffer;
-	uint32_t m_indexCount;
+	uint32_t m_indexCount = 0;
+	VkIndexType m_indexType = VK_INDEX_TYPE_UINT32;
+	std::vector<Lod> m_lods = {};
+
+	std::shared_ptr<Buffer> m_meshletBuffer;
+	uint32_t m_meshletCount = 0;
+
+	// Stage the data in p_uploadBatcher, the buffers are usable once its next submission has completed
+	void createBuffers(const Model::Builder& p_builder, UploadBatcher& p_uploadBatcher);
+	void uploadVertices(const Vertex* p_vertices, const MeshPool::Allocation& p_allocation, UploadBatcher& p_uploadBatcher);
+	void uploadIndices(const uint32_t* p_indices, const MeshPool::Allocation& p_allocation, UploadBatcher& p_uploadBatcher);
+	void createMeshletBuffer(const Meshlet* p_meshlets, uint32_t p_meshletCount, UploadBatcher& p_uploadBatcher);
+
+	// Uses p_source's GPU data instead of uploading an identical copy, ready once p_source is
+	void shareMesh(const Model& p_source);
 
-	void createVertexBuffers(const std::vector<Vertex>& p_vertices);
-	void createIndexBuffer(const std::vector<uint32_t>& p_indices);
+	friend class ModelLoader;
+	friend class ModelRegistry;
 };
 
 } // FFL
@@ -0,0 +1,80 @@
+#ifndef MODELLOADER_HPP
+#define MODELLOADER_HPP
+
+#include "Device.hpp"
+#include "Model.hpp"
+#include "ThreadPool.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace FFL {
+
+// Streams models in without blocking the frame loop
+// Parsing, LOD generation and optimization run on a thread pool, update() then stages finished meshes in the
+// device's UploadBatcher as one submission and marks the models ready once it has completed
+class ModelLoader {
+public:
+	// Bytes of mesh data update() encodes into staging memory per call, at least one model is always started
+	static constexpr VkDeviceSize DEFAULT_UPLOAD_BUDGET = 32 * 1024 * 1024;
+
+	ModelLoader(Device& p_device, ThreadPool& p_threadPool = ThreadPool::shared());
+	~ModelLoader();
+
+	// Delete copy-constructors
+	ModelLoader(const ModelLoader&) = delete;
+	ModelLoader& operator=(const ModelLoader&) = delete;
+
+	// Returns immediately with a model that is not ready yet, assign it to game objects right away
+	std::shared_ptr<Model> load(const std::string& p_filePath);
+
+	// Call once per frame from the thread that submits to the graphics queue
+	void update();
+	// Blocks until every requested model is ready or has failed
+	void waitIdle();
+
+	size_t pendingCount() const {return m_pendingParses.size() + m_pendingUploads.size();}
+
+	void setUploadBudget(VkDeviceSize p_uploadBudget) {m_uploadBudget = p_uploadBudget;}
+
+	// Runs on parsed models before they are uploaded, returning false skips the upload and leaves the model to the
+	// filter, which must make it ready itself
+	using UploadFilter = std::function<bool(const std::shared_ptr<Model>&, const Model::Builder&)>;
+	void setUploadFilter(UploadFilter p_uploadFilter) {m_uploadFilter = std::move(p_uploadFilter);}
+private:
+	struct PendingParse {
+		std::shared_ptr<Model> model = nullptr;
+		std::string filePath = {};
+		std::future<std::unique_ptr<Model::Builder>> builder = {};
+	};
+
+	struct PendingUpload {
+		std::vector<std::shared_ptr<Model>> models = {};
+		uint64_t ticket = 0; // UploadBatcher submission
+	};
+
+	Device& m_device;
+	ThreadPool& m_threadPool;
+	VkDeviceSize m_uploadBudget = DEFAULT_UPLOAD_BUDGET;
+	UploadFilter m_uploadFilter = nullptr;
+
+	std::vector<PendingParse> m_pendingParses = {};
+	std::vector<PendingUpload> m_pendingUploads = {};
+
+	void startUploads(bool p_ignoreBudget);
+	void retireUploads(bool p_wait);
+};
+
+} // FFL
+
+#endif // MODELLOADER_HPP
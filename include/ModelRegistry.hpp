@@ -0,0 +1,89 @@
+#ifndef MODELREGISTRY_HPP
+#define MODELREGISTRY_HPP
+
+#include "Device.hpp"
+#include "Model.hpp"
+#include "ModelLoader.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace FFL {
+
+// Keeps one model per path and one copy of the GPU data per source content
+// Files with identical contents under different paths get their own Model sharing the first one's mesh, models
+// nobody else holds any more are dropped by update() and the MeshPool releases their memory once the GPU is done
+class ModelRegistry {
+public:
+	struct AssetInfo {
+		std::string path = {};
+		uint64_t contentHash = 0; // 0 until the source has been parsed
+		VkDeviceSize residentBytes = 0;
+		bool ready = false;
+		bool shared = false; // Draws from the mesh of a model loaded under another path
+	};
+
+	ModelRegistry(Device& p_device, ThreadPool& p_threadPool = ThreadPool::shared());
+
+	// Delete copy-constructors
+	ModelRegistry(const ModelRegistry&) = delete;
+	ModelRegistry& operator=(const ModelRegistry&) = delete;
+
+	// Returns the resident model for p_filePath, or starts loading it like ModelLoader::load
+	std::shared_ptr<Model> load(const std::string& p_filePath);
+
+	// Call once per frame from the thread that submits to the graphics queue
+	void update();
+	// Blocks until every requested model is ready or has failed
+	void waitIdle();
+
+	ModelLoader& loader() {return m_loader;}
+
+	std::vector<AssetInfo> residentAssets() const;
+	// 0 for paths that are not loaded
+	VkDeviceSize residentBytes(const std::string& p_filePath) const;
+	// Shared meshes are counted once
+	VkDeviceSize totalResidentBytes() const;
+private:
+	struct Entry {
+		std::shared_ptr<Model> model = nullptr;
+		uint64_t contentHash = 0;
+		bool shared = false;
+	};
+
+	struct ContentSource {
+		std::weak_ptr<Model> model = {};
+		std::string path = {};
+	};
+
+	struct PendingAlias {
+		std::shared_ptr<Model> model = nullptr;
+		std::shared_ptr<Model> source = nullptr;
+	};
+
+	Device& m_device;
+	ModelLoader m_loader;
+
+	std::unordered_map<std::string, Entry> m_entries = {};
+	// Model with the GPU data for each content hash, the source of every alias
+	std::unordered_map<uint64_t, ContentSource> m_contentIndex = {};
+	// Aliases of models whose upload has not completed yet
+	std::vector<PendingAlias> m_pendingAliases = {};
+
+	bool filterUpload(const std::shared_ptr<Model>& p_model, const Model::Builder& p_builder);
+	void retireAliases();
+	void evictUnused();
+	std::unordered_map<std::string, Entry>::iterator findEntry(const Model* p_model);
+};
+
+} // FFL
+
+#endif // MODELREGISTRY_HPP
@@ -0,0 +1,85 @@
+#ifndef OBJPARSER_HPP
+#define OBJPARSER_HPP
+
+#include "MappedFile.hpp"
+#include "ThreadPool.hpp"
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace FFL {
+
+// Multi-threaded Wavefront OBJ reader
+// The file is memory-mapped and split into line-aligned chunks that are parsed on a ThreadPool. Attributes are
+// parsed straight into their final arrays, face corners are produced a window of chunks at a time and handed
+// out in file order, so memory stays bounded by the attribute arrays rather than by the size of the file
+class ObjParser {
+public:
+	// Zero-based attribute indices, -1 when the corner does not reference that attribute
+	struct Corner {
+		int32_t position = -1;
+		int32_t texcoord = -1;
+		int32_t normal = -1;
+	};
+
+	using CornerCallback = std::function<void(const Corner* p_corners, size_t p_count)>;
+
+	ObjParser(const std::string& p_filePath);
+
+	// Delete copy-constructors
+	ObjParser(const ObjParser&) = delete;
+	ObjParser& operator=(const ObjParser&) = delete;
+
+	// Counts and parses every attribute, afterwards the attribute arrays and cornerCount() are available
+	void parseAttributes(ThreadPool& p_pool);
+	// Faces are fan-triangulated, p_onCorners receives three corners per triangle in file order
+	void parseFaces(ThreadPool& p_pool, const CornerCallback& p_onCorners);
+
+	size_t cornerCount() const {return m_cornerCount;}
+	const std::vector<float>& positions() const {return m_positions;}
+	const std::vector<float>& colors() const {return m_colors;}
+	const std::vector<float>& normals() const {return m_normals;}
+	const std::vector<float>& texcoords() const {return m_texcoords;}
+
+	// Returns the end of the parsed number, or p_begin if there was none
+	static const char* parseFloat(const char* p_begin, const char* p_end, float& p_value);
+private:
+	static constexpr size_t CHUNK_SIZE = 4 * 1024 * 1024;
+
+	struct Chunk {
+		const char* begin = nullptr;
+		const char* end = nullptr;
+
+		// Counts of attributes in this chunk, then the global index of the first one after the prefix sum
+		size_t positionCount = 0;
+		size_t normalCount = 0;
+		size_t texcoordCount = 0;
+		size_t cornerCount = 0;
+		size_t firstPosition = 0;
+		size_t firstNormal = 0;
+		size_t firstTexcoord = 0;
+	};
+
+	std::string m_filePath;
+	MappedFile m_file;
+
+	std::vector<Chunk> m_chunks = {};
+	size_t m_cornerCount = 0;
+	std::vector<float> m_positions = {};
+	std::vector<float> m_colors = {};
+	std::vector<float> m_normals = {};
+	std::vector<float> m_texcoords = {};
+
+	void splitChunks(size_t p_targetCount);
+	void countChunk(Chunk& p_chunk);
+	void parseChunkAttributes(const Chunk& p_chunk);
+	void parseChunkFaces(const Chunk& p_chunk, std::vector<Corner>& p_corners);
+};
+
+} // FFL
+
+#endif // OBJPARSER_HPP
@@ -2,11 +2,19 @@
 #define PIPELINE_HPP
 
 #include "Device.hpp"
+#include "ShaderLibrary.hpp"
 
 // Libraries
 #include <vulkan/vulkan_core.h>
 
 // STD
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
 #include <vector>
 
 namespace FFL {
@@ -30,11 +38,35 @@ struct PipelineConfigInfo {
 	VkPipelineLayout pipelineLayout = nullptr;
 	VkRenderPass renderPass = nullptr;
 	uint32_t subpass = 0;
+
+	// Specialization constants for every stage, stages ignore IDs they do not declare
+	std::vector<VkSpecializationMapEntry> specializationEntries = {};
+	std::vector<char> specializationData = {};
+	// Tells pipelines built from the same shaders apart, see PipelineVariantCache
+	uint64_t variantKey = 0;
+
+	template<typename T>
+	void addSpecializationConstant(uint32_t p_constantID, const T& p_value) {
+		VkSpecializationMapEntry entry = {};
+		entry.constantID = p_constantID;
+		entry.offset = static_cast<uint32_t>(specializationData.size());
+		entry.size = sizeof(T);
+
+		const char* bytes = reinterpret_cast<const char*>(&p_value);
+		specializationData.insert(specializationData.end(), bytes, bytes + sizeof(T));
+		specializationEntries.push_back(entry);
+	}
+
+	// Copies the entries and data, p_specializationInfo does not have to outlive the config
+	void setSpecializationInfo(const VkSpecializationInfo& p_specializationInfo);
 };
 
 class Pipeline {
 public:
+	// Both build the VkPipeline before returning, PipelineBuildService creates pipelines that build on its workers
 	Pipeline(Device& p_device, const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath);
+	// Compute pipeline, only needs a layout
+	Pipeline(Device& p_device, VkPipelineLayout p_pipelineLayout, const std::string& p_compPath);
 	~Pipeline();
 
 	// Delete copy-constructors
@@ -42,18 +74,69 @@ public:
 	Pipeline& operator=(const Pipeline&) = delete;
 
 	static void defaultPipelineConfigInfo(PipelineConfigInfo& p_configInfo);
+	// Default state with only the position at location 0, for depth prepasses and shadow maps drawn after
+	// Model::bindPositions
+	static void positionOnlyPipelineConfigInfo(PipelineConfigInfo& p_configInfo);
 
+	// Copies p_source into p_destination, pointing the state that refers into the config at the copy
+	static void copyConfigInfo(const PipelineConfigInfo& p_source, PipelineConfigInfo& p_destination);
+
+	// Waits for a build still running on PipelineBuildService, or runs it here when no worker has started it yet
 	void bind(VkCommandBuffer p_commandBuffer);
+
+	uint64_t getVariantKey() const {return m_configInfo != nullptr ? m_configInfo->variantKey : 0;}
+
+	bool usesShader(const std::string& p_filePath) const;
+	// Builds a new VkPipeline from the current shader files, safe to call from any thread
+	// p_shaders receives the modules it was built from
+	// p_fastLink links graphics pipelines from cached library parts when the device supports it, quicker to build
+	// but slower to run
+	VkPipeline createPipeline(std::vector<std::shared_ptr<ShaderModule>>& p_shaders, bool p_fastLink = false) const;
+	// Returns the previous VkPipeline, which the caller destroys once no frame in flight uses it
+	VkPipeline replacePipeline(VkPipeline p_pipeline, std::vector<std::shared_ptr<ShaderModule>> p_shaders);
 private:
+	friend class PipelineBuildService;
+
+	// Selects the constructors that leave the build to deferBuild() or the first bind()
+	struct Deferred {};
+
+	struct PendingBuild {
+		// Set by whoever runs the build, a worker or the thread that needs the pipeline first
+		std::atomic<bool> claimed{false};
+		std::promise<void> finished = {};
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		std::vector<std::shared_ptr<ShaderModule>> shaders = {};
+		bool linked = false;
+		std::exception_ptr error = nullptr;
+	};
+
+	Pipeline(Device& p_device, const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath, Deferred);
+	Pipeline(Device& p_device, VkPipelineLayout p_pipelineLayout, const std::string& p_compPath, Deferred);
+
 	Device& m_device;
-	VkPipeline m_graphicsPipeline;
-	VkShaderModule m_vertShaderModule;
-	VkShaderModule m_fragShaderModule;
+	VkPipeline m_pipeline = VK_NULL_HANDLE;
+	VkPipelineBindPoint m_bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	// Kept so later pipelines reuse the modules, empty once created with inline SPIR-V
+	std::vector<std::shared_ptr<ShaderModule>> m_shaders = {};
+
+	// Everything needed to build the pipeline again when a shader changes
+	std::vector<std::string> m_shaderPaths = {};
+	std::unique_ptr<PipelineConfigInfo> m_configInfo = nullptr;
+	VkPipelineLayout m_computeLayout = VK_NULL_HANDLE;
+
+	// Shared with the task from deferBuild(), which may run after the pipeline is gone
+	std::shared_ptr<PendingBuild> m_pendingBuild = nullptr;
 
-	static std::vector<char> readFile(const std::string& p_filePath);
+	// The task building the pipeline on a worker, does nothing when the pipeline got to it first
+	std::function<void()> deferBuild();
+	void runBuild(PendingBuild& p_build, bool p_fastLink) const;
+	void waitForBuild();
+	// Returns what a build that was already running produced, for the caller to destroy
+	VkPipeline cancelBuild();
 
-	void createGraphicsPipeline(const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath);
-	void createShaderModule(const std::vector<char>& p_code, VkShaderModule* p_shaderModule);
+	VkPipeline createGraphicsPipeline(std::vector<std::shared_ptr<ShaderModule>>& p_shaders) const;
+	VkPipeline createLinkedPipeline(std::vector<std::shared_ptr<ShaderModule>>& p_shaders) const;
+	VkPipeline createComputePipeline(std::vector<std::shared_ptr<ShaderModule>>& p_shaders) const;
 };
 
 } // FFL
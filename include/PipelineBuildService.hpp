@@ -0,0 +1,49 @@
+#ifndef PIPELINEBUILDSERVICE_HPP
+#define PIPELINEBUILDSERVICE_HPP
+
+#include "Pipeline.hpp"
+#include "ThreadPool.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace FFL {
+
+class Device;
+
+// Collects the pipelines systems create during startup and builds them together on the thread pool, one
+// vkCreate*Pipelines per worker, instead of one after another on the main thread
+// Pipelines are usable right away, binding one before its worker finishes waits for just that pipeline, and
+// binding one no worker has started builds it on the spot, fast-linked where the device supports it
+class PipelineBuildService {
+public:
+	PipelineBuildService(Device& p_device, ThreadPool& p_threadPool = ThreadPool::shared());
+
+	// Delete copy-constructors
+	PipelineBuildService(const PipelineBuildService&) = delete;
+	PipelineBuildService& operator=(const PipelineBuildService&) = delete;
+
+	// Same as the Pipeline constructors, but the VkPipeline is only built after submit() or on first bind
+	std::unique_ptr<Pipeline> createGraphicsPipeline(const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath);
+	std::unique_ptr<Pipeline> createComputePipeline(VkPipelineLayout p_pipelineLayout, const std::string& p_compPath);
+
+	// Hands every pipeline collected so far to the workers, returns without waiting
+	void submit();
+private:
+	Device& m_device;
+	ThreadPool& m_threadPool;
+
+	std::mutex m_mutex;
+	std::vector<std::function<void()>> m_builds = {};
+};
+
+} // FFL
+
+#endif // PIPELINEBUILDSERVICE_HPP
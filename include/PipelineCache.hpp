@@ -0,0 +1,90 @@
+#ifndef PIPELINECACHE_HPP
+#define PIPELINECACHE_HPP
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace FFL {
+
+class Device;
+class ShaderModule;
+
+// Device-wide VkPipelineCache persisted between runs
+// The file is only used when it was written by the same vendor, device, driver version and cache UUID, anything else
+// starts an empty cache that replaces it on save()
+class PipelineCache {
+public:
+	static constexpr uint32_t MAGIC = 0x43504646; // "FFPC"
+	static constexpr uint32_t VERSION = 1;
+
+	struct Header {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint64_t dataSize;
+		uint64_t dataHash;
+	};
+
+	PipelineCache(Device& p_device, const std::string& p_filePath);
+	~PipelineCache();
+
+	// Delete copy-constructors
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	VkPipelineCache getPipelineCache() const {return m_pipelineCache;}
+	// True when the cache started out with data from an earlier run
+	bool isWarm() const {return m_warm;}
+
+	// Writes the cache next to the file and renames it over, so a crash never leaves a truncated file
+	bool save();
+
+	// Pipelines report how long they took to create, the totals are logged on destruction
+	void recordCreation(std::chrono::nanoseconds p_duration);
+
+	// Graphics pipeline library parts shared by every pipeline with the same state, built by p_create on a miss
+	// p_key holds every field the part is built from, including the SPIR-V of p_shaders, and is compared in full
+	// Parts whose shaders are no longer loaded are dropped once no build holds those shaders
+	VkPipeline getLibrary(const std::string& p_key, const std::vector<std::shared_ptr<ShaderModule>>& p_shaders, const std::function<VkPipeline()>& p_create);
+private:
+	Device& m_device;
+	std::string m_filePath;
+	VkPipelineCache m_pipelineCache = VK_NULL_HANDLE;
+	bool m_warm = false;
+
+	std::mutex m_statsMutex;
+	uint32_t m_creationCount = 0;
+	std::chrono::nanoseconds m_creationTime = {};
+
+	struct LibraryPart {
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		std::vector<uint64_t> contentHashes = {};
+		// Modules of the last build that used the part, it may still be linking while they are alive
+		std::vector<std::weak_ptr<ShaderModule>> shaders = {};
+	};
+
+	std::mutex m_libraryMutex;
+	std::unordered_map<std::string, LibraryPart> m_libraries = {};
+
+	Header expectedHeader() const;
+	// m_libraryMutex must be held
+	void evictLibraries();
+};
+
+} // FFL
+
+#endif // PIPELINECACHE_HPP
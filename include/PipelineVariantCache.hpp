@@ -0,0 +1,52 @@
+#ifndef PIPELINEVARIANTCACHE_HPP
+#define PIPELINEVARIANTCACHE_HPP
+
+#include "Device.hpp"
+#include "Pipeline.hpp"
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace FFL {
+
+// Pipelines built from the same shaders and state that differ in their specialization constants
+// Each variant is built the first time its key is asked for and kept, later frames switch between them for free
+class PipelineVariantCache {
+public:
+	// Adds the specialization constants, and any other state that differs, of the variant p_variantKey
+	using ConfigureFunction = std::function<void(uint64_t p_variantKey, PipelineConfigInfo& p_configInfo)>;
+
+	PipelineVariantCache(Device& p_device, const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath, ConfigureFunction p_configure);
+
+	// Delete copy-constructors
+	PipelineVariantCache(const PipelineVariantCache&) = delete;
+	PipelineVariantCache& operator=(const PipelineVariantCache&) = delete;
+
+	// Builds the variant on a miss, which stalls the calling thread for the pipeline compile
+	Pipeline& get(uint64_t p_variantKey);
+	// Queues the missing variants on Device::pipelineBuilds(), get() then only waits for builds still running
+	void warmUp(const std::vector<uint64_t>& p_variantKeys);
+
+	bool contains(uint64_t p_variantKey) const {return m_variants.count(p_variantKey) > 0;}
+	size_t size() const {return m_variants.size();}
+private:
+	Device& m_device;
+	std::unique_ptr<PipelineConfigInfo> m_configInfo;
+	std::string m_vertPath;
+	std::string m_fragPath;
+	ConfigureFunction m_configure;
+
+	std::unordered_map<uint64_t, std::unique_ptr<Pipeline>> m_variants = {};
+
+	void configureVariant(uint64_t p_variantKey, PipelineConfigInfo& p_configInfo) const;
+};
+
+} // FFL
+
+#endif // PIPELINEVARIANTCACHE_HPP
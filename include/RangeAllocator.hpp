@@ -0,0 +1,35 @@
+#ifndef RANGEALLOCATOR_HPP
+#define RANGEALLOCATOR_HPP
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <map>
+
+namespace FFL {
+
+// First-fit allocator over an abstract range [0, capacity), freed ranges coalesce with their neighbours
+// Only does the bookkeeping, the caller decides what the units are (vertices, bytes, ...)
+class RangeAllocator {
+public:
+	static constexpr uint64_t INVALID_OFFSET = UINT64_MAX;
+
+	RangeAllocator(uint64_t p_capacity = 0);
+
+	// Returns INVALID_OFFSET when no free range is large enough, p_alignment must be a power of two
+	uint64_t allocate(uint64_t p_size, uint64_t p_alignment = 1);
+	void free(uint64_t p_offset, uint64_t p_size);
+
+	uint64_t capacity() const {return m_capacity;}
+	uint64_t freeSize() const {return m_freeSize;}
+	uint64_t largestFreeRange() const;
+	size_t freeRangeCount() const {return m_freeRanges.size();}
+private:
+	uint64_t m_capacity = 0;
+	uint64_t m_freeSize = 0;
+	std::map<uint64_t, uint64_t> m_freeRanges = {}; // Offset to size
+};
+
+} // FFL
+
+#endif // RANGEALLOCATOR_HPP
@@ -0,0 +1,83 @@
+#ifndef SHADERLIBRARY_HPP
+#define SHADERLIBRARY_HPP
+
+#include "MappedFile.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace FFL {
+
+class Device;
+
+// SPIR-V mapped straight from disk and, unless the device takes SPIR-V inline, the VkShaderModule built from it
+class ShaderModule {
+public:
+	ShaderModule(Device& p_device, const std::string& p_filePath, std::unique_ptr<MappedFile> p_file, uint64_t p_contentHash);
+	~ShaderModule();
+
+	// Delete copy-constructors
+	ShaderModule(const ShaderModule&) = delete;
+	ShaderModule& operator=(const ShaderModule&) = delete;
+
+	// VK_NULL_HANDLE with Device::supportsInlineShaders()
+	VkShaderModule getShaderModule() const {return m_shaderModule;}
+	const std::string& getFilePath() const {return m_filePath;}
+	uint64_t getContentHash() const {return m_contentHash;}
+	const uint32_t* code() const {return reinterpret_cast<const uint32_t*>(m_file->data());}
+	size_t codeSize() const {return m_file->size();}
+
+	// Points p_stageInfo at this shader, chaining p_moduleInfo instead when there is no VkShaderModule
+	// p_moduleInfo has to outlive the vkCreate*Pipelines call
+	void fillStageInfo(VkShaderStageFlagBits p_stage, VkPipelineShaderStageCreateInfo& p_stageInfo, VkShaderModuleCreateInfo& p_moduleInfo) const;
+private:
+	Device& m_device;
+	std::string m_filePath;
+	std::unique_ptr<MappedFile> m_file;
+	uint64_t m_contentHash;
+	VkShaderModule m_shaderModule = VK_NULL_HANDLE;
+};
+
+// Builds each shader once, keyed by path and by content so copies of a file under another path share a module
+// Modules live as long as someone holds them, the library only keeps weak references
+class ShaderLibrary {
+public:
+	ShaderLibrary(Device& p_device);
+
+	// Delete copy-constructors
+	ShaderLibrary(const ShaderLibrary&) = delete;
+	ShaderLibrary& operator=(const ShaderLibrary&) = delete;
+
+	// Safe to call from several threads
+	std::shared_ptr<ShaderModule> load(const std::string& p_filePath);
+
+	// The next load() maps p_filePath again, modules already handed out keep their old code
+	void invalidate(const std::string& p_filePath);
+
+	// Modules still held by at least one pipeline
+	size_t getModuleCount();
+
+	// True while the last load() of some path produced this content, whether or not its module is still held
+	bool isLoaded(uint64_t p_contentHash);
+private:
+	Device& m_device;
+
+	std::mutex m_mutex;
+	std::unordered_map<std::string, std::weak_ptr<ShaderModule>> m_paths = {};
+	std::unordered_map<uint64_t, std::weak_ptr<ShaderModule>> m_contents = {};
+	std::unordered_map<std::string, uint64_t> m_loadedHashes = {};
+
+	void evictExpired();
+};
+
+} // FFL
+
+#endif // SHADERLIBRARY_HPP
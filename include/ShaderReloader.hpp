@@ -0,0 +1,112 @@
+#ifndef SHADERRELOADER_HPP
+#define SHADERRELOADER_HPP
+
+#include "ThreadPool.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace FFL {
+
+class Device;
+class Pipeline;
+class ShaderModule;
+
+// Watches shaders/ for GLSL edits, recompiles them to SPIR-V and rebuilds every pipeline using them
+// Compiling and pipeline creation run on the thread pool, update() swaps finished pipelines in between frames and
+// destroys the ones they replaced once their frames have retired
+// Only watches when built with FFL_SHADER_HOT_RELOAD
+class ShaderReloader {
+public:
+	ShaderReloader(Device& p_device, ThreadPool& p_threadPool = ThreadPool::shared());
+	~ShaderReloader();
+
+	// Delete copy-constructors
+	ShaderReloader(const ShaderReloader&) = delete;
+	ShaderReloader& operator=(const ShaderReloader&) = delete;
+
+	// Pipelines register themselves on creation
+	void track(Pipeline* p_pipeline);
+	// Waits for rebuilds of p_pipeline that are still running
+	void untrack(Pipeline* p_pipeline);
+
+	// Builds p_pipeline again from its current shaders and swaps it in from update(), like after an edit
+	void rebuild(Pipeline* p_pipeline);
+
+	// Call once per frame after Renderer::beginFrame, from the thread that submits to the graphics queue
+	void update();
+
+	bool isWatching() const;
+private:
+	struct BuildResult {
+		VkPipeline pipeline = VK_NULL_HANDLE;
+		std::vector<std::shared_ptr<ShaderModule>> shaders = {};
+	};
+
+	struct Compile {
+		std::string sourceName = {};
+		std::future<bool> result = {};
+	};
+
+	struct Rebuild {
+		Pipeline* pipeline = nullptr;
+		std::future<BuildResult> result = {};
+	};
+
+	struct RetiredPipeline {
+		uint64_t frame = 0; // Destroyed once update() reaches this frame
+		VkPipeline pipeline = VK_NULL_HANDLE;
+	};
+
+	Device& m_device;
+	ThreadPool& m_threadPool;
+	std::string m_shaderDir;
+
+#ifdef __linux__
+	int m_inotify = -1;
+#else
+	bool m_watching = false;
+	std::unordered_map<std::string, std::filesystem::file_time_type> m_writeTimes = {};
+	std::chrono::steady_clock::time_point m_nextPoll = {};
+#endif
+
+	std::mutex m_mutex;
+	std::vector<Pipeline*> m_pipelines = {};
+	std::vector<Rebuild> m_rebuilds = {};
+
+	// Sources being compiled, and those among them that changed again in the meantime
+	std::set<std::string> m_compiling = {};
+	std::set<std::string> m_stale = {};
+	std::vector<Compile> m_compiles = {};
+
+	uint64_t m_frame = 0;
+	std::vector<RetiredPipeline> m_retired = {};
+
+	std::set<std::string> pollChanges();
+	void startCompile(const std::string& p_sourceName);
+	void startRebuilds(const std::string& p_sourceName);
+	// m_mutex must be held
+	void submitRebuild(Pipeline* p_pipeline);
+	void retirePipelines();
+
+	static bool isShaderSource(const std::string& p_fileName);
+	static bool compileShader(const std::string& p_sourcePath, const std::string& p_spirvPath);
+	// Runs p_arguments[0] found through PATH without a shell, returns its exit code or -1 if it could not be started
+	static int runProcess(const std::vector<std::string>& p_arguments);
+};
+
+} // FFL
+
+#endif // SHADERRELOADER_HPP
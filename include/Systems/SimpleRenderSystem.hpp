@@ -1,16 +1,21 @@
 #ifndef SIMPLERENDERSYSTEM_HPP
 #define SIMPLERENDERSYSTEM_HPP
 
+#include "Buffer.hpp"
 #include "Camera.hpp"
+#include "Descriptors.hpp"
 #include "Device.hpp"
 #include "FrameInfo.hpp"
 #include "GameObject.hpp"
 #include "Pipeline.hpp"
+#include "PipelineVariantCache.hpp"
 
 // Libraries
 #include <vulkan/vulkan_core.h>
 
 // STD
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <vector>
 
@@ -18,6 +23,10 @@ namespace FFL {
 
 class SimpleRenderSystem {
 public:
+	// Lighting features, each combination with each light count bucket is its own pipeline variant
+	static constexpr uint32_t FEATURE_SPECULAR = 1 << 0;
+	static constexpr uint32_t ALL_FEATURES = FEATURE_SPECULAR;
+
 	SimpleRenderSystem(Device& p_device, VkRenderPass p_renderPass, VkDescriptorSetLayout p_globalSetLayout);
 	~SimpleRenderSystem();
 
@@ -25,15 +34,73 @@ public:
 	SimpleRenderSystem(const SimpleRenderSystem&) = delete;
 	SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
+	// Selects levels of detail and culls meshlets on the GPU, call once per frame before the render pass begins
+	void prepareFrame(FrameInfo& p_frameInfo);
+	// Draws what the last prepareFrame selected
 	void renderGameObjects(FrameInfo& p_frameInfo);
+
+	// Each step up doubles the screen-space error a level of detail may have, negative values favour detail
+	void setLodBias(float p_lodBias) {m_lodBias = p_lodBias;}
+	float getLodBias() const {return m_lodBias;}
+
+	void setFeatures(uint32_t p_features) {m_features = p_features;}
+	uint32_t getFeatures() const {return m_features;}
+	// Off draws with the generic shader every frame, for comparing it against the specialized variants
+	void setSpecializeVariants(bool p_specializeVariants) {m_specializeVariants = p_specializeVariants;}
+
+	// Key of the variant for p_lightCount lights, rounded up to a light count bucket, and p_features
+	static uint64_t variantKey(int p_lightCount, uint32_t p_features);
+	// Adds the specialization constants of p_variantKey, the configure function of both variant caches
+	static void configureVariant(uint64_t p_variantKey, PipelineConfigInfo& p_configInfo);
 private:
+	struct DrawItem {
+		GameObject* object = nullptr;
+		uint32_t lod = 0;
+		uint32_t firstCommand = UINT32_MAX; // Into the frame's draw command buffer, UINT32_MAX draws the LOD directly
+	};
+
+	struct RetiredSet {
+		uint64_t frame = 0; // Freed once prepareFrame reaches this frame
+		VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	};
+
 	Device& m_device;
 
+	float m_lodBias = 0.0f;
+	uint32_t m_features = ALL_FEATURES;
+	bool m_specializeVariants = true;
+
 	VkPipelineLayout m_pipelineLayout;
-	std::unique_ptr<Pipeline> m_pipeline;
+	std::unique_ptr<PipelineVariantCache> m_pipelines;
+	std::unique_ptr<PipelineVariantCache> m_meshletPipelines;
+
+	VkPipelineLayout m_cullPipelineLayout;
+	std::unique_ptr<Pipeline> m_cullPipeline;
+	std::unique_ptr<DescriptorPool> m_cullPool;
+	std::unique_ptr<DescriptorSetLayout> m_meshletSetLayout;
+	std::unique_ptr<DescriptorSetLayout> m_commandSetLayout;
+	// Keyed by the model's control block, which the key keeps alive, so a new model never finds the set of a
+	// destroyed one even at the same address
+	std::map<std::weak_ptr<Model>, VkDescriptorSet, std::owner_less<>> m_meshletSets = {};
+	std::vector<RetiredSet> m_retiredSets = {};
+	uint64_t m_frame = 0;
+
+	// One per frame in flight, grown when a frame needs more commands than fit
+	std::vector<std::unique_ptr<Buffer>> m_drawCommandBuffers = {};
+	std::vector<VkDescriptorSet> m_drawCommandSets = {};
+
+	std::vector<DrawItem> m_drawItems = {};
 
 	void createPipelineLayout(VkDescriptorSetLayout p_globalSetLayout);
 	void createPipeline(VkRenderPass p_renderPass);
+	void createCullPipeline();
+
+	uint64_t selectVariant(int p_lightCount) const;
+
+	VkDescriptorSet getMeshletSet(const std::shared_ptr<Model>& p_model);
+	// Frees the sets of models destroyed MAX_FRAMES_IN_FLIGHT frames ago and retires those of models destroyed since
+	void retireMeshletSets();
+	void reserveDrawCommands(int p_frameIndex, uint32_t p_commandCount);
 };
 
 } // FFL
@@ -0,0 +1,62 @@
+#ifndef THREADPOOL_HPP
+#define THREADPOOL_HPP
+
+// STD
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace FFL {
+
+class ThreadPool {
+public:
+	ThreadPool(uint32_t p_threadCount = defaultThreadCount());
+	~ThreadPool();
+
+	// Delete copy-constructors
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Process-wide pool sized to the machine, shared by the asset and pipeline workers
+	static ThreadPool& shared();
+	static uint32_t defaultThreadCount();
+
+	uint32_t threadCount() const {return static_cast<uint32_t>(m_threads.size());}
+
+	template<typename F>
+	std::future<std::invoke_result_t<F>> submit(F&& p_task) {
+		using Result = std::invoke_result_t<F>;
+
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(p_task));
+		std::future<Result> future = task->get_future();
+
+		enqueue([task]() {(*task)();});
+
+		return future;
+	}
+
+	// Runs p_body(i) for every i in [0, p_count) and blocks until all are done
+	// The calling thread works through the range too, so this is safe to call from inside a pool task
+	void parallelFor(size_t p_count, const std::function<void(size_t)>& p_body);
+private:
+	std::vector<std::thread> m_threads;
+	std::deque<std::function<void()>> m_tasks;
+	std::mutex m_mutex;
+	std::condition_variable m_condition;
+	bool m_stopping = false;
+
+	void enqueue(std::function<void()> p_task);
+	void workerLoop();
+};
+
+} // FFL
+
+#endif // THREADPOOL_HPP
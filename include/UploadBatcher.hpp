@@ -0,0 +1,85 @@
+#ifndef UPLOADBATCHER_HPP
+#define UPLOADBATCHER_HPP
+
+#include "Buffer.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace FFL {
+
+class Device;
+
+// Batches transfers into one command buffer, sourcing them from a persistently mapped staging ring
+// Every submit() signals a fence, ring space of a batch is reclaimed once its fence has signalled
+// Not thread-safe, use it from the thread that submits to the graphics queue
+class UploadBatcher {
+public:
+	static constexpr VkDeviceSize DEFAULT_RING_SIZE = 64 * 1024 * 1024;
+	// Satisfies the offset rules of buffer copies and of buffer to image copies for every format up to 16 bytes per texel
+	static constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+
+	UploadBatcher(Device& p_device, VkDeviceSize p_ringSize = DEFAULT_RING_SIZE);
+	~UploadBatcher();
+
+	// Delete copy-constructors
+	UploadBatcher(const UploadBatcher&) = delete;
+	UploadBatcher& operator=(const UploadBatcher&) = delete;
+
+	// Reserves p_size bytes of staging memory that are copied to p_dst at p_dstOffset when the batch is submitted
+	// Fill the returned memory before staging anything else, a full ring submits the batch to make room
+	// Requests larger than the ring get a dedicated staging buffer
+	void* stageBuffer(VkBuffer p_dst, VkDeviceSize p_size, VkDeviceSize p_dstOffset = 0);
+	// Same for the first layer(s) of p_image, which must be in VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+	void* stageImage(VkImage p_image, uint32_t p_w, uint32_t p_h, uint32_t p_layerCount, VkDeviceSize p_size);
+	void uploadBuffer(VkBuffer p_dst, const void* p_data, VkDeviceSize p_size, VkDeviceSize p_dstOffset = 0);
+
+	// Records device to device copies into the same batch
+	void copyBuffer(VkBuffer p_src, VkBuffer p_dst, VkDeviceSize p_size);
+	void copyBufferToImage(VkBuffer p_buffer, VkImage p_image, uint32_t p_w, uint32_t p_h, uint32_t p_layerCount);
+
+	// Submits everything recorded so far and returns a ticket for it, 0 when nothing was recorded
+	uint64_t submit();
+	// Tickets complete in submission order
+	bool isComplete(uint64_t p_ticket);
+	void wait(uint64_t p_ticket);
+	// Submits and waits, for callers that need the data on the GPU before they continue
+	void flush();
+private:
+	struct Batch {
+		uint64_t ticket = 0;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		VkDeviceSize ringBytes = 0; // Including alignment and wrap-around padding
+		std::vector<std::unique_ptr<Buffer>> dedicatedBuffers = {};
+	};
+
+	Device& m_device;
+
+	std::unique_ptr<Buffer> m_ring;
+	uint8_t* m_ringMemory = nullptr;
+	VkDeviceSize m_ringSize = 0;
+	VkDeviceSize m_head = 0; // Next free byte
+	VkDeviceSize m_used = 0; // Bytes between the oldest in-flight allocation and m_head
+
+	Batch m_recording = {};
+	std::deque<Batch> m_inFlight = {};
+	uint64_t m_nextTicket = 1;
+	uint64_t m_completedTicket = 0;
+
+	VkCommandBuffer recordingCommandBuffer();
+	// Returns the staging buffer and offset for p_size bytes, submitting and waiting when the ring is full
+	VkBuffer allocate(VkDeviceSize p_size, VkDeviceSize& p_offset, void*& p_memory);
+	bool tryAllocate(VkDeviceSize p_size, VkDeviceSize& p_offset);
+	void retire(bool p_waitOldest);
+};
+
+} // FFL
+
+#endif // UPLOADBATCHER_HPP
@@ -2,6 +2,9 @@
 #define UTILS_HPP
 
 // STD
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
 
 namespace FFL {
@@ -13,6 +16,48 @@ void hashCombine(std::size_t& p_seed, const T& p_v, const Rest&... p_rest) {
 	(hashCombine(p_seed, p_rest), ...);
 };
 
+// 64x64 -> 128 bit multiply folded back to 64 bits, the core mixer of wyhash
+inline uint64_t hashMix(uint64_t p_a, uint64_t p_b) {
+#ifdef __SIZEOF_INT128__
+	__uint128_t product = static_cast<__uint128_t>(p_a) * p_b;
+	return static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+#else
+	uint64_t aLo = p_a & 0xffffffff, aHi = p_a >> 32;
+	uint64_t bLo = p_b & 0xffffffff, bHi = p_b >> 32;
+	uint64_t loLo = aLo * bLo, hiLo = aHi * bLo, loHi = aLo * bHi, hiHi = aHi * bHi;
+	uint64_t cross = (loLo >> 32) + (hiLo & 0xffffffff) + loHi;
+	uint64_t hi = hiHi + (hiLo >> 32) + (cross >> 32);
+	uint64_t lo = (cross << 32) | (loLo & 0xffffffff);
+	return lo ^ hi;
+#endif
+}
+
+// Hashes raw bytes 16 at a time, suitable for large buffers such as whole source files
+inline uint64_t hashBytes(const void* p_data, size_t p_size, uint64_t p_seed = 0) {
+	constexpr uint64_t k0 = 0xa0761d6478bd642full;
+	constexpr uint64_t k1 = 0xe7037ed1a0b428dbull;
+
+	const uint8_t* bytes = static_cast<const uint8_t*>(p_data);
+	uint64_t seed = p_seed ^ k0;
+
+	size_t remaining = p_size;
+	while(remaining >= 16) {
+		uint64_t a, b;
+		memcpy(&a, bytes, 8);
+		memcpy(&b, bytes + 8, 8);
+		seed = hashMix(a ^ k1, b ^ seed);
+
+		bytes += 16;
+		remaining -= 16;
+	}
+
+	uint64_t tail[2] = {};
+	memcpy(tail, bytes, remaining);
+	seed = hashMix(tail[0] ^ k1, tail[1] ^ seed);
+
+	return hashMix(seed ^ k0, static_cast<uint64_t>(p_size) ^ k1);
+}
+
 }
 
 #endif
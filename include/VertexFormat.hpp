@@ -0,0 +1,280 @@
+#ifndef VERTEXFORMAT_HPP
+#define VERTEXFORMAT_HPP
+
+// Libraries
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <vector>
+
+namespace FFL {
+
+// Maps quantized positions into [-1, 1], the inverse is applied on the GPU through the model matrix
+struct VertexQuantization {
+	glm::vec3 positionCenter = {0.0f, 0.0f, 0.0f};
+	glm::vec3 positionInverseExtent = {1.0f, 1.0f, 1.0f};
+};
+
+inline uint16_t quantizeHalf(float p_value) {
+	uint32_t bits;
+	memcpy(&bits, &p_value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t magnitude = bits & 0x7fffffff;
+
+	// Rebias the exponent and round to nearest, denormals flush to zero
+	uint32_t half = (magnitude - (112 << 23) + (1 << 12)) >> 13;
+	half = magnitude < (113 << 23) ? 0 : half;
+	half = magnitude >= (143 << 23) ? 0x7c00 : half;
+	half = magnitude > (255 << 23) ? 0x7e00 : half;
+
+	return static_cast<uint16_t>(sign | half);
+}
+
+inline int16_t quantizeSnorm16(float p_value) {
+	return static_cast<int16_t>(std::lround(std::clamp(p_value, -1.0f, 1.0f) * 32767.0f));
+}
+
+inline uint8_t quantizeUnorm8(float p_value) {
+	return static_cast<uint8_t>(std::clamp(p_value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2
+inline glm::vec2 encodeOctahedral(const glm::vec3& p_normal) {
+	float sum = std::abs(p_normal.x) + std::abs(p_normal.y) + std::abs(p_normal.z);
+	if(sum == 0.0f) {
+		return {0.0f, 0.0f};
+	}
+
+	glm::vec2 result = {p_normal.x / sum, p_normal.y / sum};
+	if(p_normal.z < 0.0f) {
+		glm::vec2 folded = {
+			(1.0f - std::abs(result.y)) * (result.x >= 0.0f ? 1.0f : -1.0f),
+			(1.0f - std::abs(result.x)) * (result.y >= 0.0f ? 1.0f : -1.0f),
+		};
+
+		result = folded;
+	}
+
+	return result;
+}
+
+// Attribute encodings, each converts one member of a source vertex into FORMAT
+struct PositionFloat3 {
+	static constexpr VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+	static constexpr uint32_t SIZE = 3 * sizeof(float);
+	static constexpr bool QUANTIZED_POSITION = false;
+
+	template<typename V>
+	static void encode(const V& p_vertex, const VertexQuantization&, uint8_t* p_destination) {
+		memcpy(p_destination, &p_vertex.position, SIZE);
+	}
+};
+
+// Fourth component is padding, three-channel 16-bit formats are rarely supported for vertex input
+struct PositionSnorm16 {
+	static constexpr VkFormat FORMAT = VK_FORMAT_R16G16B16A16_SNORM;
+	static constexpr uint32_t SIZE = 4 * sizeof(int16_t);
+	static constexpr bool QUANTIZED_POSITION = true;
+
+	template<typename V>
+	static void encode(const V& p_vertex, const VertexQuantization& p_quantization, uint8_t* p_destination) {
+		glm::vec3 normalized = (p_vertex.position - p_quantization.positionCenter) * p_quantization.positionInverseExtent;
+		int16_t packed[4] = {quantizeSnorm16(normalized.x), quantizeSnorm16(normalized.y), quantizeSnorm16(normalized.z), 32767};
+
+		memcpy(p_destination, packed, SIZE);
+	}
+};
+
+struct ColorFloat3 {
+	static constexpr VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+	static constexpr uint32_t SIZE = 3 * sizeof(float);
+	static constexpr bool QUANTIZED_POSITION = false;
+
+	template<typename V>
+	static void encode(const V& p_vertex, const VertexQuantization&, uint8_t* p_destination) {
+		memcpy(p_destination, &p_vertex.color, SIZE);
+	}
+};
+
+struct ColorUnorm8 {
+	static constexpr VkFormat FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+	static constexpr uint32_t SIZE = 4 * sizeof(uint8_t);
+	static constexpr bool QUANTIZED_POSITION = false;
+
+	template<typename V>
+	static void encode(const V& p_vertex, const VertexQuantization&, uint8_t* p_destination) {
+		p_destination[0] = quantizeUnorm8(p_vertex.color.x);
+		p_destination[1] = quantizeUnorm8(p_vertex.color.y);
+		p_destination[2] = quantizeUnorm8(p_vertex.color.z);
+		p_destination[3] = 255;
+	}
+};
+
+struct NormalFloat3 {
+	static constexpr VkFormat FORMAT = VK_FORMAT_R32G32B32_SFLOAT;
+	static constexpr uint32_t SIZE = 3 * sizeof(float);
+	static constexpr bool QUANTIZED_POSITION = false;
+
+	template<typename V>
+	static void encode(const V& p_vertex, const VertexQuantization&, uint8_t* p_destination) {
+		memcpy(p_destination, &p_vertex.normal, SIZE);
+	}
+};
+
+// Decoded in the vertex shader, see simple_shader_quantized.vert
+struct NormalOct16 {
+	static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_SNORM;
+	static constexpr uint32_t SIZE = 2 * sizeof(int16_t);
+	static constexpr bool QUANTIZED_POSITION = false;
+
+	template<typename V>
+	static void encode(const V& p_vertex, const VertexQuantization&, uint8_t* p_destination) {
+		glm::vec2 octahedral = encodeOctahedral(p_vertex.normal);
+		int16_t packed[2] = {quantizeSnorm16(octahedral.x), quantizeSnorm16(octahedral.y)};
+
+		memcpy(p_destination, packed, SIZE);
+	}
+};
+
+struct UvFloat2 {
+	static constexpr VkFormat FORMAT = VK_FORMAT_R32G32_SFLOAT;
+	static constexpr uint32_t SIZE = 2 * sizeof(float);
+	static constexpr bool QUANTIZED_POSITION = false;
+
+	template<typename V>
+	static void encode(const V& p_vertex, const VertexQuantization&, uint8_t* p_destination) {
+		memcpy(p_destination, &p_vertex.uv, SIZE);
+	}
+};
+
+// Half floats keep tiling UVs outside [0, 1] usable, unlike unorm16
+struct UvHalf2 {
+	static constexpr VkFormat FORMAT = VK_FORMAT_R16G16_SFLOAT;
+	static constexpr uint32_t SIZE = 2 * sizeof(uint16_t);
+	static constexpr bool QUANTIZED_POSITION = false;
+
+	template<typename V>
+	static void encode(const V& p_vertex, const VertexQuantization&, uint8_t* p_destination) {
+		uint16_t packed[2] = {quantizeHalf(p_vertex.uv.x), quantizeHalf(p_vertex.uv.y)};
+
+		memcpy(p_destination, packed, SIZE);
+	}
+};
+
+// Interleaved single-binding vertex format, attribute i is bound to shader location i
+// The first attribute is the position, the split layout moves it into a tightly packed binding 0 of its own and
+// interleaves the rest in binding 1, so passes that only need positions fetch POSITION_STRIDE bytes per vertex
+template<typename... Attributes>
+struct VertexLayout {
+	using Position = std::tuple_element_t<0, std::tuple<Attributes...>>;
+
+	static constexpr uint32_t ATTRIBUTE_COUNT = sizeof...(Attributes);
+	static constexpr uint32_t STRIDE = (Attributes::SIZE + ...);
+	static constexpr uint32_t POSITION_STRIDE = Position::SIZE;
+	static constexpr bool QUANTIZED_POSITION = (Attributes::QUANTIZED_POSITION || ...);
+
+	static constexpr VkVertexInputBindingDescription BINDING = {0, STRIDE, VK_VERTEX_INPUT_RATE_VERTEX};
+
+	static constexpr std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> makeAttributes() {
+		std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> attributes = {};
+
+		const VkFormat formats[] = {Attributes::FORMAT...};
+		const uint32_t sizes[] = {Attributes::SIZE...};
+		uint32_t offset = 0;
+
+		for(uint32_t i = 0; i < ATTRIBUTE_COUNT; i++) {
+			attributes[i] = {i, 0, formats[i], offset};
+			offset += sizes[i];
+		}
+
+		return attributes;
+	}
+
+	static constexpr std::array<VkVertexInputAttributeDescription, ATTRIBUTE_COUNT> ATTRIBUTES = makeAttributes();
+
+	static std::vector<VkVertexInputBindingDescription> getBindingDescriptions() {
+		return {BINDING};
+	}
+
+	static std::vector<VkVertexInputAttributeDescription> getAttributeDescriptions() {
+		return {ATTRIBUTES.begin(), ATTRIBUTES.end()};
+	}
+
+	static std::vector<VkVertexInputBindingDescription> getSplitBindingDescriptions() {
+		return {{0, POSITION_STRIDE, VK_VERTEX_INPUT_RATE_VERTEX}, {1, STRIDE - POSITION_STRIDE, VK_VERTEX_INPUT_RATE_VERTEX}};
+	}
+
+	static std::vector<VkVertexInputAttributeDescription> getSplitAttributeDescriptions() {
+		std::vector<VkVertexInputAttributeDescription> attributes = {ATTRIBUTES.begin(), ATTRIBUTES.end()};
+
+		for(uint32_t i = 1; i < ATTRIBUTE_COUNT; i++) {
+			attributes[i].binding = 1;
+			attributes[i].offset -= POSITION_STRIDE;
+		}
+
+		return attributes;
+	}
+
+	// Location 0 only, p_stride is POSITION_STRIDE for the split layout and STRIDE for the interleaved one
+	static std::vector<VkVertexInputBindingDescription> getPositionBindingDescriptions(uint32_t p_stride) {
+		return {{0, p_stride, VK_VERTEX_INPUT_RATE_VERTEX}};
+	}
+
+	static std::vector<VkVertexInputAttributeDescription> getPositionAttributeDescriptions() {
+		return {ATTRIBUTES[0]};
+	}
+
+	// Writes p_count vertices of STRIDE bytes each, p_destination is usually mapped staging memory
+	template<typename V>
+	static void encode(const V* p_vertices, size_t p_count, const VertexQuantization& p_quantization, void* p_destination) {
+		uint8_t* destination = static_cast<uint8_t*>(p_destination);
+
+		for(size_t i = 0; i < p_count; i++) {
+			uint8_t* attribute = destination + i * STRIDE;
+			((Attributes::encode(p_vertices[i], p_quantization, attribute), attribute += Attributes::SIZE), ...);
+		}
+	}
+
+	// Split layout in two passes, so each staging range is filled before the next one is reserved
+	// Writes p_count positions of POSITION_STRIDE bytes
+	template<typename V>
+	static void encodePositions(const V* p_vertices, size_t p_count, const VertexQuantization& p_quantization, void* p_positions) {
+		encodeSplitPositions<V, Attributes...>(p_vertices, p_count, p_quantization, static_cast<uint8_t*>(p_positions));
+	}
+
+	// Writes p_count attribute sets of STRIDE - POSITION_STRIDE bytes, everything but the position
+	template<typename V>
+	static void encodeAttributes(const V* p_vertices, size_t p_count, const VertexQuantization& p_quantization, void* p_attributes) {
+		encodeSplitAttributes<V, Attributes...>(p_vertices, p_count, p_quantization, static_cast<uint8_t*>(p_attributes));
+	}
+private:
+	template<typename V, typename PositionAttribute, typename... Rest>
+	static void encodeSplitPositions(const V* p_vertices, size_t p_count, const VertexQuantization& p_quantization, uint8_t* p_positions) {
+		for(size_t i = 0; i < p_count; i++) {
+			PositionAttribute::encode(p_vertices[i], p_quantization, p_positions + i * POSITION_STRIDE);
+		}
+	}
+
+	template<typename V, typename PositionAttribute, typename... Rest>
+	static void encodeSplitAttributes(const V* p_vertices, size_t p_count, const VertexQuantization& p_quantization, uint8_t* p_attributes) {
+		for(size_t i = 0; i < p_count; i++) {
+			uint8_t* attribute = p_attributes + i * (STRIDE - POSITION_STRIDE);
+			((Rest::encode(p_vertices[i], p_quantization, attribute), attribute += Rest::SIZE), ...);
+		}
+	}
+};
+
+} // FFL
+
+#endif // VERTEXFORMAT_HPP
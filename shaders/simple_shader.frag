@@ -1,59 +1,66 @@
-#version 450
-
-layout(location = 0) in vec3 fragColor;
-layout(location = 1) in vec3 fragPosWorld;
-layout(location = 2) in vec3 fragNormalWorld;
-
-layout(location = 0) out vec4 outColor;
-
-struct PointLight {
-	vec4 position;
-	vec4 color;
-};
-
-layout(set = 0, binding = 0) uniform GlobalUniformBuffer {
-	mat4 projection;
-	mat4 view;
-	mat4 inverseView;
-	vec4 ambientLightColor;
-	PointLight pointLights[10];
-	int numLights;
-} ubo;
-
-layout(push_constant) uniform Push {
-	mat4 modelMatrix;
-	mat4 normalMatrix;
-} push;
-
-void main() {
-	vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
-	vec3 specularLight = vec3(0.0);
-	vec3 surfaceNormal = normalize(fragNormalWorld);
-
-	vec3 cameraPosWorld = ubo.inverseView[3].xyz;
-	vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
-
-	for(int i = 0; i < ubo.numLights; i++) {
-		PointLight light = ubo.pointLights[i];
-
-		vec3 directionToLight = light.position.xyz - fragPosWorld;
-		float attenuation = 1.0 / dot(directionToLight, directionToLight);
-
-		directionToLight = normalize(directionToLight);
-
-		float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
-		vec3 intensity = light.color.xyz * light.color.w * attenuation;
-
-		diffuseLight += intensity * cosAngIncidence;
-
-		// Specular Lighting
-		vec3 halfAngle = normalize(directionToLight + viewDirection);
-		float blinnTerm = dot(surfaceNormal, halfAngle);
-		blinnTerm = clamp(blinnTerm, 0, 1);
-		blinnTerm = pow(blinnTerm, 512.0); // Higher value -> Sharper highlighting
-		
-		specularLight += intensity * blinnTerm;
-	}
-
-	outColor = vec4(diffuseLight * fragColor + specularLight * fragColor, 1.0);
-}
+#version 450
+
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragPosWorld;
+layout(location = 2) in vec3 fragNormalWorld;
+
+layout(location = 0) out vec4 outColor;
+
+// Set per variant by SimpleRenderSystem, the defaults are the generic shader
+layout(constant_id = 0) const int MAX_LIGHT_COUNT = 10; // Lights past this are never read, fixes the loop bound
+layout(constant_id = 1) const bool SPECULAR_ENABLED = true;
+layout(constant_id = 2) const float SPECULAR_EXPONENT = 512.0; // Higher value -> Sharper highlighting
+
+struct PointLight {
+	vec4 position;
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUniformBuffer {
+	mat4 projection;
+	mat4 view;
+	mat4 inverseView;
+	vec4 ambientLightColor;
+	PointLight pointLights[10];
+	int numLights;
+} ubo;
+
+layout(push_constant) uniform Push {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+} push;
+
+void main() {
+	vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
+	vec3 specularLight = vec3(0.0);
+	vec3 surfaceNormal = normalize(fragNormalWorld);
+
+	vec3 cameraPosWorld = ubo.inverseView[3].xyz;
+	vec3 viewDirection = normalize(cameraPosWorld - fragPosWorld);
+
+	for(int i = 0; i < MAX_LIGHT_COUNT && i < ubo.numLights; i++) {
+		PointLight light = ubo.pointLights[i];
+
+		vec3 directionToLight = light.position.xyz - fragPosWorld;
+		float attenuation = 1.0 / dot(directionToLight, directionToLight);
+
+		directionToLight = normalize(directionToLight);
+
+		float cosAngIncidence = max(dot(surfaceNormal, directionToLight), 0);
+		vec3 intensity = light.color.xyz * light.color.w * attenuation;
+
+		diffuseLight += intensity * cosAngIncidence;
+
+		// Specular Lighting
+		if(SPECULAR_ENABLED) {
+			vec3 halfAngle = normalize(directionToLight + viewDirection);
+			float blinnTerm = dot(surfaceNormal, halfAngle);
+			blinnTerm = clamp(blinnTerm, 0, 1);
+			blinnTerm = pow(blinnTerm, SPECULAR_EXPONENT);
+
+			specularLight += intensity * blinnTerm;
+		}
+	}
+
+	outColor = vec4(diffuseLight * fragColor + specularLight * fragColor, 1.0);
+}
@@ -0,0 +1,49 @@
+#version 450
+
+// Quantized vertex format (FFL_QUANTIZED_VERTICES), position is in [-1, 1] and mapped back by the model matrix
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 color;
+layout(location = 2) in vec2 normal;
+layout(location = 3) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+
+struct PointLight {
+	vec4 position;
+	vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUniformBuffer {
+	mat4 projection;
+	mat4 view;
+	mat4 inverseView;
+	vec4 ambientLightColor;
+	PointLight pointLights[10];
+	int numLights;
+} ubo;
+
+layout(push_constant) uniform Push {
+	mat4 modelMatrix;
+	mat4 normalMatrix;
+} push;
+
+vec3 decodeOctahedral(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float t = max(-n.z, 0.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+
+	return normalize(n);
+}
+
+void main() {
+	vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+
+	gl_Position = ubo.projection * (ubo.view * positionWorld);
+
+	fragNormalWorld = normalize(mat3(push.normalMatrix) * decodeOctahedral(normal));
+	fragPosWorld = positionWorld.xyz;
+	fragColor = color;
+}
@@ -3,10 +3,15 @@
 #include "Camera.hpp"
 #include "Descriptors.hpp"
 #include "Device.hpp"
+#include "FrameArena.hpp"
 #include "FrameInfo.hpp"
+#include "FrameRing.hpp"
 #include "GameObject.hpp"
 #include "KeyboardMovementController.hpp"
+#include "MeshPool.hpp"
 #include "Pipeline.hpp"
+#include "PipelineBuildService.hpp"
+#include "ShaderReloader.hpp"
 #include "SwapChain.hpp"
 #include "Systems/SimpleRenderSystem.hpp"
 #include "Systems/PointLightSystem.hpp"
@@ -29,7 +34,10 @@
 #include <array>
 #include <cassert>
 #include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <iostream>
 #include <memory>
 #include <stdexcept>
 #include <utility>
@@ -39,8 +47,8 @@ namespace FFL {
 
 Application::Application() {
 	m_globalPool = DescriptorPool::Builder(m_device)
-		.setMaxSets(SwapChain::MAX_FRAMES_IN_FLIGHT)
-		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.setMaxSets(1)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1)
 		.build();
 
 	loadGameObjects();
@@ -49,27 +57,25 @@ Application::Application() {
 Application::~Application() {}
 
 void Application::run() {
-	std::vector<std::unique_ptr<Buffer>> uniformBufferObjectBuffers{SwapChain::MAX_FRAMES_IN_FLIGHT};
-	for(std::unique_ptr<Buffer>& ubo : uniformBufferObjectBuffers) {
-		ubo = std::make_unique<Buffer>(m_device, sizeof(GlobalUniformBufferObject), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT, m_device.properties.limits.minUniformBufferOffsetAlignment);
-		ubo->map();
-	}
+	// Every frame's uniforms are a slice of one ring, a single dynamic descriptor set serves them all
+	FrameRing frameRing{m_device};
 
 	std::unique_ptr<DescriptorSetLayout> globalSetLayout = DescriptorSetLayout::Builder(m_device)
-		.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, VK_SHADER_STAGE_ALL_GRAPHICS)
 		.build();
 
-	std::vector<VkDescriptorSet> globalDescriptorSets(SwapChain::MAX_FRAMES_IN_FLIGHT);
-	for(size_t i = 0; i < globalDescriptorSets.size(); i++) {
-		VkDescriptorBufferInfo bufferInfo = uniformBufferObjectBuffers[i]->descriptorInfo();
-		DescriptorWriter(*globalSetLayout, *m_globalPool)
-			.writeBuffer(0, &bufferInfo)
-			.build(globalDescriptorSets[i]);
-	}
+	VkDescriptorSet globalDescriptorSet;
+	VkDescriptorBufferInfo bufferInfo = frameRing.descriptorInfo(sizeof(GlobalUniformBufferObject));
+	DescriptorWriter(*globalSetLayout, *m_globalPool)
+		.writeBuffer(0, &bufferInfo)
+		.build(globalDescriptorSet);
 
 	SimpleRenderSystem simpleRenderSystem{m_device, m_renderer.getSwapchainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
 	PointLightSystem pointLightSystem{m_device, m_renderer.getSwapchainRenderPass(), globalSetLayout->getDescriptorSetLayout()};
 
+	// The systems only described their pipelines, the first frame waits for just the ones it binds
+	m_device.pipelineBuilds().submit();
+
 	Camera camera{};
 
 	GameObject viewerObject = GameObject::createGameObject();
@@ -87,6 +93,9 @@ void Application::run() {
 
 		deltaTime = glm::min(deltaTime, 1.0f);
 
+		m_modelRegistry.update();
+		m_device.memoryAllocator().update();
+
 		cameraController.moveInPlaneXZ(m_window.getGLFWwindow(), deltaTime, viewerObject);
 		camera.setViewYXZ(viewerObject.transform.translation, viewerObject.transform.rotation);
 
@@ -94,14 +103,23 @@ void Application::run() {
 		camera.setPerspectiveProjection(glm::radians(50.0f), aspect, 0.1f, 100.0f);
 
 		if(VkCommandBuffer commandBuffer = m_renderer.beginFrame()) {
+			m_device.meshPool().nextFrame();
+			m_device.shaderReloader().update();
+
 			int frameIndex = m_renderer.getFrameIndex();
+			frameRing.beginFrame(frameIndex);
+
+			FrameRing::Slice uniformSlice = frameRing.allocateUniform(sizeof(GlobalUniformBufferObject));
+
 			FrameInfo frameInfo = {
 				frameIndex,
 				deltaTime,
 				commandBuffer,
 				camera,
-				globalDescriptorSets[frameIndex],
-				m_gameObjects
+				globalDescriptorSet,
+				uniformSlice.dynamicOffset(),
+				m_gameObjects,
+				frameRing
 			};
 
 			// Update
@@ -110,10 +128,17 @@ void Application::run() {
 			uniformBufferObject.view = camera.getView();
 			uniformBufferObject.inverseView = camera.getInverseView();
 			pointLightSystem.update(frameInfo, uniformBufferObject);
-			uniformBufferObjectBuffers[frameIndex]->writeToBuffer(&uniformBufferObject);
-			uniformBufferObjectBuffers[frameIndex]->flush();
+			frameInfo.numLights = uniformBufferObject.numLights;
+
+			// Light slots past numLights are never read, skip copying them
+			char* uniformData = static_cast<char*>(uniformSlice.data);
+			memcpy(uniformData, &uniformBufferObject, offsetof(GlobalUniformBufferObject, pointLights));
+			memcpy(uniformData + offsetof(GlobalUniformBufferObject, pointLights), uniformBufferObject.pointLights, uniformBufferObject.numLights * sizeof(PointLight));
+			memcpy(uniformData + offsetof(GlobalUniformBufferObject, numLights), &uniformBufferObject.numLights, sizeof(int));
 
 			// Render
+			m_device.meshPool().defragment(commandBuffer);
+			simpleRenderSystem.prepareFrame(frameInfo);
 			m_renderer.beginSwapChainRenderPass(commandBuffer);
 			simpleRenderSystem.renderGameObjects(frameInfo);
 			pointLightSystem.render(frameInfo);
@@ -123,10 +148,14 @@ void Application::run() {
 	}
 
 	vkDeviceWaitIdle(m_device.device());
+
+	// For sizing FrameArena::DEFAULT_CHUNK_SIZE
+	FrameArena::Stats arenaStats = FrameArena::shared().getStats();
+	std::cout << "Frame arena high-water mark: " << arenaStats.highWaterBytes << " bytes, " << arenaStats.threadHighWaterBytes << " on one thread" << '\n';
 }
 
 void Application::loadGameObjects() {
-	std::shared_ptr<Model> model = Model::createModelFromFile(m_device, "models/flat_vase.obj");
+	std::shared_ptr<Model> model = m_modelRegistry.load("models/flat_vase.obj");
 
 	GameObject flatVase = GameObject::createGameObject();
 	flatVase.model = model;
@@ -134,7 +163,7 @@ void Application::loadGameObjects() {
 	flatVase.transform.scale = {3.0f, 1.5f, 3.0f};
 	m_gameObjects.emplace(flatVase.getId(), std::move(flatVase));
 
-	model = Model::createModelFromFile(m_device, "models/smooth_vase.obj");
+	model = m_modelRegistry.load("models/smooth_vase.obj");
 
 	GameObject smoothVase = GameObject::createGameObject();
 	smoothVase.model = model;
@@ -142,7 +171,7 @@ void Application::loadGameObjects() {
 	smoothVase.transform.scale = {3.0f, 1.5f, 3.0f};
 	m_gameObjects.emplace(smoothVase.getId(), std::move(smoothVase));
 
-	model = Model::createModelFromFile(m_device, "models/quad.obj");
+	model = m_modelRegistry.load("models/quad.obj");
 
 	GameObject floor = GameObject::createGameObject();
 	floor.model = model;
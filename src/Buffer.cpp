@@ -1,9 +1,11 @@
 #include "Buffer.hpp"
+#include "FrameArena.hpp"
 
 // Libraries
 #include <vulkan/vulkan_core.h>
 
 // STD
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 
@@ -13,26 +15,30 @@ Buffer::Buffer(Device& p_device, VkDeviceSize p_instanceSize, uint32_t p_instanc
 	m_alignmentSize = getAlignment(p_instanceSize, p_minOffsetAlignment);
 	m_bufferSize = m_alignmentSize * p_instanceCount;
 
-	m_device.createBuffer(m_bufferSize, p_usageFlags, p_memoryPropertyFlags, m_buffer, m_memory);
+	m_device.createBuffer(m_bufferSize, p_usageFlags, p_memoryPropertyFlags, m_buffer, m_allocation);
 }
 
 Buffer::~Buffer() {
 	unmap();
 	vkDestroyBuffer(m_device.device(), m_buffer, nullptr);
-	vkFreeMemory(m_device.device(), m_memory, nullptr);
+	m_device.memoryAllocator().free(m_allocation);
 }
 
-VkResult Buffer::map(VkDeviceSize p_size, VkDeviceSize p_offset) {
-	assert(m_buffer && m_memory && "Called map on buffer before creation");
+VkResult Buffer::map([[maybe_unused]] VkDeviceSize p_size, VkDeviceSize p_offset) {
+	assert(m_buffer && m_allocation.memory && "Called map on buffer before creation");
+	assert((p_size == VK_WHOLE_SIZE || p_offset + p_size <= m_bufferSize) && "Cannot map past the end of the buffer");
 
-	return vkMapMemory(m_device.device(), m_memory, p_offset, p_size, 0, &m_mapped);
+	if(m_allocation.mapped == nullptr) {
+		return VK_ERROR_MEMORY_MAP_FAILED;
+	}
+
+	m_mapped = static_cast<char*>(m_allocation.mapped) + p_offset;
+
+	return VK_SUCCESS;
 }
 
 void Buffer::unmap() {
-	if(m_mapped) {
-		vkUnmapMemory(m_device.device(), m_memory);
-		m_mapped = nullptr;
-	}
+	m_mapped = nullptr;
 }
 
 void Buffer::writeToBuffer(void* p_data, VkDeviceSize p_size, VkDeviceSize p_offset) {
@@ -40,21 +46,145 @@ void Buffer::writeToBuffer(void* p_data, VkDeviceSize p_size, VkDeviceSize p_off
 
 	if(p_size == VK_WHOLE_SIZE) {
 		memcpy(m_mapped, p_data, m_bufferSize);
+		markDirty(m_bufferSize, 0);
 	} else {
 		char* memOffset = static_cast<char*>(m_mapped);
 		memOffset += p_offset;
 		memcpy(memOffset, p_data, p_size);
+		markDirty(p_size, p_offset);
 	}
 }
 
-VkResult Buffer::flush(VkDeviceSize p_size, VkDeviceSize p_offset) {
+void Buffer::write(const void* p_data, VkDeviceSize p_size, VkDeviceSize p_offset) {
+	assert(m_mapped && "Can't copy to unmapped buffer");
+	assert(p_offset + p_size <= m_bufferSize && "Write out of range");
+
+	memcpy(static_cast<char*>(m_mapped) + p_offset, p_data, p_size);
+	markDirty(p_size, p_offset);
+}
+
+void Buffer::markDirty(VkDeviceSize p_size, VkDeviceSize p_offset) {
+	if(m_allocation.coherent || p_size == 0) {
+		return;
+	}
+
+	DirtyRange range = atomRange(p_size, p_offset);
+
+	// First range that ends at or after the new one begins, everything from there that starts before it ends merges
+	auto first = std::lower_bound(m_dirtyRanges.begin(), m_dirtyRanges.end(), range.begin, [](const DirtyRange& p_range, VkDeviceSize p_begin) {
+		return p_range.end < p_begin;
+	});
+
+	auto last = first;
+	while(last != m_dirtyRanges.end() && last->begin <= range.end) {
+		range.begin = std::min(range.begin, last->begin);
+		range.end = std::max(range.end, last->end);
+		last++;
+	}
+
+	if(first == last) {
+		m_dirtyRanges.insert(first, range);
+	} else {
+		*first = range;
+		m_dirtyRanges.erase(first + 1, last);
+	}
+}
+
+Buffer::DirtyRange Buffer::atomRange(VkDeviceSize p_size, VkDeviceSize p_offset) const {
+	// Host visible allocations start on an atom and span whole atoms, so rounding relative to the buffer is enough
+	VkDeviceSize atomSize = std::max<VkDeviceSize>(m_device.properties.limits.nonCoherentAtomSize, 1);
+	DirtyRange range = {};
+	range.begin = p_offset / atomSize * atomSize;
+	range.end = p_size == VK_WHOLE_SIZE ? m_allocation.size : std::min((p_offset + p_size + atomSize - 1) / atomSize * atomSize, m_allocation.size);
+
+	return range;
+}
+
+void Buffer::clearDirty(const DirtyRange& p_range) {
+	auto first = std::lower_bound(m_dirtyRanges.begin(), m_dirtyRanges.end(), p_range.begin, [](const DirtyRange& p_dirty, VkDeviceSize p_begin) {
+		return p_dirty.end <= p_begin;
+	});
+
+	auto last = first;
+	while(last != m_dirtyRanges.end() && last->begin < p_range.end) {
+		last++;
+	}
+
+	if(first == last) {
+		return;
+	}
+
+	// Parts of the first and last overlapping ranges outside p_range stay dirty
+	DirtyRange head = {first->begin, p_range.begin};
+	DirtyRange tail = {p_range.end, (last - 1)->end};
+
+	auto next = m_dirtyRanges.erase(first, last);
+	if(tail.begin < tail.end) {
+		next = m_dirtyRanges.insert(next, tail);
+	}
+
+	if(head.begin < head.end) {
+		m_dirtyRanges.insert(next, head);
+	}
+}
+
+VkResult Buffer::flushDirty() {
+	if(m_dirtyRanges.empty()) {
+		return VK_SUCCESS;
+	}
+
+	FrameVector<VkMappedMemoryRange> ranges = {};
+	appendDirtyRanges(ranges);
+	m_dirtyRanges.clear();
+
+	return vkFlushMappedMemoryRanges(m_device.device(), static_cast<uint32_t>(ranges.size()), ranges.data());
+}
+
+VkResult Buffer::flushDirty(Device& p_device, const std::vector<Buffer*>& p_buffers) {
+	FrameVector<VkMappedMemoryRange> ranges = {};
+	for(Buffer* buffer : p_buffers) {
+		buffer->appendDirtyRanges(ranges);
+		buffer->m_dirtyRanges.clear();
+	}
+
+	if(ranges.empty()) {
+		return VK_SUCCESS;
+	}
+
+	return vkFlushMappedMemoryRanges(p_device.device(), static_cast<uint32_t>(ranges.size()), ranges.data());
+}
+
+void Buffer::appendDirtyRanges(FrameVector<VkMappedMemoryRange>& p_ranges) const {
+	for(const DirtyRange& range : m_dirtyRanges) {
+		p_ranges.push_back(mappedRange(range.end - range.begin, range.begin));
+	}
+}
+
+VkMappedMemoryRange Buffer::mappedRange(VkDeviceSize p_size, VkDeviceSize p_offset) const {
 	VkMappedMemoryRange mappedRange = {};
 	mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-	mappedRange.memory = m_memory;
-	mappedRange.offset = p_offset;
-	mappedRange.size = p_size;
+	mappedRange.memory = m_allocation.memory;
+	mappedRange.offset = m_allocation.offset + p_offset;
+	mappedRange.size = p_size == VK_WHOLE_SIZE ? m_allocation.size - p_offset : p_size;
+
+	return mappedRange;
+}
+
+VkResult Buffer::flush(VkDeviceSize p_size, VkDeviceSize p_offset) {
+	if(m_allocation.coherent) {
+		return VK_SUCCESS;
+	}
 
-	return vkFlushMappedMemoryRanges(m_device.device(), 1, &mappedRange);
+	// Whatever the flush covers is no longer dirty, so flushDirty() does not repeat it
+	DirtyRange flushed = atomRange(p_size, p_offset);
+	VkMappedMemoryRange range = mappedRange(flushed.end - flushed.begin, flushed.begin);
+
+	VkResult result = vkFlushMappedMemoryRanges(m_device.device(), 1, &range);
+	if(result == VK_SUCCESS) {
+		clearDirty(flushed);
+	}
+
+	return result;
 }
 
 VkDescriptorBufferInfo Buffer::descriptorInfo(VkDeviceSize p_size, VkDeviceSize p_offset) {
@@ -62,13 +192,14 @@ VkDescriptorBufferInfo Buffer::descriptorInfo(VkDeviceSize p_size, VkDeviceSize
 }
 
 VkResult Buffer::invalidate(VkDeviceSize p_size, VkDeviceSize p_offset) {
-	VkMappedMemoryRange mappedRange = {};
-	mappedRange.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-	mappedRange.memory = m_memory;
-	mappedRange.offset = p_offset;
-	mappedRange.size = p_size;
+	if(m_allocation.coherent) {
+		return VK_SUCCESS;
+	}
+
+	DirtyRange invalidated = atomRange(p_size, p_offset);
+	VkMappedMemoryRange range = mappedRange(invalidated.end - invalidated.begin, invalidated.begin);
 
-	return vkInvalidateMappedMemoryRanges(m_device.device(), 1, &mappedRange);
+	return vkInvalidateMappedMemoryRanges(m_device.device(), 1, &range);
 }
 
 void Buffer::writeToIndex(void* p_data, int p_index) {
@@ -1,14 +1,27 @@
 #include "Device.hpp"
+#include "MeshPool.hpp"
+#include "Model.hpp"
+#include "PipelineBuildService.hpp"
+#include "PipelineCache.hpp"
+#include "ShaderLibrary.hpp"
+#include "ShaderReloader.hpp"
+#include "UploadBatcher.hpp"
 
 // Libraries
 #include "vulkan/vulkan_core.h"
 
 // STD
+#include <cassert>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
 #include <set>
 #include <unordered_set>
 
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
 namespace FFL {
 
 static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT, VkDebugUtilsMessageTypeFlagsEXT, const VkDebugUtilsMessengerCallbackDataEXT* p_callbackData, void*) {
@@ -41,9 +54,30 @@ Device::Device(Window& p_window) : m_window{p_window} {
 	pickPhysicalDevice();
 	createLogicalDevice();
 	createCommandPool();
+
+	m_memoryAllocator = std::make_unique<MemoryAllocator>(*this);
+	m_uploadBatcher = std::make_unique<UploadBatcher>(*this);
+	if(Model::SPLIT_POSITIONS) {
+		m_meshPool = std::make_unique<MeshPool>(*this, Model::VertexFormat::STRIDE - Model::VertexFormat::POSITION_STRIDE, Model::VertexFormat::POSITION_STRIDE);
+	} else {
+		m_meshPool = std::make_unique<MeshPool>(*this, Model::VertexFormat::STRIDE);
+	}
+	m_pipelineCache = std::make_unique<PipelineCache>(*this, ENGINE_DIR "pipeline_cache.bin");
+	m_shaderLibrary = std::make_unique<ShaderLibrary>(*this);
+	m_shaderReloader = std::make_unique<ShaderReloader>(*this);
+	m_pipelineBuilds = std::make_unique<PipelineBuildService>(*this);
 }
 
 Device::~Device() {
+	m_pipelineBuilds.reset();
+	m_shaderReloader.reset();
+	m_shaderLibrary.reset();
+	m_pipelineCache->save();
+	m_pipelineCache.reset();
+	m_uploadBatcher.reset();
+	m_meshPool.reset();
+	m_memoryAllocator.reset();
+
 	vkDestroyCommandPool(m_device, m_commandPool, nullptr);
 
 	vkDestroyDevice(m_device, nullptr);
@@ -67,7 +101,16 @@ void Device::createInstance() {
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0;
+
+	// 1.2 when the loader has it, VK_KHR_maintenance5 and VK_EXT_graphics_pipeline_library build on it
+	uint32_t instanceVersion = VK_API_VERSION_1_0;
+	auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(vkGetInstanceProcAddr(nullptr, "vkEnumerateInstanceVersion"));
+	if(enumerateInstanceVersion != nullptr) {
+		enumerateInstanceVersion(&instanceVersion);
+	}
+
+	m_apiVersion = instanceVersion >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
+	appInfo.apiVersion = m_apiVersion;
 
 	VkInstanceCreateInfo createInfo;
 	createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -139,6 +182,17 @@ void Device::pickPhysicalDevice() {
 
 	vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
 	std::cout << "Physical Device: " << properties.deviceName << std::endl;
+
+	// Discrete GPUs may expose a small host visible window of their memory as well, it is left to the staging path
+	if(properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU || properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU) {
+		VkPhysicalDeviceMemoryProperties memProperties;
+		vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProperties);
+
+		VkMemoryPropertyFlags unified = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		for(uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+			m_unifiedMemory = m_unifiedMemory || (memProperties.memoryTypes[i].propertyFlags & unified) == unified;
+		}
+	}
 }
 
 void Device::createLogicalDevice() {
@@ -157,16 +211,94 @@ void Device::createLogicalDevice() {
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+
+	// Optional, without it indirect draws are issued one command at a time
+	m_multiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
+	deviceFeatures.multiDrawIndirect = m_multiDrawIndirect ? VK_TRUE : VK_FALSE;
+
+	// Optional, without it MemoryAllocator estimates budgets from heap sizes and its own allocations
+	std::vector<const char*> extensions = m_deviceExtensions;
+	m_getMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+	if(m_getMemoryProperties2 != nullptr && isDeviceExtensionSupported(m_physicalDevice, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+		extensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+		m_memoryBudget = true;
+	}
+
+	// Optional, without it ShaderLibrary creates a shader module per shader
+	VkPhysicalDeviceMaintenance5FeaturesKHR maintenance5Features = {};
+	maintenance5Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MAINTENANCE_5_FEATURES_KHR;
+
+	// Optional, without it pipelines built on demand are compiled whole instead of linked from cached parts
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures = {};
+	pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+
+	if(m_apiVersion >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2) {
+		bool maintenance5Supported = isDeviceExtensionSupported(m_physicalDevice, VK_KHR_MAINTENANCE_5_EXTENSION_NAME) && isDeviceExtensionSupported(m_physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		bool pipelineLibrarySupported = isDeviceExtensionSupported(m_physicalDevice, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME) && isDeviceExtensionSupported(m_physicalDevice, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+
+		// Only structures of supported extensions may be chained into the query
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		if(maintenance5Supported) {
+			maintenance5Features.pNext = features2.pNext;
+			features2.pNext = &maintenance5Features;
+		}
+		if(pipelineLibrarySupported) {
+			pipelineLibraryFeatures.pNext = features2.pNext;
+			features2.pNext = &pipelineLibraryFeatures;
+		}
+		vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+
+		if(maintenance5Supported && maintenance5Features.maintenance5 == VK_TRUE) {
+			extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+			extensions.push_back(VK_KHR_MAINTENANCE_5_EXTENSION_NAME);
+			m_inlineShaders = true;
+		}
+
+		// Linking is only worth it when the driver does it fast
+		VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT pipelineLibraryProperties = {};
+		pipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+
+		if(pipelineLibrarySupported && pipelineLibraryFeatures.graphicsPipelineLibrary == VK_TRUE) {
+			VkPhysicalDeviceProperties2 properties2 = {};
+			properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+			properties2.pNext = &pipelineLibraryProperties;
+			vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties2);
+		}
+
+		if(pipelineLibraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE) {
+			extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+			extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+			m_pipelineLibraries = true;
+		}
+	}
+
+	// Enabled features, chained into the device create info
+	void* enabledFeatures = nullptr;
+	maintenance5Features.pNext = nullptr;
+	pipelineLibraryFeatures.pNext = nullptr;
+	if(m_inlineShaders) {
+		maintenance5Features.pNext = enabledFeatures;
+		enabledFeatures = &maintenance5Features;
+	}
+	if(m_pipelineLibraries) {
+		pipelineLibraryFeatures.pNext = enabledFeatures;
+		enabledFeatures = &pipelineLibraryFeatures;
+	}
 
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.pEnabledFeatures = &deviceFeatures;
-	createInfo.enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size());
-	createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+	createInfo.ppEnabledExtensionNames = extensions.data();
+	createInfo.pNext = enabledFeatures;
 
 	// Might be deprecated
 	if(enableValidationLayers) {
@@ -233,6 +365,11 @@ std::vector<const char*> Device::getRequiredExtensions() {
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
 	}
 
+	// Optional, needed to query VK_EXT_memory_budget on a 1.0 instance
+	if(isInstanceExtensionSupported(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME)) {
+		extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
+
 	return extensions;
 }
 
@@ -334,6 +471,51 @@ bool Device::checkDeviceExtensionSupport(VkPhysicalDevice p_device) {
 	return requiredExtensions.empty();
 }
 
+bool Device::isDeviceExtensionSupported(VkPhysicalDevice p_device, const char* p_extension) {
+	uint32_t extensionCount;
+	vkEnumerateDeviceExtensionProperties(p_device, nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(p_device, nullptr, &extensionCount, availableExtensions.data());
+
+	for(const VkExtensionProperties& extension : availableExtensions) {
+		if(strcmp(extension.extensionName, p_extension) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool Device::isInstanceExtensionSupported(const char* p_extension) {
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+
+	std::vector<VkExtensionProperties> extensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
+
+	for(const VkExtensionProperties& extension : extensions) {
+		if(strcmp(extension.extensionName, p_extension) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void Device::getMemoryBudget(VkPhysicalDeviceMemoryBudgetPropertiesEXT& p_budget) {
+	assert(m_memoryBudget && "VK_EXT_memory_budget is not enabled");
+
+	p_budget = {};
+	p_budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+	VkPhysicalDeviceMemoryProperties2 memoryProperties = {};
+	memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memoryProperties.pNext = &p_budget;
+
+	m_getMemoryProperties2(m_physicalDevice, &memoryProperties);
+}
+
 SwapChainSupportDetails Device::querySwapChainSupport(VkPhysicalDevice p_device) {
 	SwapChainSupportDetails details;
 	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(p_device, m_surface, &details.capabilities);
@@ -385,7 +567,7 @@ VkFormat Device::findSupportedFormat(const std::vector<VkFormat>& p_candidates,
 	throw std::runtime_error("failed to find supported format!");
 }
 
-void Device::createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer& p_buffer, VkDeviceMemory& p_bufferMemory) {
+void Device::createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMemoryPropertyFlags p_properties, VkBuffer& p_buffer, MemoryAllocation& p_allocation) {
 	VkBufferCreateInfo bufferInfo = {};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 	bufferInfo.size = p_size;
@@ -399,16 +581,9 @@ void Device::createBuffer(VkDeviceSize p_size, VkBufferUsageFlags p_usage, VkMem
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(m_device, p_buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, p_properties);
-
-	if(vkAllocateMemory(m_device, &allocInfo, nullptr, &p_bufferMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate vertex buffer memory!");
-	}
+	p_allocation = m_memoryAllocator->allocate(memRequirements, p_properties, true);
 
-	vkBindBufferMemory(m_device, p_buffer, p_bufferMemory, 0);
+	vkBindBufferMemory(m_device, p_buffer, p_allocation.memory, p_allocation.offset);
 }
 
 VkCommandBuffer Device::beginSingleTimeCommands() {
@@ -430,53 +605,53 @@ VkCommandBuffer Device::beginSingleTimeCommands() {
 }
 
 void Device::endSingleTimeCommands(VkCommandBuffer p_commandBuffer) {
+	// Wait for this submission only, not for frames that are still in flight on the same queue
+	VkFence fence = submitSingleTimeCommands(p_commandBuffer);
+	releaseSingleTimeCommands(p_commandBuffer, fence);
+}
+
+VkFence Device::submitSingleTimeCommands(VkCommandBuffer p_commandBuffer) {
 	vkEndCommandBuffer(p_commandBuffer);
 
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+	VkFence fence;
+	if(vkCreateFence(m_device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create fence!");
+	}
+
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &p_commandBuffer;
 
-	vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_graphicsQueue);
+	if(vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, fence) != VK_SUCCESS) {
+		vkDestroyFence(m_device, fence, nullptr);
+		throw std::runtime_error("failed to submit single time commands!");
+	}
 
-	vkFreeCommandBuffers(m_device, m_commandPool, 1, &p_commandBuffer);
+	return fence;
 }
 
-void Device::copyBuffer(VkBuffer p_src, VkBuffer p_dst, VkDeviceSize p_size) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+void Device::releaseSingleTimeCommands(VkCommandBuffer p_commandBuffer, VkFence p_fence) {
+	vkWaitForFences(m_device, 1, &p_fence, VK_TRUE, UINT64_MAX);
+	vkDestroyFence(m_device, p_fence, nullptr);
 
-	VkBufferCopy copyRegion = {};
-	copyRegion.srcOffset = 0; // Optional
-	copyRegion.dstOffset = 0; // Optional
-	copyRegion.size = p_size;
-	vkCmdCopyBuffer(commandBuffer, p_src, p_dst, 1, &copyRegion);
+	vkFreeCommandBuffers(m_device, m_commandPool, 1, &p_commandBuffer);
+}
 
-	endSingleTimeCommands(commandBuffer);
+void Device::copyBuffer(VkBuffer p_src, VkBuffer p_dst, VkDeviceSize p_size) {
+	m_uploadBatcher->copyBuffer(p_src, p_dst, p_size);
+	m_uploadBatcher->flush();
 }
 
 void Device::copyBufferToImage(VkBuffer p_buffer, VkImage p_image, uint32_t p_w, uint32_t p_h, uint32_t p_layerCount) {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
-	VkBufferImageCopy region = {};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
-
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = p_layerCount;
-
-	region.imageOffset = {0, 0, 0};
-	region.imageExtent = {p_w, p_h, 1};
-
-	vkCmdCopyBufferToImage(commandBuffer, p_buffer, p_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-	endSingleTimeCommands(commandBuffer);
+	m_uploadBatcher->copyBufferToImage(p_buffer, p_image, p_w, p_h, p_layerCount);
+	m_uploadBatcher->flush();
 }
 
-void Device::createImageWithInfo(const VkImageCreateInfo& p_imageInfo, VkMemoryPropertyFlags p_properties, VkImage& p_image, VkDeviceMemory& p_imageMemory) {
+void Device::createImageWithInfo(const VkImageCreateInfo& p_imageInfo, VkMemoryPropertyFlags p_properties, VkImage& p_image, MemoryAllocation& p_allocation) {
 	if(vkCreateImage(m_device, &p_imageInfo, nullptr, &p_image) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create image!");
 	}
@@ -484,16 +659,9 @@ void Device::createImageWithInfo(const VkImageCreateInfo& p_imageInfo, VkMemoryP
 	VkMemoryRequirements memRequirements;
 	vkGetImageMemoryRequirements(m_device, p_image, &memRequirements);
 
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, p_properties);
-
-	if(vkAllocateMemory(m_device, &allocInfo, nullptr, &p_imageMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate image memory!");
-	}
+	p_allocation = m_memoryAllocator->allocate(memRequirements, p_properties, p_imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
 
-	if(vkBindImageMemory(m_device, p_image, p_imageMemory, 0) != VK_SUCCESS) {
+	if(vkBindImageMemory(m_device, p_image, p_allocation.memory, p_allocation.offset) != VK_SUCCESS) {
 		throw std::runtime_error("failed to bind image memory!");
 	}
 }
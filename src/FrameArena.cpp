@@ -0,0 +1,174 @@
+#include "FrameArena.hpp"
+
+// STD
+#include <algorithm>
+#include <cassert>
+
+namespace FFL {
+
+// Each thread finds its state without locking, FrameArena only exists once
+struct ThreadRegistration {
+	void* state = nullptr;
+
+	~ThreadRegistration() {
+		if(state != nullptr) {
+			FrameArena::shared().releaseThreadState(static_cast<FrameArena::ThreadState*>(state));
+		}
+	}
+};
+
+static thread_local ThreadRegistration t_registration = {};
+
+FrameArena& FrameArena::shared() {
+	static FrameArena arena{};
+	return arena;
+}
+
+FrameArena::ThreadState& FrameArena::threadState() {
+	if(t_registration.state == nullptr) {
+		std::lock_guard<std::mutex> lock{m_mutex};
+
+		auto unowned = std::find_if(m_threads.begin(), m_threads.end(), [](const std::unique_ptr<ThreadState>& p_state) {
+			return !p_state->owned;
+		});
+
+		if(unowned == m_threads.end()) {
+			m_threads.push_back(std::make_unique<ThreadState>());
+			unowned = m_threads.end() - 1;
+		}
+
+		(*unowned)->owned = true;
+		t_registration.state = unowned->get();
+	}
+
+	ThreadState& state = *static_cast<ThreadState*>(t_registration.state);
+
+	uint64_t frame = m_frame.load(std::memory_order_acquire);
+	if(state.frame.load(std::memory_order_relaxed) != frame) {
+		beginThreadFrame(state, frame);
+	}
+
+	return state;
+}
+
+void FrameArena::releaseThreadState(ThreadState* p_state) {
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	p_state->owned = false;
+}
+
+void FrameArena::beginThreadFrame(ThreadState& p_state, uint64_t p_frame) {
+	p_state.highWaterBytes.store(std::max(p_state.highWaterBytes.load(std::memory_order_relaxed), p_state.usedBytes.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+
+	// A frame that spilled into more chunks gets one chunk large enough for all of them from now on
+	if(p_state.chunks.size() > 1) {
+		size_t totalSize = 0;
+		for(size_t size : p_state.chunkSizes) {
+			totalSize += size;
+		}
+
+		p_state.chunks.clear();
+		p_state.chunkSizes.clear();
+		p_state.reservedBytes.store(0, std::memory_order_relaxed);
+		addChunk(p_state, totalSize);
+	}
+
+	p_state.chunk = 0;
+	p_state.head = p_state.chunks.empty() ? nullptr : p_state.chunks[0].get();
+	p_state.end = p_state.chunks.empty() ? nullptr : p_state.head + p_state.chunkSizes[0];
+
+	p_state.usedBytes.store(0, std::memory_order_relaxed);
+	p_state.frame.store(p_frame, std::memory_order_release);
+}
+
+void FrameArena::addChunk(ThreadState& p_state, size_t p_minSize) {
+	size_t size = std::max(p_minSize, DEFAULT_CHUNK_SIZE);
+
+	p_state.chunks.push_back(std::make_unique<char[]>(size));
+	p_state.chunkSizes.push_back(size);
+	p_state.reservedBytes.store(p_state.reservedBytes.load(std::memory_order_relaxed) + size, std::memory_order_relaxed);
+}
+
+void* FrameArena::allocate(size_t p_size, size_t p_alignment) {
+	assert((p_alignment & (p_alignment - 1)) == 0 && "Alignment must be a power of two");
+
+	ThreadState& state = threadState();
+
+	for(;;) {
+		if(state.head != nullptr) {
+			uintptr_t address = (reinterpret_cast<uintptr_t>(state.head) + p_alignment - 1) & ~static_cast<uintptr_t>(p_alignment - 1);
+			char* pointer = reinterpret_cast<char*>(address);
+
+			if(pointer + p_size <= state.end) {
+				state.usedBytes.store(state.usedBytes.load(std::memory_order_relaxed) + static_cast<size_t>(pointer + p_size - state.head), std::memory_order_relaxed);
+				state.head = pointer + p_size;
+
+				return pointer;
+			}
+		}
+
+		// Move on to the next chunk, adding one that fits the request when there is none
+		if(state.head == nullptr) {
+			state.chunk = 0;
+		} else {
+			state.chunk++;
+		}
+
+		if(state.chunk == state.chunks.size()) {
+			addChunk(state, p_size + p_alignment);
+		}
+
+		state.head = state.chunks[state.chunk].get();
+		state.end = state.head + state.chunkSizes[state.chunk];
+	}
+}
+
+void FrameArena::deallocate(void* p_pointer, size_t p_size) {
+	if(t_registration.state == nullptr) {
+		return;
+	}
+
+	ThreadState& state = *static_cast<ThreadState*>(t_registration.state);
+
+	if(static_cast<char*>(p_pointer) + p_size == state.head && state.frame.load(std::memory_order_relaxed) == m_frame.load(std::memory_order_relaxed)) {
+		state.head = static_cast<char*>(p_pointer);
+		state.usedBytes.store(state.usedBytes.load(std::memory_order_relaxed) - p_size, std::memory_order_relaxed);
+	}
+}
+
+void FrameArena::reset() {
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	uint64_t frame = m_frame.load(std::memory_order_relaxed);
+
+	// Threads that did not allocate this frame still carry the counters of an older one
+	m_frameBytes = 0;
+	for(std::unique_ptr<ThreadState>& state : m_threads) {
+		if(state->frame.load(std::memory_order_acquire) == frame) {
+			m_frameBytes += state->usedBytes.load(std::memory_order_relaxed);
+		}
+	}
+
+	m_highWaterBytes = std::max(m_highWaterBytes, m_frameBytes);
+
+	// Every thread rewinds itself on its next allocation
+	m_frame.store(frame + 1, std::memory_order_release);
+}
+
+FrameArena::Stats FrameArena::getStats() {
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	Stats stats = {};
+	stats.frameBytes = m_frameBytes;
+	stats.highWaterBytes = m_highWaterBytes;
+	for(std::unique_ptr<ThreadState>& state : m_threads) {
+		stats.threadCount += state->owned ? 1 : 0;
+
+		stats.threadHighWaterBytes = std::max({stats.threadHighWaterBytes, state->highWaterBytes.load(std::memory_order_relaxed), state->usedBytes.load(std::memory_order_relaxed)});
+		stats.reservedBytes += state->reservedBytes.load(std::memory_order_relaxed);
+	}
+
+	return stats;
+}
+
+} // FFL
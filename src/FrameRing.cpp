@@ -0,0 +1,53 @@
+#include "FrameRing.hpp"
+#include "SwapChain.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace FFL {
+
+FrameRing::FrameRing(Device& p_device, VkDeviceSize p_frameCapacity) : m_device{p_device} {
+	m_uniformAlignment = std::max<VkDeviceSize>(m_device.properties.limits.minUniformBufferOffsetAlignment, 1);
+	m_storageAlignment = std::max<VkDeviceSize>(m_device.properties.limits.minStorageBufferOffsetAlignment, 1);
+
+	// Regions start on a boundary that suits every kind of slice
+	VkDeviceSize regionAlignment = std::max(m_uniformAlignment, m_storageAlignment);
+	m_frameCapacity = (p_frameCapacity + regionAlignment - 1) & ~(regionAlignment - 1);
+
+	VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+
+	m_buffer = std::make_unique<Buffer>(m_device, m_frameCapacity, SwapChain::MAX_FRAMES_IN_FLIGHT, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+	if(m_buffer->map() != VK_SUCCESS) {
+		throw std::runtime_error("failed to map frame ring!");
+	}
+
+	m_mapped = static_cast<char*>(m_buffer->getMappedMemory());
+}
+
+void FrameRing::beginFrame(int p_frameIndex) {
+	assert(p_frameIndex >= 0 && static_cast<size_t>(p_frameIndex) < SwapChain::MAX_FRAMES_IN_FLIGHT && "Frame index out of range");
+
+	m_frameStart = static_cast<VkDeviceSize>(p_frameIndex) * m_frameCapacity;
+	m_head = m_frameStart;
+}
+
+FrameRing::Slice FrameRing::allocate(VkDeviceSize p_size, VkDeviceSize p_alignment) {
+	assert((p_alignment & (p_alignment - 1)) == 0 && "Alignment must be a power of two");
+
+	VkDeviceSize offset = (m_head + p_alignment - 1) & ~(p_alignment - 1);
+	if(offset + p_size > m_frameStart + m_frameCapacity) {
+		throw std::runtime_error("frame ring out of space!");
+	}
+
+	m_head = offset + p_size;
+
+	return {m_mapped + offset, offset, p_size};
+}
+
+} // FFL
@@ -0,0 +1,96 @@
+#include "MappedFile.hpp"
+
+// Libraries
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// STD
+#include <stdexcept>
+
+namespace FFL {
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string& p_filePath) {
+	m_file = CreateFileA(p_filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if(m_file == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("failed to open file: " + p_filePath);
+	}
+
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(m_file, &fileSize);
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+
+	if(m_size == 0) {
+		return;
+	}
+
+	m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if(m_mapping == nullptr) {
+		CloseHandle(m_file);
+		throw std::runtime_error("failed to map file: " + p_filePath);
+	}
+
+	m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+	if(m_data == nullptr) {
+		CloseHandle(m_mapping);
+		CloseHandle(m_file);
+		throw std::runtime_error("failed to map file: " + p_filePath);
+	}
+}
+
+MappedFile::~MappedFile() {
+	if(m_data) {
+		UnmapViewOfFile(m_data);
+	}
+
+	if(m_mapping) {
+		CloseHandle(m_mapping);
+	}
+
+	CloseHandle(m_file);
+}
+
+#else
+
+MappedFile::MappedFile(const std::string& p_filePath) {
+	m_fileDescriptor = open(p_filePath.c_str(), O_RDONLY);
+	if(m_fileDescriptor < 0) {
+		throw std::runtime_error("failed to open file: " + p_filePath);
+	}
+
+	struct stat fileStat = {};
+	fstat(m_fileDescriptor, &fileStat);
+	m_size = static_cast<size_t>(fileStat.st_size);
+
+	if(m_size == 0) {
+		return;
+	}
+
+	void* mapping = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fileDescriptor, 0);
+	if(mapping == MAP_FAILED) {
+		close(m_fileDescriptor);
+		throw std::runtime_error("failed to map file: " + p_filePath);
+	}
+
+	m_data = static_cast<const uint8_t*>(mapping);
+}
+
+MappedFile::~MappedFile() {
+	if(m_data) {
+		munmap(const_cast<uint8_t*>(m_data), m_size);
+	}
+
+	close(m_fileDescriptor);
+}
+
+#endif
+
+} // FFL
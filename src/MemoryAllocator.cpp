@@ -0,0 +1,333 @@
+#include "MemoryAllocator.hpp"
+#include "Device.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+
+namespace FFL {
+
+MemoryAllocator::MemoryAllocator(Device& p_device, VkDeviceSize p_blockSize) : m_device{p_device}, m_blockSize{p_blockSize} {
+	vkGetPhysicalDeviceMemoryProperties(m_device.physicalDevice(), &m_memoryProperties);
+	m_nonCoherentAtomSize = std::max<VkDeviceSize>(m_device.properties.limits.nonCoherentAtomSize, 1);
+
+	m_pools.resize(m_memoryProperties.memoryTypeCount * 2);
+	for(uint32_t i = 0; i < m_pools.size(); i++) {
+		m_pools[i].memoryType = i / 2;
+	}
+
+	m_typeStats.resize(m_memoryProperties.memoryTypeCount);
+	for(uint32_t i = 0; i < m_typeStats.size(); i++) {
+		m_typeStats[i].heap = m_memoryProperties.memoryTypes[i].heapIndex;
+		m_typeStats[i].propertyFlags = m_memoryProperties.memoryTypes[i].propertyFlags;
+	}
+}
+
+MemoryAllocator::~MemoryAllocator() {
+	for(Pool& pool : m_pools) {
+		for(Block& block : pool.blocks) {
+			if(block.memory != VK_NULL_HANDLE) {
+				freeDeviceMemory(block.memory, block.ranges.capacity(), pool.memoryType, block.mapped != nullptr);
+			}
+		}
+	}
+}
+
+bool MemoryAllocator::isHostVisible(uint32_t p_memoryType) const {
+	return (m_memoryProperties.memoryTypes[p_memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) != 0;
+}
+
+bool MemoryAllocator::isHostCoherent(uint32_t p_memoryType) const {
+	return (m_memoryProperties.memoryTypes[p_memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+}
+
+VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize p_size, uint32_t p_memoryType, void** p_mapped) {
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = p_size;
+	allocInfo.memoryTypeIndex = p_memoryType;
+
+	VkDeviceMemory memory;
+	if(vkAllocateMemory(m_device.device(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("failed to allocate device memory!");
+	}
+
+	*p_mapped = nullptr;
+	if(isHostVisible(p_memoryType) && vkMapMemory(m_device.device(), memory, 0, VK_WHOLE_SIZE, 0, p_mapped) != VK_SUCCESS) {
+		vkFreeMemory(m_device.device(), memory, nullptr);
+		throw std::runtime_error("failed to map device memory!");
+	}
+
+	m_deviceAllocationCount++;
+	m_typeStats[p_memoryType].allocatedBytes += p_size;
+
+	return memory;
+}
+
+void MemoryAllocator::freeDeviceMemory(VkDeviceMemory p_memory, VkDeviceSize p_size, uint32_t p_memoryType, bool p_mapped) {
+	if(p_mapped) {
+		vkUnmapMemory(m_device.device(), p_memory);
+	}
+
+	vkFreeMemory(m_device.device(), p_memory, nullptr);
+	m_deviceAllocationCount--;
+	m_typeStats[p_memoryType].allocatedBytes -= p_size;
+}
+
+void MemoryAllocator::trackResource(const MemoryAllocation& p_allocation, bool p_allocate) {
+	TypeStats& stats = m_typeStats[p_allocation.pool / 2];
+	VkDeviceSize& resourceBytes = p_allocation.pool % 2 == 0 ? stats.bufferBytes : stats.imageBytes;
+
+	if(p_allocate) {
+		stats.allocationCount++;
+		stats.usedBytes += p_allocation.size;
+		resourceBytes += p_allocation.size;
+	} else {
+		stats.allocationCount--;
+		stats.usedBytes -= p_allocation.size;
+		resourceBytes -= p_allocation.size;
+	}
+}
+
+MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& p_requirements, VkMemoryPropertyFlags p_properties, bool p_linear) {
+	uint32_t memoryType = m_device.findMemoryType(p_requirements.memoryTypeBits, p_properties);
+
+	// Flushed ranges must cover whole atoms, so neighbouring host visible allocations must not share one
+	VkDeviceSize alignment = p_requirements.alignment;
+	VkDeviceSize size = p_requirements.size;
+	if(isHostVisible(memoryType)) {
+		alignment = std::max(alignment, m_nonCoherentAtomSize);
+		size = (size + m_nonCoherentAtomSize - 1) & ~(m_nonCoherentAtomSize - 1);
+	}
+
+	MemoryAllocation allocation = {};
+	allocation.size = size;
+	allocation.pool = memoryType * 2 + (p_linear ? 0 : 1);
+	allocation.coherent = isHostCoherent(memoryType);
+
+	if(size > m_blockSize / 2) {
+		allocation.memory = allocateDeviceMemory(size, memoryType, &allocation.mapped);
+		allocation.block = MemoryAllocation::DEDICATED;
+
+		m_dedicatedAllocationCount++;
+		m_dedicatedBytes += size;
+		trackResource(allocation, true);
+
+		return allocation;
+	}
+
+	Pool& pool = m_pools[allocation.pool];
+
+	uint32_t blockIndex = MemoryAllocation::DEDICATED;
+	uint64_t offset = RangeAllocator::INVALID_OFFSET;
+
+	for(uint32_t i = 0; i < pool.blocks.size() && offset == RangeAllocator::INVALID_OFFSET; i++) {
+		if(pool.blocks[i].memory != VK_NULL_HANDLE) {
+			offset = pool.blocks[i].ranges.allocate(size, alignment);
+			blockIndex = i;
+		}
+	}
+
+	if(offset == RangeAllocator::INVALID_OFFSET) {
+		Block block = {};
+		block.memory = allocateDeviceMemory(m_blockSize, memoryType, &block.mapped);
+		block.ranges = RangeAllocator{m_blockSize};
+
+		// Reuse the slot of a freed block, allocations refer to blocks by index
+		auto freeSlot = std::find_if(pool.blocks.begin(), pool.blocks.end(), [](const Block& p_block) {
+			return p_block.memory == VK_NULL_HANDLE;
+		});
+
+		if(freeSlot != pool.blocks.end()) {
+			*freeSlot = std::move(block);
+			blockIndex = static_cast<uint32_t>(freeSlot - pool.blocks.begin());
+		} else {
+			blockIndex = static_cast<uint32_t>(pool.blocks.size());
+			pool.blocks.push_back(std::move(block));
+		}
+
+		offset = pool.blocks[blockIndex].ranges.allocate(size, alignment);
+		assert(offset != RangeAllocator::INVALID_OFFSET && "A fresh block must fit half its size");
+	}
+
+	Block& block = pool.blocks[blockIndex];
+	block.allocationCount++;
+
+	allocation.memory = block.memory;
+	allocation.offset = offset;
+	allocation.block = blockIndex;
+	allocation.mapped = block.mapped != nullptr ? static_cast<char*>(block.mapped) + offset : nullptr;
+	trackResource(allocation, true);
+
+	return allocation;
+}
+
+void MemoryAllocator::free(const MemoryAllocation& p_allocation) {
+	if(p_allocation.memory == VK_NULL_HANDLE) {
+		return;
+	}
+
+	trackResource(p_allocation, false);
+
+	if(p_allocation.block == MemoryAllocation::DEDICATED) {
+		freeDeviceMemory(p_allocation.memory, p_allocation.size, p_allocation.pool / 2, p_allocation.mapped != nullptr);
+
+		m_dedicatedAllocationCount--;
+		m_dedicatedBytes -= p_allocation.size;
+
+		return;
+	}
+
+	Pool& pool = m_pools[p_allocation.pool];
+	Block& block = pool.blocks[p_allocation.block];
+
+	block.ranges.free(p_allocation.offset, p_allocation.size);
+	block.allocationCount--;
+
+	// Keep one empty block per pool, so a resource that is recreated every frame does not reallocate it each time
+	if(block.allocationCount > 0) {
+		return;
+	}
+
+	bool otherBlocks = std::any_of(pool.blocks.begin(), pool.blocks.end(), [&block](const Block& p_block) {
+		return &p_block != &block && p_block.memory != VK_NULL_HANDLE;
+	});
+
+	if(otherBlocks) {
+		freeDeviceMemory(block.memory, block.ranges.capacity(), pool.memoryType, block.mapped != nullptr);
+		block = {};
+	}
+}
+
+MemoryAllocator::Stats MemoryAllocator::getStats() const {
+	Stats stats = {};
+
+	for(const Pool& pool : m_pools) {
+		for(const Block& block : pool.blocks) {
+			if(block.memory == VK_NULL_HANDLE) {
+				continue;
+			}
+
+			stats.blockCount++;
+			stats.allocationCount += block.allocationCount;
+			stats.blockBytes += block.ranges.capacity();
+			stats.usedBytes += block.ranges.capacity() - block.ranges.freeSize();
+		}
+	}
+
+	stats.allocationCount += m_dedicatedAllocationCount;
+	stats.dedicatedAllocationCount = m_dedicatedAllocationCount;
+	stats.dedicatedBytes = m_dedicatedBytes;
+
+	return stats;
+}
+
+std::vector<MemoryAllocator::HeapBudget> MemoryAllocator::getHeapBudgets() const {
+	std::vector<HeapBudget> heaps(m_memoryProperties.memoryHeapCount);
+
+	for(uint32_t i = 0; i < heaps.size(); i++) {
+		heaps[i].size = m_memoryProperties.memoryHeaps[i].size;
+		heaps[i].deviceLocal = (m_memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0;
+	}
+
+	for(const TypeStats& type : m_typeStats) {
+		heaps[type.heap].allocatedBytes += type.allocatedBytes;
+		heaps[type.heap].usedBytes += type.usedBytes;
+	}
+
+	if(m_device.supportsMemoryBudget()) {
+		VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {};
+		m_device.getMemoryBudget(budget);
+
+		for(uint32_t i = 0; i < heaps.size(); i++) {
+			heaps[i].budget = budget.heapBudget[i];
+			heaps[i].usage = budget.heapUsage[i];
+		}
+	} else {
+		for(HeapBudget& heap : heaps) {
+			heap.budget = heap.size / 10 * 8;
+			heap.usage = heap.allocatedBytes;
+		}
+	}
+
+	return heaps;
+}
+
+void MemoryAllocator::writeJson(std::ostream& p_stream) const {
+	std::vector<HeapBudget> heaps = getHeapBudgets();
+	Stats stats = getStats();
+
+	p_stream << "{\n";
+	p_stream << "\t\"memoryBudgetExtension\": " << (m_device.supportsMemoryBudget() ? "true" : "false") << ",\n";
+	p_stream << "\t\"deviceAllocations\": " << m_deviceAllocationCount << ",\n";
+	p_stream << "\t\"blocks\": " << stats.blockCount << ",\n";
+	p_stream << "\t\"dedicatedAllocations\": " << stats.dedicatedAllocationCount << ",\n";
+
+	p_stream << "\t\"heaps\": [";
+	for(uint32_t i = 0; i < heaps.size(); i++) {
+		const HeapBudget& heap = heaps[i];
+		p_stream << (i == 0 ? "\n" : ",\n");
+		p_stream << "\t\t{\"index\": " << i << ", \"deviceLocal\": " << (heap.deviceLocal ? "true" : "false") << ", \"size\": " << heap.size << ", \"budget\": " << heap.budget << ", \"usage\": " << heap.usage << ", \"allocated\": " << heap.allocatedBytes << ", \"used\": " << heap.usedBytes << "}";
+	}
+	p_stream << "\n\t],\n";
+
+	p_stream << "\t\"types\": [";
+	for(uint32_t i = 0; i < m_typeStats.size(); i++) {
+		const TypeStats& type = m_typeStats[i];
+		p_stream << (i == 0 ? "\n" : ",\n");
+		p_stream << "\t\t{\"index\": " << i << ", \"heap\": " << type.heap << ", \"propertyFlags\": " << type.propertyFlags << ", \"allocations\": " << type.allocationCount << ", \"allocated\": " << type.allocatedBytes << ", \"used\": " << type.usedBytes << ", \"buffers\": " << type.bufferBytes << ", \"images\": " << type.imageBytes << "}";
+	}
+	p_stream << "\n\t]\n";
+
+	p_stream << "}\n";
+}
+
+void MemoryAllocator::setJsonDump(const std::string& p_filePath, std::chrono::milliseconds p_interval) {
+	m_jsonDumpPath = p_filePath;
+	m_jsonDumpInterval = p_interval;
+	m_lastJsonDump = {};
+}
+
+void MemoryAllocator::update() {
+	if(!m_budgetCallbacks.empty()) {
+		std::vector<HeapBudget> heaps = getHeapBudgets();
+
+		for(uint32_t i = 0; i < heaps.size(); i++) {
+			if(static_cast<double>(heaps[i].usage) <= static_cast<double>(heaps[i].budget) * m_budgetThreshold) {
+				continue;
+			}
+
+			for(BudgetCallback& callback : m_budgetCallbacks) {
+				callback(i, heaps[i]);
+			}
+		}
+	}
+
+	if(m_jsonDumpPath.empty()) {
+		return;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if(now - m_lastJsonDump < m_jsonDumpInterval) {
+		return;
+	}
+
+	m_lastJsonDump = now;
+
+	std::ofstream file{m_jsonDumpPath, std::ios::trunc};
+	if(!file) {
+		std::cerr << "Failed to write memory report " << m_jsonDumpPath << '\n';
+		return;
+	}
+
+	writeJson(file);
+}
+
+} // FFL
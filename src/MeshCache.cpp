@@ -0,0 +1,244 @@
+#include "MeshCache.hpp"
+#include "MappedFile.hpp"
+#include "MeshCodec.hpp"
+#include "Utils.hpp"
+
+// STD
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+namespace FFL {
+
+static constexpr uint64_t SECTION_ALIGNMENT = 16;
+
+static uint64_t alignSection(uint64_t p_offset) {
+	return (p_offset + SECTION_ALIGNMENT - 1) & ~(SECTION_ALIGNMENT - 1);
+}
+
+// p_count elements of p_elementSize bytes at p_offset lie within the file, checked without sums or products that
+// a corrupt header could make wrap
+static bool sectionFits(uint64_t p_offset, uint64_t p_count, uint64_t p_elementSize, uint64_t p_fileSize) {
+	return p_offset <= p_fileSize && p_count <= (p_fileSize - p_offset) / p_elementSize;
+}
+
+std::string MeshCache::cachePathFor(const std::string& p_sourcePath) {
+	return std::filesystem::path{p_sourcePath}.replace_extension(".mesh").string();
+}
+
+uint32_t MeshCache::flagsFor(const Model::Builder::Options& p_options) {
+	uint32_t flags = 0;
+
+	if(p_options.optimizeVertexCache) {
+		flags |= FLAG_VERTEX_CACHE_OPTIMIZED;
+	}
+
+	if(p_options.optimizeOverdraw) {
+		flags |= FLAG_OVERDRAW_OPTIMIZED;
+	}
+
+	if(p_options.buildMeshlets) {
+		flags |= FLAG_MESHLETS;
+	}
+
+	if(p_options.lodCount > 1) {
+		flags |= (std::min(p_options.lodCount, 255u) << FLAG_LOD_COUNT_SHIFT) & FLAG_LOD_COUNT_MASK;
+	}
+
+	return flags;
+}
+
+MeshCache::SourceInfo MeshCache::querySource(const std::string& p_sourcePath) {
+	SourceInfo info = {};
+
+	std::error_code error;
+	uint64_t size = std::filesystem::file_size(p_sourcePath, error);
+	if(error) {
+		return info;
+	}
+
+	std::filesystem::file_time_type modifiedTime = std::filesystem::last_write_time(p_sourcePath, error);
+	if(error) {
+		return info;
+	}
+
+	info.exists = true;
+	info.size = size;
+	info.modifiedTime = static_cast<int64_t>(modifiedTime.time_since_epoch().count());
+
+	return info;
+}
+
+uint64_t MeshCache::hashSource(const std::string& p_sourcePath) {
+	MappedFile source{p_sourcePath};
+
+	return hashBytes(source.data(), source.size());
+}
+
+bool MeshCache::checkHeader(const std::string& p_cachePath, const std::string& p_sourcePath, const Model::Builder::Options& p_options) {
+	// Read without mapping, the cache may have to be written below and Windows refuses that while it is mapped
+	Header header = {};
+	{
+		std::ifstream file(p_cachePath, std::ios::binary);
+		if(!file.read(reinterpret_cast<char*>(&header), sizeof(Header))) {
+			return false;
+		}
+	}
+
+	// Compression only changes how the sections are stored, either kind of cache loads
+	if(header.magic != MAGIC || header.version != VERSION || header.vertexStride != sizeof(Model::Vertex) || (header.flags & ~FLAG_COMPRESSED) != flagsFor(p_options)) {
+		return false;
+	}
+
+	// A missing source means only the cooked mesh was shipped, otherwise the timestamp is the fast path and
+	// the content hash catches sources that were touched without changing (checkouts, copies)
+	SourceInfo source = querySource(p_sourcePath);
+	if(!source.exists || (source.size == header.sourceSize && source.modifiedTime == header.sourceModifiedTime)) {
+		return true;
+	}
+
+	if(source.size != header.sourceSize || hashSource(p_sourcePath) != header.sourceHash) {
+		return false;
+	}
+
+	// Store the new timestamp so later loads take the fast path again, a read-only cache just keeps hashing
+	std::fstream file(p_cachePath, std::ios::binary | std::ios::in | std::ios::out);
+	if(file.is_open()) {
+		file.seekp(offsetof(Header, sourceModifiedTime));
+		file.write(reinterpret_cast<const char*>(&source.modifiedTime), sizeof(source.modifiedTime));
+	}
+
+	return true;
+}
+
+bool MeshCache::load(const std::string& p_cachePath, const std::string& p_sourcePath, Model::Builder& p_builder) {
+	std::error_code error;
+	if(!std::filesystem::exists(p_cachePath, error) || !checkHeader(p_cachePath, p_sourcePath, p_builder.options)) {
+		return false;
+	}
+
+	std::unique_ptr<MappedFile> mapping = std::make_unique<MappedFile>(p_cachePath);
+	if(mapping->size() < sizeof(Header)) {
+		return false;
+	}
+
+	const Header* header = reinterpret_cast<const Header*>(mapping->data());
+	bool compressed = (header->flags & FLAG_COMPRESSED) != 0;
+
+	uint64_t vertexBytes = static_cast<uint64_t>(header->vertexCount) * sizeof(Model::Vertex);
+	uint64_t indexBytes = static_cast<uint64_t>(header->indexCount) * sizeof(uint32_t);
+	if(!compressed && (header->vertexBytes != vertexBytes || header->indexBytes != indexBytes)) {
+		return false;
+	}
+
+	uint64_t fileSize = mapping->size();
+	if(!sectionFits(header->vertexOffset, header->vertexBytes, 1, fileSize) || !sectionFits(header->indexOffset, header->indexBytes, 1, fileSize) || !sectionFits(header->lodOffset, header->lodCount, sizeof(Model::Lod), fileSize) || !sectionFits(header->meshletOffset, header->meshletCount, sizeof(Meshlet), fileSize)) {
+		return false;
+	}
+
+	p_builder.vertices.clear();
+	p_builder.indices.clear();
+	p_builder.lods.clear();
+	p_builder.meshlets.clear();
+
+	// Decoded into the builder's arrays, the LOD table and meshlets are still read from the mapping
+	if(compressed) {
+		p_builder.vertices.resize(header->vertexCount);
+		p_builder.indices.resize(header->indexCount);
+
+		const uint8_t* vertexData = reinterpret_cast<const uint8_t*>(mapping->data() + header->vertexOffset);
+		const uint8_t* indexData = reinterpret_cast<const uint8_t*>(mapping->data() + header->indexOffset);
+		if(!MeshCodec::decodeVertices(p_builder.vertices.data(), header->vertexCount, sizeof(Model::Vertex), vertexData, header->vertexBytes) || !MeshCodec::decodeIndices(p_builder.indices.data(), header->indexCount, indexData, header->indexBytes)) {
+			p_builder.vertices.clear();
+			p_builder.indices.clear();
+			return false;
+		}
+
+		p_builder.m_mappedVertices = p_builder.vertices.data();
+		p_builder.m_mappedIndices = p_builder.indices.data();
+	} else {
+		p_builder.m_mappedVertices = reinterpret_cast<const Model::Vertex*>(mapping->data() + header->vertexOffset);
+		p_builder.m_mappedIndices = reinterpret_cast<const uint32_t*>(mapping->data() + header->indexOffset);
+	}
+
+	p_builder.m_mappedVertexCount = header->vertexCount;
+	p_builder.m_mappedIndexCount = header->indexCount;
+	p_builder.m_mappedLods = reinterpret_cast<const Model::Lod*>(mapping->data() + header->lodOffset);
+	p_builder.m_mappedLodCount = header->lodCount;
+	p_builder.m_mappedMeshlets = reinterpret_cast<const Meshlet*>(mapping->data() + header->meshletOffset);
+	p_builder.m_mappedMeshletCount = header->meshletCount;
+	p_builder.m_processFlags = header->flags;
+	p_builder.m_sourceHash = header->sourceHash;
+	p_builder.m_mapping = std::move(mapping);
+
+	return true;
+}
+
+void MeshCache::write(const std::string& p_cachePath, const std::string& p_sourcePath, const Model::Builder& p_builder) {
+	SourceInfo source = querySource(p_sourcePath);
+	if(!source.exists) {
+		throw std::runtime_error("failed to stat mesh source: " + p_sourcePath);
+	}
+
+	bool compressed = p_builder.options.compressCache;
+
+	std::vector<uint8_t> encodedVertices = {};
+	std::vector<uint8_t> encodedIndices = {};
+	if(compressed) {
+		encodedVertices = MeshCodec::encodeVertices(p_builder.vertexData(), p_builder.vertexCount(), sizeof(Model::Vertex));
+		encodedIndices = MeshCodec::encodeIndices(p_builder.indexData(), p_builder.indexCount());
+	}
+
+	Header header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.vertexStride = sizeof(Model::Vertex);
+	header.flags = (p_builder.m_processFlags & ~FLAG_COMPRESSED) | (compressed ? FLAG_COMPRESSED : 0);
+	header.sourceSize = source.size;
+	header.sourceModifiedTime = source.modifiedTime;
+	header.sourceHash = p_builder.m_sourceHash != 0 ? p_builder.m_sourceHash : hashSource(p_sourcePath);
+	header.vertexCount = p_builder.vertexCount();
+	header.indexCount = p_builder.indexCount();
+	header.vertexBytes = compressed ? encodedVertices.size() : static_cast<uint64_t>(header.vertexCount) * sizeof(Model::Vertex);
+	header.indexBytes = compressed ? encodedIndices.size() : static_cast<uint64_t>(header.indexCount) * sizeof(uint32_t);
+	header.vertexOffset = alignSection(sizeof(Header));
+	header.indexOffset = alignSection(header.vertexOffset + header.vertexBytes);
+	header.lodCount = p_builder.lodCount();
+	header.lodOffset = alignSection(header.indexOffset + header.indexBytes);
+	header.meshletCount = p_builder.meshletCount();
+	header.meshletOffset = alignSection(header.lodOffset + static_cast<uint64_t>(header.lodCount) * sizeof(Model::Lod));
+
+	// Write next to the destination and rename, so a crash never leaves a truncated cache behind
+	std::string tempPath = p_cachePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if(!file.is_open()) {
+			throw std::runtime_error("failed to open file: " + tempPath);
+		}
+
+		const char padding[SECTION_ALIGNMENT] = {};
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		file.write(padding, header.vertexOffset - sizeof(Header));
+		file.write(compressed ? reinterpret_cast<const char*>(encodedVertices.data()) : reinterpret_cast<const char*>(p_builder.vertexData()), static_cast<std::streamsize>(header.vertexBytes));
+		file.write(padding, header.indexOffset - header.vertexOffset - header.vertexBytes);
+		file.write(compressed ? reinterpret_cast<const char*>(encodedIndices.data()) : reinterpret_cast<const char*>(p_builder.indexData()), static_cast<std::streamsize>(header.indexBytes));
+		file.write(padding, header.lodOffset - header.indexOffset - header.indexBytes);
+		file.write(reinterpret_cast<const char*>(p_builder.lodData()), static_cast<std::streamsize>(header.lodCount) * sizeof(Model::Lod));
+		file.write(padding, header.meshletOffset - header.lodOffset - header.lodCount * sizeof(Model::Lod));
+		file.write(reinterpret_cast<const char*>(p_builder.meshletData()), static_cast<std::streamsize>(header.meshletCount) * sizeof(Meshlet));
+
+		if(!file.good()) {
+			throw std::runtime_error("failed to write mesh cache: " + tempPath);
+		}
+	}
+
+	std::filesystem::rename(tempPath, p_cachePath);
+}
+
+} // FFL
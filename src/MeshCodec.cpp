@@ -0,0 +1,352 @@
+#include "MeshCodec.hpp"
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#if defined(__SSSE3__) || defined(__AVX__)
+#define FFL_MESHCODEC_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace FFL {
+
+// Vertices whose byte planes are decoded together, small enough for the planes to stay in L1
+static constexpr size_t BLOCK_SIZE = 256;
+static constexpr size_t GROUP_SIZE = 16;
+// The vertex stream ends in this many zero bytes, so the decoder can always load a whole group
+static constexpr size_t TAIL_PADDING = 16;
+
+// Bits per value for each 2-bit group header code
+static constexpr uint32_t GROUP_WIDTHS[4] = {0, 2, 4, 8};
+
+static void writeVarint(std::vector<uint8_t>& p_data, uint32_t p_value) {
+	while(p_value >= 0x80) {
+		p_data.push_back(static_cast<uint8_t>(p_value | 0x80));
+		p_value >>= 7;
+	}
+
+	p_data.push_back(static_cast<uint8_t>(p_value));
+}
+
+static bool readVarint(const uint8_t*& p_data, const uint8_t* p_end, uint32_t& p_value) {
+	p_value = 0;
+
+	for(uint32_t shift = 0; shift < 35; shift += 7) {
+		if(p_data == p_end) {
+			return false;
+		}
+
+		uint8_t byte = *p_data++;
+		p_value |= static_cast<uint32_t>(byte & 0x7f) << shift;
+
+		if((byte & 0x80) == 0) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static uint32_t zigzag(int32_t p_value) {
+	return (static_cast<uint32_t>(p_value) << 1) ^ static_cast<uint32_t>(p_value >> 31);
+}
+
+static int32_t unzigzag(uint32_t p_value) {
+	return static_cast<int32_t>(p_value >> 1) ^ -static_cast<int32_t>(p_value & 1);
+}
+
+std::vector<uint8_t> MeshCodec::encodeIndices(const uint32_t* p_indices, size_t p_indexCount) {
+	assert(p_indexCount % 3 == 0 && "Index count must be a multiple of 3");
+
+	std::vector<uint8_t> data = {};
+	data.reserve(p_indexCount * 2);
+
+	uint32_t previous = 0;
+
+	for(size_t i = 0; i < p_indexCount; i += 3) {
+		uint32_t a = p_indices[i + 0], b = p_indices[i + 1], c = p_indices[i + 2];
+
+		// Rotating keeps the winding, with the largest index first the other two are small positive offsets
+		if(b >= a && b >= c) {
+			std::swap(a, b);
+			std::swap(b, c);
+		} else if(c >= a && c >= b) {
+			std::swap(a, c);
+			std::swap(b, c);
+		}
+
+		writeVarint(data, zigzag(static_cast<int32_t>(a - previous)));
+		writeVarint(data, a - b);
+		writeVarint(data, a - c);
+
+		previous = a;
+	}
+
+	return data;
+}
+
+bool MeshCodec::decodeIndices(uint32_t* p_destination, size_t p_indexCount, const uint8_t* p_data, size_t p_size) {
+	if(p_indexCount % 3 != 0) {
+		return false;
+	}
+
+	const uint8_t* data = p_data;
+	const uint8_t* end = p_data + p_size;
+
+	uint32_t previous = 0;
+
+	for(size_t i = 0; i < p_indexCount; i += 3) {
+		uint32_t delta, offsetB, offsetC;
+		if(!readVarint(data, end, delta) || !readVarint(data, end, offsetB) || !readVarint(data, end, offsetC)) {
+			return false;
+		}
+
+		uint32_t a = previous + static_cast<uint32_t>(unzigzag(delta));
+		if(offsetB > a || offsetC > a) {
+			return false;
+		}
+
+		p_destination[i + 0] = a;
+		p_destination[i + 1] = a - offsetB;
+		p_destination[i + 2] = a - offsetC;
+
+		previous = a;
+	}
+
+	return data == end;
+}
+
+std::vector<uint8_t> MeshCodec::encodeVertices(const void* p_vertices, size_t p_vertexCount, size_t p_vertexSize) {
+	const uint8_t* vertices = static_cast<const uint8_t*>(p_vertices);
+
+	std::vector<uint8_t> data = {};
+	data.reserve(p_vertexCount * p_vertexSize / 2 + TAIL_PADDING);
+
+	// Deltas continue across blocks, each plane starts from the same byte of the block's previous vertex
+	std::vector<uint8_t> previous(p_vertexSize, 0);
+
+	for(size_t blockStart = 0; blockStart < p_vertexCount; blockStart += BLOCK_SIZE) {
+		size_t blockSize = std::min(BLOCK_SIZE, p_vertexCount - blockStart);
+		size_t groupCount = (blockSize + GROUP_SIZE - 1) / GROUP_SIZE;
+
+		for(size_t k = 0; k < p_vertexSize; k++) {
+			uint8_t deltas[BLOCK_SIZE] = {};
+
+			for(size_t i = 0; i < blockSize; i++) {
+				uint8_t byte = vertices[(blockStart + i) * p_vertexSize + k];
+				int8_t delta = static_cast<int8_t>(byte - previous[k]);
+				deltas[i] = static_cast<uint8_t>((static_cast<uint8_t>(delta) << 1) ^ static_cast<uint8_t>(delta >> 7));
+				previous[k] = byte;
+			}
+
+			size_t headerOffset = data.size();
+			data.resize(data.size() + (groupCount + 3) / 4, 0);
+
+			for(size_t group = 0; group < groupCount; group++) {
+				const uint8_t* values = deltas + group * GROUP_SIZE;
+
+				uint8_t combined = 0;
+				for(size_t j = 0; j < GROUP_SIZE; j++) {
+					combined |= values[j];
+				}
+
+				uint32_t code = combined == 0 ? 0 : combined < 4 ? 1 : combined < 16 ? 2 : 3;
+				data[headerOffset + group / 4] |= static_cast<uint8_t>(code << ((group % 4) * 2));
+
+				uint32_t width = GROUP_WIDTHS[code];
+				if(width == 0) {
+					continue;
+				}
+
+				uint32_t perByte = 8 / width;
+				size_t groupOffset = data.size();
+				data.resize(data.size() + GROUP_SIZE / perByte, 0);
+
+				for(size_t j = 0; j < GROUP_SIZE; j++) {
+					data[groupOffset + j / perByte] |= static_cast<uint8_t>(values[j] << ((j % perByte) * width));
+				}
+			}
+		}
+	}
+
+	data.resize(data.size() + TAIL_PADDING, 0);
+
+	return data;
+}
+
+#ifdef FFL_MESHCODEC_SSSE3
+// Unpacks, unzigzags and prefix sums one group, p_previous holds the last decoded byte in every lane
+static __m128i decodeGroup(const uint8_t* p_data, uint32_t p_width, __m128i& p_previous) {
+	__m128i values = _mm_setzero_si128();
+
+	if(p_width == 2) {
+		int32_t packed;
+		memcpy(&packed, p_data, sizeof(packed));
+
+		__m128i bits = _mm_cvtsi32_si128(packed);
+		__m128i mask = _mm_set1_epi8(0x03);
+		__m128i b0 = _mm_and_si128(bits, mask);
+		__m128i b1 = _mm_and_si128(_mm_srli_epi16(bits, 2), mask);
+		__m128i b2 = _mm_and_si128(_mm_srli_epi16(bits, 4), mask);
+		__m128i b3 = _mm_and_si128(_mm_srli_epi16(bits, 6), mask);
+		values = _mm_unpacklo_epi16(_mm_unpacklo_epi8(b0, b1), _mm_unpacklo_epi8(b2, b3));
+	} else if(p_width == 4) {
+		__m128i bits = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p_data));
+		__m128i mask = _mm_set1_epi8(0x0f);
+		values = _mm_unpacklo_epi8(_mm_and_si128(bits, mask), _mm_and_si128(_mm_srli_epi16(bits, 4), mask));
+	} else if(p_width == 8) {
+		values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_data));
+	}
+
+	__m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(values, _mm_set1_epi8(1)));
+	__m128i deltas = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(values, 1), _mm_set1_epi8(0x7f)), sign);
+
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 1));
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 2));
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 4));
+	deltas = _mm_add_epi8(deltas, _mm_slli_si128(deltas, 8));
+	deltas = _mm_add_epi8(deltas, p_previous);
+
+	p_previous = _mm_shuffle_epi8(deltas, _mm_set1_epi8(GROUP_SIZE - 1));
+
+	return deltas;
+}
+
+// Interleaves 16 planes of 16 vertices back into vertices, bytes p_firstByte to p_firstByte + 15 of each
+// A partial last tile stores whole rows that spill into the next vertex, so tiles must go from the last to the first
+static void transposeTile(const uint8_t* p_planes, size_t p_firstByte, size_t p_vertexSize, size_t p_vertexCount, uint8_t* p_vertices) {
+	size_t byteCount = std::min(GROUP_SIZE, p_vertexSize - p_firstByte);
+
+	__m128i rows[GROUP_SIZE];
+	for(size_t k = 0; k < GROUP_SIZE; k++) {
+		rows[k] = k < byteCount ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(p_planes + (p_firstByte + k) * BLOCK_SIZE)) : _mm_setzero_si128();
+	}
+
+	// Four rounds of interleaving the two halves transpose a 16x16 byte matrix
+	for(uint32_t round = 0; round < 4; round++) {
+		__m128i interleaved[GROUP_SIZE];
+		for(size_t k = 0; k < GROUP_SIZE / 2; k++) {
+			interleaved[2 * k + 0] = _mm_unpacklo_epi8(rows[k], rows[k + GROUP_SIZE / 2]);
+			interleaved[2 * k + 1] = _mm_unpackhi_epi8(rows[k], rows[k + GROUP_SIZE / 2]);
+		}
+
+		std::copy(interleaved, interleaved + GROUP_SIZE, rows);
+	}
+
+	for(size_t i = 0; i < p_vertexCount; i++) {
+		uint8_t* vertex = p_vertices + i * p_vertexSize + p_firstByte;
+
+		if(byteCount == GROUP_SIZE || i * p_vertexSize + p_firstByte + GROUP_SIZE <= p_vertexCount * p_vertexSize) {
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(vertex), rows[i]);
+		} else {
+			alignas(16) uint8_t bytes[GROUP_SIZE];
+			_mm_store_si128(reinterpret_cast<__m128i*>(bytes), rows[i]);
+			memcpy(vertex, bytes, byteCount);
+		}
+	}
+}
+#else
+static void decodeGroup(const uint8_t* p_data, uint32_t p_width, uint8_t& p_previous, uint8_t* p_destination) {
+	uint8_t value = p_previous;
+
+	for(size_t j = 0; j < GROUP_SIZE; j++) {
+		uint8_t packed = 0;
+
+		if(p_width != 0) {
+			uint32_t perByte = 8 / p_width;
+			packed = static_cast<uint8_t>((p_data[j / perByte] >> ((j % perByte) * p_width)) & ((1u << p_width) - 1));
+		}
+
+		value = static_cast<uint8_t>(value + ((packed >> 1) ^ -(packed & 1)));
+		p_destination[j] = value;
+	}
+
+	p_previous = value;
+}
+#endif
+
+bool MeshCodec::decodeVertices(void* p_destination, size_t p_vertexCount, size_t p_vertexSize, const uint8_t* p_data, size_t p_size) {
+	if(p_size < TAIL_PADDING) {
+		return false;
+	}
+
+	uint8_t* destination = static_cast<uint8_t*>(p_destination);
+
+	const uint8_t* data = p_data;
+	// Group loads may read up to 16 bytes past this into the padding
+	const uint8_t* end = p_data + p_size - TAIL_PADDING;
+
+	std::vector<uint8_t> planes(p_vertexSize * BLOCK_SIZE);
+
+	std::vector<uint8_t> previous(p_vertexSize, 0);
+
+	for(size_t blockStart = 0; blockStart < p_vertexCount; blockStart += BLOCK_SIZE) {
+		size_t blockSize = std::min(BLOCK_SIZE, p_vertexCount - blockStart);
+		size_t groupCount = (blockSize + GROUP_SIZE - 1) / GROUP_SIZE;
+		size_t headerSize = (groupCount + 3) / 4;
+
+		for(size_t k = 0; k < p_vertexSize; k++) {
+			if(static_cast<size_t>(end - data) < headerSize) {
+				return false;
+			}
+
+			const uint8_t* header = data;
+			data += headerSize;
+
+			uint8_t* plane = planes.data() + k * BLOCK_SIZE;
+
+#ifdef FFL_MESHCODEC_SSSE3
+			__m128i last = _mm_set1_epi8(static_cast<char>(previous[k]));
+#else
+			uint8_t last = previous[k];
+#endif
+
+			for(size_t group = 0; group < groupCount; group++) {
+				uint32_t width = GROUP_WIDTHS[(header[group / 4] >> ((group % 4) * 2)) & 3];
+				size_t groupBytes = GROUP_SIZE * width / 8;
+
+				if(static_cast<size_t>(end - data) < groupBytes) {
+					return false;
+				}
+
+#ifdef FFL_MESHCODEC_SSSE3
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(plane + group * GROUP_SIZE), decodeGroup(data, width, last));
+#else
+				decodeGroup(data, width, last, plane + group * GROUP_SIZE);
+#endif
+
+				data += groupBytes;
+			}
+
+#ifdef FFL_MESHCODEC_SSSE3
+			previous[k] = static_cast<uint8_t>(_mm_cvtsi128_si32(last));
+#else
+			previous[k] = last;
+#endif
+		}
+
+		// Transpose the planes back into interleaved vertices
+		uint8_t* vertices = destination + blockStart * p_vertexSize;
+
+#ifdef FFL_MESHCODEC_SSSE3
+		for(size_t i = 0; i < blockSize; i += GROUP_SIZE) {
+			// k wraps around after the first tile and ends the loop
+			for(size_t k = (p_vertexSize - 1) / GROUP_SIZE * GROUP_SIZE; k < p_vertexSize; k -= GROUP_SIZE) {
+				transposeTile(planes.data() + i, k, p_vertexSize, std::min(GROUP_SIZE, blockSize - i), vertices + i * p_vertexSize);
+			}
+		}
+#else
+		for(size_t i = 0; i < blockSize; i++) {
+			for(size_t k = 0; k < p_vertexSize; k++) {
+				vertices[i * p_vertexSize + k] = planes[k * BLOCK_SIZE + i];
+			}
+		}
+#endif
+	}
+
+	return data == end;
+}
+
+} // FFL
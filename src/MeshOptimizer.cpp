@@ -0,0 +1,349 @@
+#include "MeshOptimizer.hpp"
+
+// Libraries
+#include <glm/glm.hpp>
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace FFL {
+
+// Forsyth's scoring favours the triangles just emitted and vertices with few triangles left, the LRU cache it
+// models is larger than the hardware's FIFO so the ordering is not tuned to one particular GPU
+static constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+static constexpr uint32_t FORSYTH_MAX_VALENCE = 32;
+static constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+static constexpr float FORSYTH_CACHE_DECAY_POWER = 1.5f;
+static constexpr float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+static constexpr float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+// Cache size used to find cluster boundaries for overdraw ordering
+static constexpr uint32_t CLUSTER_CACHE_SIZE = 16;
+
+struct ForsythScores {
+	float cache[FORSYTH_CACHE_SIZE];
+	float valence[FORSYTH_MAX_VALENCE];
+
+	ForsythScores() {
+		for(uint32_t i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+			if(i < 3) {
+				cache[i] = FORSYTH_LAST_TRIANGLE_SCORE;
+			} else {
+				float scaled = 1.0f - static_cast<float>(i - 3) / static_cast<float>(FORSYTH_CACHE_SIZE - 3);
+				cache[i] = std::pow(scaled, FORSYTH_CACHE_DECAY_POWER);
+			}
+		}
+
+		valence[0] = 0.0f;
+		for(uint32_t i = 1; i < FORSYTH_MAX_VALENCE; i++) {
+			valence[i] = FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -FORSYTH_VALENCE_BOOST_POWER);
+		}
+	}
+
+	float score(int32_t p_cachePosition, uint32_t p_liveTriangles) const {
+		float result = p_cachePosition < 0 ? 0.0f : cache[p_cachePosition];
+
+		return result + valence[std::min(p_liveTriangles, FORSYTH_MAX_VALENCE - 1)];
+	}
+};
+
+// FIFO cache simulation using timestamps, bumping p_time by more than the cache size empties the cache
+static uint32_t countMisses(const uint32_t* p_triangle, std::vector<uint32_t>& p_cacheTimes, uint32_t& p_time, uint32_t p_cacheSize) {
+	uint32_t misses = 0;
+
+	for(uint32_t k = 0; k < 3; k++) {
+		uint32_t vertex = p_triangle[k];
+
+		if(p_time - p_cacheTimes[vertex] > p_cacheSize) {
+			p_cacheTimes[vertex] = p_time++;
+			misses++;
+		}
+	}
+
+	return misses;
+}
+
+static glm::vec3 loadPosition(const float* p_positions, size_t p_stride, uint32_t p_vertex) {
+	const float* position = reinterpret_cast<const float*>(reinterpret_cast<const char*>(p_positions) + p_stride * p_vertex);
+
+	return {position[0], position[1], position[2]};
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::analyzeVertexCache(const uint32_t* p_indices, size_t p_indexCount, size_t p_vertexCount, uint32_t p_cacheSize) {
+	assert(p_indexCount % 3 == 0 && "Index count must be a multiple of 3");
+
+	CacheStatistics statistics = {};
+	if(p_indexCount == 0) {
+		return statistics;
+	}
+
+	std::vector<uint32_t> cacheTimes(p_vertexCount, 0);
+	uint32_t time = p_cacheSize + 1;
+	uint32_t misses = 0;
+
+	for(size_t i = 0; i < p_indexCount; i += 3) {
+		misses += countMisses(&p_indices[i], cacheTimes, time, p_cacheSize);
+	}
+
+	uint32_t referencedVertices = 0;
+	for(uint32_t cacheTime : cacheTimes) {
+		referencedVertices += cacheTime != 0;
+	}
+
+	statistics.acmr = static_cast<float>(misses) / static_cast<float>(p_indexCount / 3);
+	statistics.atvr = static_cast<float>(misses) / static_cast<float>(referencedVertices);
+
+	return statistics;
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32_t* p_indices, size_t p_indexCount, size_t p_vertexCount) {
+	assert(p_indexCount % 3 == 0 && "Index count must be a multiple of 3");
+
+	size_t triangleCount = p_indexCount / 3;
+	if(triangleCount == 0) {
+		return;
+	}
+
+	static const ForsythScores scores = {};
+
+	// Per-vertex lists of the triangles not emitted yet, liveTriangles[v] is the length of v's list
+	std::vector<uint32_t> liveTriangles(p_vertexCount, 0);
+	for(size_t i = 0; i < p_indexCount; i++) {
+		liveTriangles[p_indices[i]]++;
+	}
+
+	std::vector<uint32_t> adjacencyOffsets(p_vertexCount + 1, 0);
+	for(size_t i = 0; i < p_vertexCount; i++) {
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+	}
+
+	std::vector<uint32_t> adjacency(p_indexCount);
+	std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for(size_t i = 0; i < p_indexCount; i++) {
+		adjacency[fillOffsets[p_indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<float> vertexScores(p_vertexCount);
+	for(size_t i = 0; i < p_vertexCount; i++) {
+		vertexScores[i] = scores.score(-1, liveTriangles[i]);
+	}
+
+	std::vector<float> triangleScores(triangleCount);
+	for(size_t i = 0; i < triangleCount; i++) {
+		triangleScores[i] = vertexScores[p_indices[3 * i + 0]] + vertexScores[p_indices[3 * i + 1]] + vertexScores[p_indices[3 * i + 2]];
+	}
+
+	std::vector<uint8_t> emitted(triangleCount, 0);
+	std::vector<uint32_t> output(p_indexCount);
+
+	uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+	uint32_t cacheSize = 0;
+
+	size_t bestTriangle = std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin();
+	size_t inputCursor = 0;
+
+	for(size_t outputTriangle = 0; outputTriangle < triangleCount; outputTriangle++) {
+		// Dead end, nothing in the cache has triangles left so continue with the next one in input order
+		if(bestTriangle == SIZE_MAX) {
+			while(emitted[inputCursor]) {
+				inputCursor++;
+			}
+
+			bestTriangle = inputCursor;
+		}
+
+		const uint32_t* triangle = &p_indices[3 * bestTriangle];
+		output[3 * outputTriangle + 0] = triangle[0];
+		output[3 * outputTriangle + 1] = triangle[1];
+		output[3 * outputTriangle + 2] = triangle[2];
+		emitted[bestTriangle] = 1;
+
+		uint32_t newCacheSize = 0;
+
+		for(uint32_t k = 0; k < 3; k++) {
+			uint32_t vertex = triangle[k];
+
+			uint32_t* triangles = &adjacency[adjacencyOffsets[vertex]];
+			uint32_t* last = triangles + liveTriangles[vertex] - 1;
+			std::iter_swap(std::find(triangles, last, static_cast<uint32_t>(bestTriangle)), last);
+			liveTriangles[vertex]--;
+
+			if(std::find(newCache, newCache + newCacheSize, vertex) == newCache + newCacheSize) {
+				newCache[newCacheSize++] = vertex;
+			}
+		}
+
+		for(uint32_t i = 0; i < cacheSize; i++) {
+			if(cache[i] != triangle[0] && cache[i] != triangle[1] && cache[i] != triangle[2]) {
+				newCache[newCacheSize++] = cache[i];
+			}
+		}
+
+		// Rescore everything whose cache position or valence changed, including the vertices pushed out
+		for(uint32_t i = 0; i < newCacheSize; i++) {
+			uint32_t vertex = newCache[i];
+			int32_t position = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+
+			float score = scores.score(position, liveTriangles[vertex]);
+			float delta = score - vertexScores[vertex];
+			vertexScores[vertex] = score;
+
+			const uint32_t* triangles = &adjacency[adjacencyOffsets[vertex]];
+			for(uint32_t j = 0; j < liveTriangles[vertex]; j++) {
+				triangleScores[triangles[j]] += delta;
+			}
+		}
+
+		cacheSize = std::min(newCacheSize, FORSYTH_CACHE_SIZE);
+		std::copy(newCache, newCache + cacheSize, cache);
+
+		bestTriangle = SIZE_MAX;
+		float bestScore = -1.0f;
+
+		for(uint32_t i = 0; i < cacheSize; i++) {
+			uint32_t vertex = cache[i];
+
+			const uint32_t* triangles = &adjacency[adjacencyOffsets[vertex]];
+			for(uint32_t j = 0; j < liveTriangles[vertex]; j++) {
+				if(triangleScores[triangles[j]] > bestScore) {
+					bestScore = triangleScores[triangles[j]];
+					bestTriangle = triangles[j];
+				}
+			}
+		}
+	}
+
+	std::copy(output.begin(), output.end(), p_indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(uint32_t* p_indices, size_t p_indexCount, const float* p_positions, size_t p_vertexCount, size_t p_vertexStride, float p_threshold) {
+	assert(p_indexCount % 3 == 0 && "Index count must be a multiple of 3");
+
+	size_t triangleCount = p_indexCount / 3;
+	if(triangleCount == 0) {
+		return;
+	}
+
+	std::vector<uint32_t> cacheTimes(p_vertexCount, 0);
+	uint32_t time = CLUSTER_CACHE_SIZE + 1;
+
+	// Hard boundaries are where the cache optimizer had to restart, nothing is shared across them
+	std::vector<size_t> hardBoundaries = {};
+	for(size_t i = 0; i < triangleCount; i++) {
+		if(countMisses(&p_indices[3 * i], cacheTimes, time, CLUSTER_CACHE_SIZE) == 3) {
+			hardBoundaries.push_back(i);
+		}
+	}
+
+	hardBoundaries.push_back(triangleCount);
+
+	// Soft boundaries split a hard cluster as soon as the piece so far is within p_threshold of the cluster's ACMR
+	std::vector<size_t> clusters = {};
+	for(size_t i = 0; i + 1 < hardBoundaries.size(); i++) {
+		size_t start = hardBoundaries[i];
+		size_t end = hardBoundaries[i + 1];
+
+		time += CLUSTER_CACHE_SIZE + 1;
+		uint32_t clusterMisses = 0;
+		for(size_t j = start; j < end; j++) {
+			clusterMisses += countMisses(&p_indices[3 * j], cacheTimes, time, CLUSTER_CACHE_SIZE);
+		}
+
+		float missThreshold = p_threshold * static_cast<float>(clusterMisses) / static_cast<float>(end - start);
+
+		time += CLUSTER_CACHE_SIZE + 1;
+		clusters.push_back(start);
+
+		size_t softStart = start;
+		uint32_t softMisses = 0;
+		for(size_t j = start; j < end; j++) {
+			softMisses += countMisses(&p_indices[3 * j], cacheTimes, time, CLUSTER_CACHE_SIZE);
+
+			if(j + 1 < end && static_cast<float>(softMisses) <= missThreshold * static_cast<float>(j + 1 - softStart)) {
+				clusters.push_back(j + 1);
+				softStart = j + 1;
+				softMisses = 0;
+				time += CLUSTER_CACHE_SIZE + 1;
+			}
+		}
+	}
+
+	clusters.push_back(triangleCount);
+	size_t clusterCount = clusters.size() - 1;
+
+	glm::vec3 meshCentroid = {};
+	for(size_t i = 0; i < p_vertexCount; i++) {
+		meshCentroid += loadPosition(p_positions, p_vertexStride, static_cast<uint32_t>(i));
+	}
+
+	meshCentroid /= static_cast<float>(std::max<size_t>(p_vertexCount, 1));
+
+	// Clusters far out along their own normal are likely to occlude the rest of the mesh, so they go first
+	std::vector<float> sortKeys(clusterCount);
+	for(size_t i = 0; i < clusterCount; i++) {
+		glm::vec3 centroid = {};
+		glm::vec3 normal = {};
+		float area = 0.0f;
+
+		for(size_t j = clusters[i]; j < clusters[i + 1]; j++) {
+			glm::vec3 a = loadPosition(p_positions, p_vertexStride, p_indices[3 * j + 0]);
+			glm::vec3 b = loadPosition(p_positions, p_vertexStride, p_indices[3 * j + 1]);
+			glm::vec3 c = loadPosition(p_positions, p_vertexStride, p_indices[3 * j + 2]);
+
+			glm::vec3 triangleNormal = glm::cross(b - a, c - a);
+			float triangleArea = glm::length(triangleNormal);
+
+			centroid += (a + b + c) * (triangleArea / 3.0f);
+			normal += triangleNormal;
+			area += triangleArea;
+		}
+
+		float normalLength = glm::length(normal);
+		if(area <= 0.0f || normalLength <= 0.0f) {
+			sortKeys[i] = 0.0f;
+			continue;
+		}
+
+		sortKeys[i] = glm::dot(centroid / area - meshCentroid, normal / normalLength);
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	for(size_t i = 0; i < clusterCount; i++) {
+		order[i] = static_cast<uint32_t>(i);
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&](uint32_t p_a, uint32_t p_b) {
+		return sortKeys[p_a] > sortKeys[p_b];
+	});
+
+	std::vector<uint32_t> output = {};
+	output.reserve(p_indexCount);
+
+	for(uint32_t cluster : order) {
+		output.insert(output.end(), p_indices + 3 * clusters[cluster], p_indices + 3 * clusters[cluster + 1]);
+	}
+
+	std::copy(output.begin(), output.end(), p_indices);
+}
+
+uint32_t MeshOptimizer::buildFetchRemap(uint32_t* p_indices, size_t p_indexCount, size_t p_vertexCount, std::vector<uint32_t>& p_remap) {
+	p_remap.assign(p_vertexCount, UINT32_MAX);
+
+	uint32_t nextVertex = 0;
+	for(size_t i = 0; i < p_indexCount; i++) {
+		uint32_t& remapped = p_remap[p_indices[i]];
+
+		if(remapped == UINT32_MAX) {
+			remapped = nextVertex++;
+		}
+
+		p_indices[i] = remapped;
+	}
+
+	return nextVertex;
+}
+
+} // FFL
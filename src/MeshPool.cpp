@@ -0,0 +1,427 @@
+#include "MeshPool.hpp"
+#include "Device.hpp"
+#include "FrameArena.hpp"
+#include "SwapChain.hpp"
+#include "UploadBatcher.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <utility>
+
+namespace FFL {
+
+// Index ranges start on a 4 byte boundary, so both index types can address them
+static constexpr uint64_t INDEX_ALIGNMENT = sizeof(uint32_t);
+
+MeshPool::MeshPool(Device& p_device, uint32_t p_vertexStride, uint32_t p_positionStride) : m_device{p_device}, m_vertexStride{p_vertexStride}, m_positionStride{p_positionStride}, m_hostWritable{p_device.hasUnifiedMemory()} {}
+
+MeshPool::~MeshPool() {}
+
+void MeshPool::createBlock(uint32_t p_vertexCapacity, VkDeviceSize p_indexCapacity) {
+	VkMemoryPropertyFlags memoryProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	if(m_hostWritable) {
+		memoryProperties |= VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	}
+
+	Block block = {};
+	block.vertexBuffer = std::make_unique<Buffer>(m_device, m_vertexStride, p_vertexCapacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryProperties);
+	if(m_positionStride != 0) {
+		block.positionBuffer = std::make_unique<Buffer>(m_device, m_positionStride, p_vertexCapacity, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryProperties);
+	}
+
+	block.indexBuffer = std::make_unique<Buffer>(m_device, INDEX_ALIGNMENT, static_cast<uint32_t>(p_indexCapacity / INDEX_ALIGNMENT), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, memoryProperties);
+
+	if(m_hostWritable) {
+		block.vertexBuffer->map();
+		if(block.positionBuffer != nullptr) {
+			block.positionBuffer->map();
+		}
+
+		block.indexBuffer->map();
+	}
+
+	block.vertices = RangeAllocator{p_vertexCapacity};
+	block.indexBytes = RangeAllocator{p_indexCapacity};
+
+	// Reuse the slot of a released block, allocations refer to blocks by index
+	auto freeSlot = std::find_if(m_blocks.begin(), m_blocks.end(), [](const Block& p_block) {
+		return p_block.vertexBuffer == nullptr;
+	});
+
+	if(freeSlot != m_blocks.end()) {
+		*freeSlot = std::move(block);
+	} else {
+		m_blocks.push_back(std::move(block));
+	}
+}
+
+bool MeshPool::tryAllocate(uint32_t p_block, Allocation& p_allocation) {
+	Block& block = m_blocks[p_block];
+	if(block.vertexBuffer == nullptr) {
+		return false;
+	}
+
+	uint64_t vertexOffset = block.vertices.allocate(p_allocation.vertexCount);
+	if(vertexOffset == RangeAllocator::INVALID_OFFSET) {
+		return false;
+	}
+
+	uint64_t indexBytes = static_cast<uint64_t>(p_allocation.indexCount) * p_allocation.indexSize();
+	uint64_t indexByteOffset = 0;
+
+	if(indexBytes > 0) {
+		indexByteOffset = block.indexBytes.allocate((indexBytes + INDEX_ALIGNMENT - 1) & ~(INDEX_ALIGNMENT - 1), INDEX_ALIGNMENT);
+
+		if(indexByteOffset == RangeAllocator::INVALID_OFFSET) {
+			block.vertices.free(vertexOffset, p_allocation.vertexCount);
+			return false;
+		}
+	}
+
+	p_allocation.block = p_block;
+	p_allocation.vertexOffset = static_cast<uint32_t>(vertexOffset);
+	p_allocation.indexByteOffset = indexByteOffset;
+
+	return true;
+}
+
+MeshPool::Handle MeshPool::allocate(uint32_t p_vertexCount, uint32_t p_indexCount, VkIndexType p_indexType) {
+	Allocation allocation = {};
+	allocation.vertexCount = p_vertexCount;
+	allocation.indexCount = p_indexCount;
+	allocation.indexType = p_indexType;
+
+	bool allocated = false;
+	for(uint32_t i = 0; i < m_blocks.size() && !allocated; i++) {
+		allocated = tryAllocate(i, allocation);
+	}
+
+	// Meshes larger than a default block get a block of their own size
+	if(!allocated) {
+		VkDeviceSize indexBytes = (static_cast<VkDeviceSize>(p_indexCount) * allocation.indexSize() + INDEX_ALIGNMENT - 1) & ~(INDEX_ALIGNMENT - 1);
+		createBlock(std::max(p_vertexCount, DEFAULT_BLOCK_VERTICES), std::max(indexBytes, DEFAULT_BLOCK_INDEX_BYTES));
+
+		for(uint32_t i = 0; i < m_blocks.size() && !allocated; i++) {
+			allocated = tryAllocate(i, allocation);
+		}
+
+		assert(allocated && "A fresh block must fit the mesh it was sized for");
+	}
+
+	Handle handle;
+	if(!m_freeHandles.empty()) {
+		handle = m_freeHandles.back();
+		m_freeHandles.pop_back();
+		m_allocations[handle] = allocation;
+		m_referenceCounts[handle] = 1;
+	} else {
+		handle = static_cast<Handle>(m_allocations.size());
+		m_allocations.push_back(allocation);
+		m_referenceCounts.push_back(1);
+	}
+
+	return handle;
+}
+
+void MeshPool::retain(Handle p_handle) {
+	assert(m_referenceCounts[p_handle] > 0 && "Cannot retain a freed mesh");
+
+	m_referenceCounts[p_handle]++;
+}
+
+void MeshPool::free(Handle p_handle) {
+	if(p_handle == INVALID_HANDLE || --m_referenceCounts[p_handle] > 0) {
+		return;
+	}
+
+	m_pendingReleases.push_back({m_frame + SwapChain::MAX_FRAMES_IN_FLIGHT, p_handle, nullptr});
+}
+
+void MeshPool::deferDestroy(std::shared_ptr<Buffer> p_buffer) {
+	if(p_buffer == nullptr) {
+		return;
+	}
+
+	m_pendingReleases.push_back({m_frame + SwapChain::MAX_FRAMES_IN_FLIGHT, INVALID_HANDLE, std::move(p_buffer)});
+}
+
+void MeshPool::freeRanges(const Allocation& p_allocation) {
+	Block& block = m_blocks[p_allocation.block];
+
+	block.vertices.free(p_allocation.vertexOffset, p_allocation.vertexCount);
+
+	uint64_t indexBytes = static_cast<uint64_t>(p_allocation.indexCount) * p_allocation.indexSize();
+	if(indexBytes > 0) {
+		block.indexBytes.free(p_allocation.indexByteOffset, (indexBytes + INDEX_ALIGNMENT - 1) & ~(INDEX_ALIGNMENT - 1));
+	}
+}
+
+void MeshPool::release(Handle p_handle) {
+	freeRanges(m_allocations[p_handle]);
+
+	m_allocations[p_handle] = {};
+	m_freeHandles.push_back(p_handle);
+}
+
+void MeshPool::releaseEmptyBlocks() {
+	uint32_t liveBlocks = static_cast<uint32_t>(std::count_if(m_blocks.begin(), m_blocks.end(), [](const Block& p_block) {
+		return p_block.vertexBuffer != nullptr;
+	}));
+
+	for(Block& block : m_blocks) {
+		if(liveBlocks <= 1) {
+			return;
+		}
+
+		if(block.vertexBuffer == nullptr || block.vertices.freeSize() != block.vertices.capacity() || block.indexBytes.freeSize() != block.indexBytes.capacity()) {
+			continue;
+		}
+
+		// Every range was released after the frames drawing from it finished, so the buffers are idle
+		block = {};
+		liveBlocks--;
+	}
+}
+
+void MeshPool::nextFrame() {
+	m_frame++;
+
+	auto retired = std::stable_partition(m_pendingReleases.begin(), m_pendingReleases.end(), [this](const PendingRelease& p_release) {
+		return p_release.frame > m_frame;
+	});
+
+	bool releasedRanges = false;
+	for(auto it = retired; it != m_pendingReleases.end(); ++it) {
+		if(it->handle != INVALID_HANDLE) {
+			release(it->handle);
+			releasedRanges = true;
+		} else if(it->moved) {
+			freeRanges(it->ranges);
+			releasedRanges = true;
+		}
+	}
+
+	m_pendingReleases.erase(retired, m_pendingReleases.end());
+
+	if(releasedRanges) {
+		releaseEmptyBlocks();
+	}
+}
+
+VkDeviceSize MeshPool::defragment(VkCommandBuffer p_commandBuffer) {
+	if(getFragmentation() < m_defragmentThreshold) {
+		return 0;
+	}
+
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + m_defragmentTimeBudget;
+
+	// Meshes at the end of the last blocks move first, they leave the largest holes behind
+	FrameVector<Handle> candidates = {};
+	for(Handle handle = 0; handle < m_allocations.size(); handle++) {
+		if(m_referenceCounts[handle] > 0) {
+			candidates.push_back(handle);
+		}
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [this](Handle p_a, Handle p_b) {
+		const Allocation& a = m_allocations[p_a];
+		const Allocation& b = m_allocations[p_b];
+
+		return a.block != b.block ? a.block > b.block : a.vertexOffset > b.vertexOffset;
+	});
+
+	uint32_t vertexStride = m_vertexStride + m_positionStride;
+	VkDeviceSize movedBytes = 0;
+	bool recorded = false;
+
+	for(Handle handle : candidates) {
+		if(std::chrono::steady_clock::now() > deadline) {
+			break;
+		}
+
+		Allocation& allocation = m_allocations[handle];
+
+		VkDeviceSize meshBytes = static_cast<VkDeviceSize>(allocation.vertexCount) * vertexStride + static_cast<VkDeviceSize>(allocation.indexCount) * allocation.indexSize();
+		if(movedBytes + meshBytes > m_defragmentBudget) {
+			continue;
+		}
+
+		// First fit only ever finds a lower range, a move never undoes an earlier one
+		Allocation target = allocation;
+		bool allocated = false;
+		for(uint32_t i = 0; i <= allocation.block && !allocated; i++) {
+			allocated = tryAllocate(i, target);
+		}
+
+		if(!allocated) {
+			continue;
+		}
+
+		if(target.block == allocation.block && target.vertexOffset >= allocation.vertexOffset) {
+			freeRanges(target);
+			continue;
+		}
+
+		if(!recorded) {
+			// Earlier defragment() copies may have written the ranges read now
+			VkMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+			barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+			vkCmdPipelineBarrier(p_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+			recorded = true;
+		}
+
+		copyMesh(p_commandBuffer, allocation, target);
+
+		// Frames in flight still draw from the old ranges
+		PendingRelease release = {};
+		release.frame = m_frame + SwapChain::MAX_FRAMES_IN_FLIGHT;
+		release.ranges = allocation;
+		release.moved = true;
+		m_pendingReleases.push_back(std::move(release));
+
+		allocation = target;
+		movedBytes += meshBytes;
+	}
+
+	if(recorded) {
+		VkMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+
+		vkCmdPipelineBarrier(p_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	return movedBytes;
+}
+
+void MeshPool::copyMesh(VkCommandBuffer p_commandBuffer, const Allocation& p_src, const Allocation& p_dst) const {
+	const Block& srcBlock = m_blocks[p_src.block];
+	const Block& dstBlock = m_blocks[p_dst.block];
+
+	// Source and destination never overlap, the old ranges stay reserved until the copy has executed
+	VkBufferCopy vertexRegion = {};
+	vertexRegion.srcOffset = getVertexByteOffset(p_src);
+	vertexRegion.dstOffset = getVertexByteOffset(p_dst);
+	vertexRegion.size = static_cast<VkDeviceSize>(p_src.vertexCount) * m_vertexStride;
+
+	if(vertexRegion.size > 0) {
+		vkCmdCopyBuffer(p_commandBuffer, srcBlock.vertexBuffer->getBuffer(), dstBlock.vertexBuffer->getBuffer(), 1, &vertexRegion);
+	}
+
+	if(m_positionStride != 0 && p_src.vertexCount > 0) {
+		VkBufferCopy positionRegion = {};
+		positionRegion.srcOffset = getPositionByteOffset(p_src);
+		positionRegion.dstOffset = getPositionByteOffset(p_dst);
+		positionRegion.size = static_cast<VkDeviceSize>(p_src.vertexCount) * m_positionStride;
+
+		vkCmdCopyBuffer(p_commandBuffer, srcBlock.positionBuffer->getBuffer(), dstBlock.positionBuffer->getBuffer(), 1, &positionRegion);
+	}
+
+	if(p_src.indexCount > 0) {
+		VkBufferCopy indexRegion = {};
+		indexRegion.srcOffset = p_src.indexByteOffset;
+		indexRegion.dstOffset = p_dst.indexByteOffset;
+		indexRegion.size = static_cast<VkDeviceSize>(p_src.indexCount) * p_src.indexSize();
+
+		vkCmdCopyBuffer(p_commandBuffer, srcBlock.indexBuffer->getBuffer(), dstBlock.indexBuffer->getBuffer(), 1, &indexRegion);
+	}
+}
+
+float MeshPool::getFragmentation() const {
+	double freeShare = 0.0;
+	double fragmentedShare = 0.0;
+
+	// Vertices and index bytes are weighed as a share of their own capacity
+	for(const Block& block : m_blocks) {
+		if(block.vertexBuffer == nullptr) {
+			continue;
+		}
+
+		for(const RangeAllocator* ranges : {&block.vertices, &block.indexBytes}) {
+			double capacity = static_cast<double>(std::max<uint64_t>(ranges->capacity(), 1));
+
+			freeShare += static_cast<double>(ranges->freeSize()) / capacity;
+			fragmentedShare += static_cast<double>(ranges->freeSize() - ranges->largestFreeRange()) / capacity;
+		}
+	}
+
+	if(freeShare == 0.0) {
+		return 0.0f;
+	}
+
+	return static_cast<float>(fragmentedShare / freeShare);
+}
+
+void* MeshPool::writeVertices(const Allocation& p_allocation, UploadBatcher& p_uploadBatcher) const {
+	const Buffer& buffer = *m_blocks[p_allocation.block].vertexBuffer;
+	VkDeviceSize offset = getVertexByteOffset(p_allocation);
+
+	// Freshly allocated ranges are not read by any frame in flight, so they can be written right away
+	if(m_hostWritable) {
+		return static_cast<char*>(buffer.getMappedMemory()) + offset;
+	}
+
+	return p_uploadBatcher.stageBuffer(buffer.getBuffer(), static_cast<VkDeviceSize>(p_allocation.vertexCount) * m_vertexStride, offset);
+}
+
+void* MeshPool::writePositions(const Allocation& p_allocation, UploadBatcher& p_uploadBatcher) const {
+	assert(m_positionStride != 0 && "Pool has no position stream");
+
+	const Buffer& buffer = *m_blocks[p_allocation.block].positionBuffer;
+	VkDeviceSize offset = getPositionByteOffset(p_allocation);
+
+	if(m_hostWritable) {
+		return static_cast<char*>(buffer.getMappedMemory()) + offset;
+	}
+
+	return p_uploadBatcher.stageBuffer(buffer.getBuffer(), static_cast<VkDeviceSize>(p_allocation.vertexCount) * m_positionStride, offset);
+}
+
+void* MeshPool::writeIndices(const Allocation& p_allocation, UploadBatcher& p_uploadBatcher) const {
+	const Buffer& buffer = *m_blocks[p_allocation.block].indexBuffer;
+
+	if(m_hostWritable) {
+		return static_cast<char*>(buffer.getMappedMemory()) + p_allocation.indexByteOffset;
+	}
+
+	return p_uploadBatcher.stageBuffer(buffer.getBuffer(), static_cast<VkDeviceSize>(p_allocation.indexCount) * p_allocation.indexSize(), p_allocation.indexByteOffset);
+}
+
+void MeshPool::bind(VkCommandBuffer p_commandBuffer, const Allocation& p_allocation) const {
+	const Block& block = m_blocks[p_allocation.block];
+
+	if(m_positionStride != 0) {
+		VkBuffer buffers[] = {block.positionBuffer->getBuffer(), block.vertexBuffer->getBuffer()};
+		VkDeviceSize offsets[] = {0, 0};
+
+		vkCmdBindVertexBuffers(p_commandBuffer, 0, 2, buffers, offsets);
+	} else {
+		VkBuffer buffers[] = {block.vertexBuffer->getBuffer()};
+		VkDeviceSize offsets[] = {0};
+
+		vkCmdBindVertexBuffers(p_commandBuffer, 0, 1, buffers, offsets);
+	}
+
+	vkCmdBindIndexBuffer(p_commandBuffer, block.indexBuffer->getBuffer(), 0, p_allocation.indexType);
+}
+
+void MeshPool::bindPositions(VkCommandBuffer p_commandBuffer, const Allocation& p_allocation) const {
+	const Block& block = m_blocks[p_allocation.block];
+
+	VkBuffer buffers[] = {m_positionStride != 0 ? block.positionBuffer->getBuffer() : block.vertexBuffer->getBuffer()};
+	VkDeviceSize offsets[] = {0};
+
+	vkCmdBindVertexBuffers(p_commandBuffer, 0, 1, buffers, offsets);
+	vkCmdBindIndexBuffer(p_commandBuffer, block.indexBuffer->getBuffer(), 0, p_allocation.indexType);
+}
+
+} // FFL
@@ -0,0 +1,378 @@
+#include "MeshSimplifier.hpp"
+#include "IndexHashTable.hpp"
+#include "Utils.hpp"
+
+// Libraries
+#include <glm/glm.hpp>
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace FFL {
+
+struct PositionHash {
+	uint64_t operator()(const glm::vec3& p_position) const {
+		return hashBytes(&p_position, sizeof(glm::vec3));
+	}
+};
+
+struct PositionEqual {
+	bool operator()(const glm::vec3& p_a, const glm::vec3& p_b) const {
+		return memcmp(&p_a, &p_b, sizeof(glm::vec3)) == 0;
+	}
+};
+
+// Symmetric 4x4 error quadric of a set of planes, weighted by triangle area so the error is a squared distance
+// Accumulated in double precision, the expanded form cancels badly in float for meshes away from the origin
+struct Quadric {
+	double a2 = 0.0, b2 = 0.0, c2 = 0.0;
+	double ab = 0.0, ac = 0.0, bc = 0.0;
+	double ad = 0.0, bd = 0.0, cd = 0.0;
+	double d2 = 0.0;
+	double weight = 0.0;
+
+	static Quadric fromPlane(const glm::vec3& p_normal, float p_distance, float p_weight) {
+		double x = p_normal.x;
+		double y = p_normal.y;
+		double z = p_normal.z;
+		double d = p_distance;
+		double w = p_weight;
+
+		Quadric q = {};
+		q.a2 = x * x * w;
+		q.b2 = y * y * w;
+		q.c2 = z * z * w;
+		q.ab = x * y * w;
+		q.ac = x * z * w;
+		q.bc = y * z * w;
+		q.ad = x * d * w;
+		q.bd = y * d * w;
+		q.cd = z * d * w;
+		q.d2 = d * d * w;
+		q.weight = w;
+
+		return q;
+	}
+
+	void add(const Quadric& p_other) {
+		a2 += p_other.a2; b2 += p_other.b2; c2 += p_other.c2;
+		ab += p_other.ab; ac += p_other.ac; bc += p_other.bc;
+		ad += p_other.ad; bd += p_other.bd; cd += p_other.cd;
+		d2 += p_other.d2;
+		weight += p_other.weight;
+	}
+
+	float evaluate(const glm::vec3& p_point) const {
+		double x = p_point.x;
+		double y = p_point.y;
+		double z = p_point.z;
+
+		double error = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z) + 2.0 * (ad * x + bd * y + cd * z) + d2;
+
+		return weight > 0.0 ? static_cast<float>(std::abs(error) / weight) : 0.0f;
+	}
+};
+
+struct Collapse {
+	uint32_t from;
+	uint32_t to;
+	float error;
+};
+
+static glm::vec3 loadVec3(const float* p_data, size_t p_stride, size_t p_vertex) {
+	const float* data = reinterpret_cast<const float*>(reinterpret_cast<const char*>(p_data) + p_stride * p_vertex);
+
+	return {data[0], data[1], data[2]};
+}
+
+static float attributeDistance(const MeshSimplifier::Mesh& p_mesh, uint32_t p_a, uint32_t p_b) {
+	const char* base = reinterpret_cast<const char*>(p_mesh.attributes);
+	const float* a = reinterpret_cast<const float*>(base + p_mesh.vertexStride * p_a);
+	const float* b = reinterpret_cast<const float*>(base + p_mesh.vertexStride * p_b);
+
+	float distance = 0.0f;
+	for(size_t i = 0; i < p_mesh.attributeCount; i++) {
+		distance += (a[i] - b[i]) * (a[i] - b[i]);
+	}
+
+	return distance;
+}
+
+// Moving p_from onto p_to must not turn any surviving triangle around
+static bool flipsTriangles(uint32_t p_from, uint32_t p_to, const std::vector<uint32_t>& p_triangles, const std::vector<uint32_t>& p_adjacencyOffsets, const std::vector<uint32_t>& p_adjacency, const std::vector<glm::vec3>& p_positions) {
+	for(uint32_t i = p_adjacencyOffsets[p_from]; i < p_adjacencyOffsets[p_from + 1]; i++) {
+		const uint32_t* triangle = &p_triangles[3 * p_adjacency[i]];
+
+		if(triangle[0] == p_to || triangle[1] == p_to || triangle[2] == p_to) {
+			continue;
+		}
+
+		glm::vec3 corners[3] = {p_positions[triangle[0]], p_positions[triangle[1]], p_positions[triangle[2]]};
+		glm::vec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+		for(uint32_t k = 0; k < 3; k++) {
+			if(triangle[k] == p_from) {
+				corners[k] = p_positions[p_to];
+			}
+		}
+
+		glm::vec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+		// Rejecting rotations over ~75 degrees also stops a triangle from flipping over several passes
+		if(glm::dot(before, after) <= 0.25f * glm::length(before) * glm::length(after)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t MeshSimplifier::simplify(uint32_t* p_destination, const Mesh& p_mesh, size_t p_targetIndexCount, float p_targetError, float* p_resultError) {
+	assert(p_mesh.indexCount % 3 == 0 && "Index count must be a multiple of 3");
+
+	// Collapses work on positions, every vertex is replaced by the first vertex with the same position
+	std::vector<glm::vec3> positions(p_mesh.vertexCount);
+	for(size_t i = 0; i < p_mesh.vertexCount; i++) {
+		positions[i] = loadVec3(p_mesh.positions, p_mesh.vertexStride, i);
+	}
+
+	std::vector<uint32_t> positionRemap(p_mesh.vertexCount);
+	IndexHashTable<glm::vec3, PositionHash, PositionEqual> uniquePositions = {};
+	uniquePositions.reserve(p_mesh.vertexCount);
+
+	for(size_t i = 0; i < p_mesh.vertexCount; i++) {
+		positionRemap[i] = uniquePositions.findOrInsert(positions[i], positions.data(), static_cast<uint32_t>(i));
+	}
+
+	// Triangles over position representatives, corners keeps the vertex each of their corners started as
+	std::vector<uint32_t> triangles(p_mesh.indexCount);
+	std::vector<uint32_t> corners(p_mesh.indices, p_mesh.indices + p_mesh.indexCount);
+	for(size_t i = 0; i < p_mesh.indexCount; i++) {
+		triangles[i] = positionRemap[p_mesh.indices[i]];
+	}
+
+	std::vector<Quadric> quadrics(p_mesh.vertexCount);
+	for(size_t i = 0; i < p_mesh.indexCount; i += 3) {
+		const glm::vec3& a = positions[triangles[i + 0]];
+		glm::vec3 normal = glm::cross(positions[triangles[i + 1]] - a, positions[triangles[i + 2]] - a);
+		float area = glm::length(normal);
+
+		if(area <= 0.0f) {
+			continue;
+		}
+
+		normal /= area;
+		Quadric plane = Quadric::fromPlane(normal, -glm::dot(normal, a), area);
+
+		for(uint32_t k = 0; k < 3; k++) {
+			quadrics[triangles[i + k]].add(plane);
+		}
+	}
+
+	// Open borders stay in place, an edge used by a single triangle marks both of its ends
+	std::vector<uint8_t> locked(p_mesh.vertexCount, 0);
+	{
+		std::vector<uint64_t> edges = {};
+		edges.reserve(p_mesh.indexCount);
+
+		for(size_t i = 0; i < p_mesh.indexCount; i += 3) {
+			for(uint32_t k = 0; k < 3; k++) {
+				uint32_t a = triangles[i + k];
+				uint32_t b = triangles[i + (k + 1) % 3];
+				edges.push_back(static_cast<uint64_t>(std::min(a, b)) << 32 | std::max(a, b));
+			}
+		}
+
+		std::sort(edges.begin(), edges.end());
+
+		for(size_t i = 0; i < edges.size();) {
+			size_t run = i + 1;
+			while(run < edges.size() && edges[run] == edges[i]) {
+				run++;
+			}
+
+			if(run - i == 1) {
+				locked[static_cast<uint32_t>(edges[i] >> 32)] = 1;
+				locked[static_cast<uint32_t>(edges[i])] = 1;
+			}
+
+			i = run;
+		}
+	}
+
+	float maxError = p_targetError * p_targetError;
+	float resultError = 0.0f;
+
+	std::vector<uint32_t> collapseTarget(p_mesh.vertexCount);
+	std::vector<uint8_t> touched(p_mesh.vertexCount);
+	std::vector<uint32_t> adjacencyOffsets(p_mesh.vertexCount + 1);
+	std::vector<uint32_t> adjacency = {};
+	std::vector<Collapse> collapses = {};
+
+	// Each pass collapses the cheapest edges that do not share a vertex, then rebuilds the triangle list
+	while(triangles.size() > p_targetIndexCount) {
+		std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+		for(uint32_t vertex : triangles) {
+			adjacencyOffsets[vertex + 1]++;
+		}
+
+		for(size_t i = 0; i < p_mesh.vertexCount; i++) {
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+		}
+
+		adjacency.resize(triangles.size());
+		std::vector<uint32_t> fillOffsets(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for(size_t i = 0; i < triangles.size(); i++) {
+			adjacency[fillOffsets[triangles[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		collapses.clear();
+		for(size_t i = 0; i < triangles.size(); i += 3) {
+			for(uint32_t k = 0; k < 3; k++) {
+				uint32_t a = triangles[i + k];
+				uint32_t b = triangles[i + (k + 1) % 3];
+
+				// Interior edges are seen from both triangles, border edges can not collapse anyway
+				if(a > b) {
+					continue;
+				}
+
+				Quadric combined = quadrics[a];
+				combined.add(quadrics[b]);
+
+				float errorAB = locked[a] ? std::numeric_limits<float>::max() : combined.evaluate(positions[b]);
+				float errorBA = locked[b] ? std::numeric_limits<float>::max() : combined.evaluate(positions[a]);
+
+				if(errorAB == std::numeric_limits<float>::max() && errorBA == std::numeric_limits<float>::max()) {
+					continue;
+				}
+
+				collapses.push_back(errorAB <= errorBA ? Collapse{a, b, errorAB} : Collapse{b, a, errorBA});
+			}
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& p_a, const Collapse& p_b) {
+			return p_a.error < p_b.error;
+		});
+
+		for(size_t i = 0; i < p_mesh.vertexCount; i++) {
+			collapseTarget[i] = static_cast<uint32_t>(i);
+		}
+
+		std::fill(touched.begin(), touched.end(), 0);
+
+		// A collapse removes about two triangles, stop once the pass would reach the target
+		size_t trianglesToRemove = (triangles.size() - p_targetIndexCount) / 3;
+		size_t removedEstimate = 0;
+		size_t collapseCount = 0;
+
+		for(const Collapse& collapse : collapses) {
+			if(collapse.error > maxError || removedEstimate >= trianglesToRemove) {
+				break;
+			}
+
+			if(touched[collapse.from] || touched[collapse.to]) {
+				continue;
+			}
+
+			if(flipsTriangles(collapse.from, collapse.to, triangles, adjacencyOffsets, adjacency, positions)) {
+				continue;
+			}
+
+			collapseTarget[collapse.from] = collapse.to;
+			quadrics[collapse.to].add(quadrics[collapse.from]);
+
+			// The flip test assumed the ring around the collapsed vertex stays put, so nothing in it may move this pass
+			for(uint32_t j = adjacencyOffsets[collapse.from]; j < adjacencyOffsets[collapse.from + 1]; j++) {
+				const uint32_t* triangle = &triangles[3 * adjacency[j]];
+				touched[triangle[0]] = 1;
+				touched[triangle[1]] = 1;
+				touched[triangle[2]] = 1;
+			}
+
+			touched[collapse.to] = 1;
+
+			resultError = std::max(resultError, collapse.error);
+			removedEstimate += 2;
+			collapseCount++;
+		}
+
+		if(collapseCount == 0) {
+			break;
+		}
+
+		size_t writeIndex = 0;
+		for(size_t i = 0; i < triangles.size(); i += 3) {
+			uint32_t a = collapseTarget[triangles[i + 0]];
+			uint32_t b = collapseTarget[triangles[i + 1]];
+			uint32_t c = collapseTarget[triangles[i + 2]];
+
+			if(a == b || b == c || c == a) {
+				continue;
+			}
+
+			corners[writeIndex] = corners[i + 0];
+			triangles[writeIndex++] = a;
+			corners[writeIndex] = corners[i + 1];
+			triangles[writeIndex++] = b;
+			corners[writeIndex] = corners[i + 2];
+			triangles[writeIndex++] = c;
+		}
+
+		triangles.resize(writeIndex);
+		corners.resize(writeIndex);
+	}
+
+	// Corners whose position moved pick the closest wedge, the vertex at the new position with the most similar attributes
+	std::vector<uint32_t> wedgeOffsets(p_mesh.vertexCount + 1, 0);
+	for(size_t i = 0; i < p_mesh.vertexCount; i++) {
+		wedgeOffsets[positionRemap[i] + 1]++;
+	}
+
+	for(size_t i = 0; i < p_mesh.vertexCount; i++) {
+		wedgeOffsets[i + 1] += wedgeOffsets[i];
+	}
+
+	std::vector<uint32_t> wedges(p_mesh.vertexCount);
+	std::vector<uint32_t> fillOffsets(wedgeOffsets.begin(), wedgeOffsets.end() - 1);
+	for(size_t i = 0; i < p_mesh.vertexCount; i++) {
+		wedges[fillOffsets[positionRemap[i]]++] = static_cast<uint32_t>(i);
+	}
+
+	for(size_t i = 0; i < triangles.size(); i++) {
+		uint32_t corner = corners[i];
+		uint32_t position = triangles[i];
+
+		if(positionRemap[corner] == position || p_mesh.attributeCount == 0) {
+			p_destination[i] = positionRemap[corner] == position ? corner : position;
+			continue;
+		}
+
+		uint32_t bestWedge = position;
+		float bestDistance = std::numeric_limits<float>::max();
+
+		for(uint32_t j = wedgeOffsets[position]; j < wedgeOffsets[position + 1]; j++) {
+			float distance = attributeDistance(p_mesh, corner, wedges[j]);
+
+			if(distance < bestDistance) {
+				bestDistance = distance;
+				bestWedge = wedges[j];
+			}
+		}
+
+		p_destination[i] = bestWedge;
+	}
+
+	if(p_resultError) {
+		*p_resultError = std::sqrt(resultError);
+	}
+
+	return triangles.size();
+}
+
+} // FFL
@@ -0,0 +1,126 @@
+#include "MeshletBuilder.hpp"
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace FFL {
+
+// Below this the normals spread over more than ~84 degrees from the axis and the cone never culls anything
+static constexpr float MIN_CONE_DOT = 0.1f;
+
+static glm::vec3 loadPosition(const float* p_positions, size_t p_stride, uint32_t p_vertex) {
+	const float* position = reinterpret_cast<const float*>(reinterpret_cast<const char*>(p_positions) + p_stride * p_vertex);
+
+	return {position[0], position[1], position[2]};
+}
+
+static void computeBounds(Meshlet& p_meshlet, const uint32_t* p_indices, const float* p_positions, size_t p_stride) {
+	const uint32_t* indices = p_indices + p_meshlet.firstIndex;
+
+	glm::vec3 minimum = loadPosition(p_positions, p_stride, indices[0]);
+	glm::vec3 maximum = minimum;
+
+	for(uint32_t i = 1; i < p_meshlet.indexCount; i++) {
+		glm::vec3 position = loadPosition(p_positions, p_stride, indices[i]);
+		minimum = glm::min(minimum, position);
+		maximum = glm::max(maximum, position);
+	}
+
+	glm::vec3 center = (minimum + maximum) * 0.5f;
+	float radius = 0.0f;
+
+	std::vector<glm::vec3> normals = {};
+	normals.reserve(p_meshlet.indexCount / 3);
+
+	glm::vec3 axis = {};
+
+	for(uint32_t i = 0; i < p_meshlet.indexCount; i += 3) {
+		glm::vec3 a = loadPosition(p_positions, p_stride, indices[i + 0]);
+		glm::vec3 b = loadPosition(p_positions, p_stride, indices[i + 1]);
+		glm::vec3 c = loadPosition(p_positions, p_stride, indices[i + 2]);
+
+		radius = std::max({radius, glm::length(a - center), glm::length(b - center), glm::length(c - center)});
+
+		// Clockwise front faces, so the front normal is (c - a) x (b - a)
+		glm::vec3 normal = glm::cross(c - a, b - a);
+		float length = glm::length(normal);
+
+		if(length > 0.0f) {
+			normals.push_back(normal / length);
+			axis += normal / length;
+		}
+	}
+
+	p_meshlet.boundingSphere = {center, radius};
+	p_meshlet.cone = {0.0f, 0.0f, 0.0f, 1.0f};
+
+	float axisLength = glm::length(axis);
+	if(normals.empty() || axisLength <= 0.0f) {
+		return;
+	}
+
+	axis /= axisLength;
+
+	float minDot = 1.0f;
+	for(const glm::vec3& normal : normals) {
+		minDot = std::min(minDot, glm::dot(normal, axis));
+	}
+
+	if(minDot <= MIN_CONE_DOT) {
+		return;
+	}
+
+	// Every triangle faces away from a viewer whose direction to the cluster is within asin(minDot) of the axis
+	p_meshlet.cone = {axis, std::sqrt(1.0f - minDot * minDot)};
+}
+
+std::vector<Meshlet> MeshletBuilder::build(const uint32_t* p_indices, size_t p_indexCount, const float* p_positions, size_t p_vertexCount, size_t p_vertexStride) {
+	assert(p_indexCount % 3 == 0 && "Index count must be a multiple of 3");
+
+	std::vector<Meshlet> meshlets = {};
+	if(p_indexCount == 0) {
+		return meshlets;
+	}
+
+	// Marks which vertices the current meshlet already uses, the stamp changes for every new meshlet
+	std::vector<uint32_t> vertexStamps(p_vertexCount, 0);
+	uint32_t stamp = 1;
+
+	Meshlet current = {};
+
+	for(size_t i = 0; i < p_indexCount; i += 3) {
+		uint32_t newVertices = 0;
+		for(uint32_t k = 0; k < 3; k++) {
+			newVertices += vertexStamps[p_indices[i + k]] != stamp;
+		}
+
+		if(current.vertexCount + newVertices > MAX_VERTICES || current.indexCount / 3 + 1 > MAX_TRIANGLES) {
+			meshlets.push_back(current);
+
+			current = {};
+			current.firstIndex = static_cast<uint32_t>(i);
+			stamp++;
+		}
+
+		for(uint32_t k = 0; k < 3; k++) {
+			if(vertexStamps[p_indices[i + k]] != stamp) {
+				vertexStamps[p_indices[i + k]] = stamp;
+				current.vertexCount++;
+			}
+		}
+
+		current.indexCount += 3;
+	}
+
+	meshlets.push_back(current);
+
+	for(Meshlet& meshlet : meshlets) {
+		computeBounds(meshlet, p_indices, p_positions, p_vertexStride);
+	}
+
+	return meshlets;
+}
+
+} // FFL
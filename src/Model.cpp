@@ -1,194 +1,464 @@
 #include "Model.hpp"
+#include "IndexHashTable.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "MeshPool.hpp"
+#include "MeshSimplifier.hpp"
+#include "ObjParser.hpp"
+#include "ThreadPool.hpp"
+#include "UploadBatcher.hpp"
 #include "Utils.hpp"
 
 // Libraries
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tinyobjloader/tiny_obj_loader.h>
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
 #include <vulkan/vulkan_core.h>
 
 // STD
+#include <algorithm>
+#include <cassert>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <limits>
 #include <memory>
 #include <stdexcept>
-#include <unordered_map>
+#include <utility>
 
 #ifndef ENGINE_DIR
 #define ENGINE_DIR "../"
 #endif
 
-namespace std {
+namespace FFL {
 
-template<>
-struct hash<FFL::Model::Vertex> {
-	size_t operator()(FFL::Model::Vertex const& p_vertex) const {
-		size_t seed = 0;
+// A level that keeps more than this fraction of the previous level's indices is not worth its memory
+static constexpr float LOD_MIN_REDUCTION = 0.9f;
 
-		FFL::hashCombine(seed, p_vertex.position, p_vertex.color, p_vertex.normal, p_vertex.uv);
+// Vertices are hashed in one pass over the raw struct
+static_assert(sizeof(Model::Vertex) == 11 * sizeof(float), "Model::Vertex must not contain padding");
 
-		return seed;
+struct VertexHash {
+	uint64_t operator()(const Model::Vertex& p_vertex) const {
+		return p_vertex.hash();
 	}
 };
 
-}
+// Float comparison like the std::unordered_map this replaced, -0.0 equals 0.0 and NaN vertices are never merged
+struct VertexEqual {
+	bool operator()(const Model::Vertex& p_a, const Model::Vertex& p_b) const {
+		return p_a == p_b;
+	}
+};
 
-namespace FFL {
+uint64_t Model::Vertex::hash() const {
+	float components[sizeof(Vertex) / sizeof(float)];
+	memcpy(components, this, sizeof(Vertex));
 
-std::vector<VkVertexInputBindingDescription> Model::Vertex::getBindingDescriptions() {
-	std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
-	bindingDescriptions[0].binding = 0;
-	bindingDescriptions[0].stride = sizeof(Vertex);
-	bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+	// Adding 0.0 turns -0.0 into 0.0 and leaves every other value alone
+	for(float& component : components) {
+		component += 0.0f;
+	}
 
-	return bindingDescriptions;
+	return hashBytes(components, sizeof(components));
 }
 
-std::vector<VkVertexInputAttributeDescription> Model::Vertex::getAttributeDescriptions() {
-	std::vector<VkVertexInputAttributeDescription> attributeDescriptions = {};
+void Model::Builder::loadModel(const std::string& p_filePath) {
+	std::string enginePath = ENGINE_DIR + p_filePath;
+	std::string cachePath = MeshCache::cachePathFor(enginePath);
+
+	if(MeshCache::load(cachePath, enginePath, *this)) {
+		return;
+	}
 
-	attributeDescriptions.push_back({0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position)});
-	attributeDescriptions.push_back({1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, color)});
-	attributeDescriptions.push_back({2, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal)});
-	attributeDescriptions.push_back({3, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(Vertex, uv)});
+	loadObj(enginePath);
+	m_sourceHash = MeshCache::hashSource(enginePath);
+	generateLods();
 
-	return attributeDescriptions;
-}
+	if(options.optimizeVertexCache || options.optimizeOverdraw) {
+		OptimizationReport report = optimize();
 
-void Model::Builder::loadModel(const std::string& p_filePath) {
-	std::string enginePath = ENGINE_DIR + p_filePath;
+		std::cout << p_filePath << ": ACMR " << report.before.acmr << " -> " << report.after.acmr << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << '\n';
+	}
 
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string warn, err;
+	buildMeshlets();
 
-	if(!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, enginePath.c_str())) {
-		throw std::runtime_error(warn + err);
+	try {
+		MeshCache::write(cachePath, enginePath, *this);
+	} catch(const std::exception& e) {
+		std::cerr << "Mesh cache not written: " << e.what() << '\n';
 	}
+}
 
+void Model::Builder::loadObj(const std::string& p_filePath) {
+	ObjParser parser{p_filePath};
+
+	m_mapping.reset();
+	m_processFlags = 0;
+	m_sourceHash = 0;
 	vertices.clear();
 	indices.clear();
+	lods.clear();
+	meshlets.clear();
+
+	parser.parseAttributes(ThreadPool::shared());
+
+	const std::vector<float>& positions = parser.positions();
+	const std::vector<float>& colors = parser.colors();
+	const std::vector<float>& normals = parser.normals();
+	const std::vector<float>& texcoords = parser.texcoords();
+
+	// Every corner is at most one new vertex, so sizing by the corner count means the table never rehashes
+	indices.reserve(parser.cornerCount());
+
+	IndexHashTable<Vertex, VertexHash, VertexEqual> uniqueVertices = {};
+	uniqueVertices.reserve(parser.cornerCount());
 
-	std::unordered_map<Vertex, uint32_t> uniqueVertices = {};
-	for(const tinyobj::shape_t& shape : shapes) {
-		for(const tinyobj::index_t& index : shape.mesh.indices) {
+	parser.parseFaces(ThreadPool::shared(), [&](const ObjParser::Corner* p_corners, size_t p_count) {
+		for(size_t i = 0; i < p_count; i++) {
+			const ObjParser::Corner& corner = p_corners[i];
 			Vertex vertex = {};
 
-			if(index.vertex_index >= 0) {
+			if(corner.position >= 0) {
 				vertex.position = {
-					attrib.vertices[3 * index.vertex_index + 0],
-					attrib.vertices[3 * index.vertex_index + 1],
-					attrib.vertices[3 * index.vertex_index + 2],
+					positions[3 * corner.position + 0],
+					positions[3 * corner.position + 1],
+					positions[3 * corner.position + 2],
 				};
 
 				vertex.color = {
-					attrib.colors[3 * index.vertex_index + 0],
-					attrib.colors[3 * index.vertex_index + 1],
-					attrib.colors[3 * index.vertex_index + 2],
+					colors[3 * corner.position + 0],
+					colors[3 * corner.position + 1],
+					colors[3 * corner.position + 2],
 				};
 			}
 
-			if(index.normal_index >= 0) {
+			if(corner.normal >= 0) {
 				vertex.normal = {
-					attrib.normals[3 * index.normal_index + 0],
-					attrib.normals[3 * index.normal_index + 1],
-					attrib.normals[3 * index.normal_index + 2],
+					normals[3 * corner.normal + 0],
+					normals[3 * corner.normal + 1],
+					normals[3 * corner.normal + 2],
 				};
 			}
 
-			if(index.texcoord_index >= 0) {
+			if(corner.texcoord >= 0) {
 				vertex.uv = {
-					attrib.texcoords[2 * index.texcoord_index + 0],
-					attrib.texcoords[2 * index.texcoord_index + 1],
+					texcoords[2 * corner.texcoord + 0],
+					texcoords[2 * corner.texcoord + 1],
 				};
 			}
 
-			if(uniqueVertices.count(vertex) == 0) {
-				uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
+			uint32_t newIndex = static_cast<uint32_t>(vertices.size());
+			uint32_t index = uniqueVertices.findOrInsert(vertex, vertices.data(), newIndex);
+
+			if(index == newIndex) {
 				vertices.push_back(vertex);
 			}
 
-			indices.push_back(uniqueVertices[vertex]);
+			indices.push_back(index);
+		}
+	});
+}
+
+void Model::Builder::generateLods() {
+	assert(!m_mapping && "Cannot simplify a mesh mapped from the cache");
+
+	lods.clear();
+	if(options.lodCount <= 1) {
+		return;
+	}
+
+	// Recorded even for empty meshes, which have nothing to simplify, so their caches still match the options
+	m_processFlags |= MeshCache::flagsFor(options) & MeshCache::FLAG_LOD_COUNT_MASK;
+	if(indices.empty()) {
+		return;
+	}
+
+	std::vector<uint32_t> baseIndices = indices;
+	std::vector<uint32_t> lodIndices(baseIndices.size());
+
+	// Color, normal and uv follow the position as 8 contiguous floats and decide which wedge a moved corner uses
+	MeshSimplifier::Mesh mesh = {};
+	mesh.indices = baseIndices.data();
+	mesh.indexCount = baseIndices.size();
+	mesh.positions = &vertices[0].position.x;
+	mesh.attributes = &vertices[0].color.x;
+	mesh.attributeCount = (sizeof(Vertex) - offsetof(Vertex, color)) / sizeof(float);
+	mesh.vertexCount = vertices.size();
+	mesh.vertexStride = sizeof(Vertex);
+
+	lods.push_back({0, static_cast<uint32_t>(baseIndices.size()), 0.0f});
+
+	// Every level is simplified from the full mesh, so its error is measured against what the asset really looks like
+	for(uint32_t level = 1; level < options.lodCount; level++) {
+		size_t targetIndexCount = static_cast<size_t>(baseIndices.size() * std::pow(options.lodReduction, static_cast<float>(level))) / 3 * 3;
+
+		float error = 0.0f;
+		size_t indexCount = MeshSimplifier::simplify(lodIndices.data(), mesh, targetIndexCount, std::numeric_limits<float>::max(), &error);
+
+		if(indexCount == 0 || indexCount > lods.back().indexCount * LOD_MIN_REDUCTION) {
+			break;
 		}
+
+		lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(indexCount), std::max(error, lods.back().error)});
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.begin() + indexCount);
 	}
 }
 
+Model::Builder::OptimizationReport Model::Builder::optimize() {
+	assert(!m_mapping && "Cannot optimize a mesh mapped from the cache");
+
+	OptimizationReport report = {};
+	if(indices.empty()) {
+		m_processFlags |= MeshCache::flagsFor(options) & (MeshCache::FLAG_VERTEX_CACHE_OPTIMIZED | MeshCache::FLAG_OVERDRAW_OPTIMIZED);
+		return report;
+	}
+
+	std::vector<Lod> ranges = lods;
+	if(ranges.empty()) {
+		ranges.push_back({0, static_cast<uint32_t>(indices.size()), 0.0f});
+	}
+
+	uint32_t* baseIndices = indices.data() + ranges[0].firstIndex;
+	report.before = MeshOptimizer::analyzeVertexCache(baseIndices, ranges[0].indexCount, vertices.size());
+
+	if(options.optimizeVertexCache) {
+		for(const Lod& lod : ranges) {
+			MeshOptimizer::optimizeVertexCache(indices.data() + lod.firstIndex, lod.indexCount, vertices.size());
+		}
+
+		m_processFlags |= MeshCache::FLAG_VERTEX_CACHE_OPTIMIZED;
+	}
+
+	// Distant levels cover few pixels, overdraw only matters for the full mesh
+	if(options.optimizeOverdraw) {
+		MeshOptimizer::optimizeOverdraw(baseIndices, ranges[0].indexCount, &vertices[0].position.x, vertices.size(), sizeof(Vertex), options.overdrawThreshold);
+		m_processFlags |= MeshCache::FLAG_OVERDRAW_OPTIMIZED;
+	}
+
+	// Triangle order is final, lay the vertices out in the order the GPU will fetch them
+	// Level 0 comes first in the index buffer, so it decides the order and coarser levels reuse a subset
+	std::vector<uint32_t> remap = {};
+	uint32_t referencedCount = MeshOptimizer::buildFetchRemap(indices.data(), indices.size(), vertices.size(), remap);
+
+	std::vector<Vertex> reordered(referencedCount);
+	for(size_t i = 0; i < vertices.size(); i++) {
+		if(remap[i] != UINT32_MAX) {
+			reordered[remap[i]] = vertices[i];
+		}
+	}
+
+	vertices = std::move(reordered);
+
+	report.after = MeshOptimizer::analyzeVertexCache(baseIndices, ranges[0].indexCount, vertices.size());
+
+	return report;
+}
+
+void Model::Builder::buildMeshlets() {
+	assert(!m_mapping && "Cannot build meshlets for a mesh mapped from the cache");
+
+	meshlets.clear();
+	if(!options.buildMeshlets) {
+		return;
+	}
+
+	m_processFlags |= MeshCache::FLAG_MESHLETS;
+	if(indices.empty()) {
+		return;
+	}
+
+	// Coarser levels are only drawn far away where a handful of clusters would not cull anything worthwhile
+	uint32_t baseIndexCount = lods.empty() ? static_cast<uint32_t>(indices.size()) : lods[0].indexCount;
+	meshlets = MeshletBuilder::build(indices.data(), baseIndexCount, &vertices[0].position.x, vertices.size(), sizeof(Vertex));
+}
+
+Model::Model(Device& p_device) : m_device{p_device} {}
+
 Model::Model(Device& p_device, const Model::Builder& p_builder) : m_device{p_device} {
-	createVertexBuffers(p_builder.vertices);
-	createIndexBuffer(p_builder.indices);
+	createBuffers(p_builder, m_device.uploadBatcher());
+	m_device.uploadBatcher().flush();
+
+	m_ready = true;
 }
 
-Model::~Model() {}
+Model::~Model() {
+	// Frames in flight may still draw the mesh
+	m_device.meshPool().free(m_meshHandle);
+	m_device.meshPool().deferDestroy(std::move(m_meshletBuffer));
+}
 
 std::unique_ptr<Model> Model::createModelFromFile(Device& p_device, const std::string& p_filePath) {
 	Builder builder = {};
 	builder.loadModel(p_filePath);
 
-	std::cout << "Vertex Count: " << builder.vertices.size() << '\n';
+	std::cout << "Vertex Count: " << builder.vertexCount() << '\n';
+	std::cout << "LOD Count: " << builder.lodCount() << '\n';
+	std::cout << "Meshlet Count: " << builder.meshletCount() << '\n';
 
 	return std::make_unique<Model>(p_device, builder);
 }
 
-void Model::createVertexBuffers(const std::vector<Vertex>& p_vertices) {
-	m_vertexCount = static_cast<uint32_t>(p_vertices.size());
-	assert(m_vertexCount >= 3 && "Vertex count must be at least 3");
+void Model::createBuffers(const Model::Builder& p_builder, UploadBatcher& p_uploadBatcher) {
+	m_vertexCount = p_builder.vertexCount();
+	m_indexCount = p_builder.indexCount();
+	m_hasIndexBuffer = m_indexCount > 0;
 
-	VkDeviceSize bufferSize = sizeof(p_vertices[0]) * m_vertexCount;
-	uint32_t vertexSize = sizeof(p_vertices[0]);
+	// Primitive restart is disabled, so every 16-bit value is a valid index
+	m_indexType = m_vertexCount <= UINT16_MAX + 1u ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
 
-	Buffer stagingBuffer{m_device, vertexSize, m_vertexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+	MeshPool& meshPool = m_device.meshPool();
+	m_meshHandle = meshPool.allocate(m_vertexCount, m_indexCount, m_indexType);
 
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer((void*)p_vertices.data());
+	uploadVertices(p_builder.vertexData(), meshPool.get(m_meshHandle), p_uploadBatcher);
+	uploadIndices(p_builder.indexData(), meshPool.get(m_meshHandle), p_uploadBatcher);
 
-	m_vertexBuffer = std::make_unique<Buffer>(m_device, vertexSize, m_vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	m_lods.assign(p_builder.lodData(), p_builder.lodData() + p_builder.lodCount());
+	if(m_lods.empty() && m_hasIndexBuffer) {
+		m_lods.push_back({0, m_indexCount, 0.0f});
+	}
 
-	m_device.copyBuffer(stagingBuffer.getBuffer(), m_vertexBuffer->getBuffer(), bufferSize);
+	createMeshletBuffer(p_builder.meshletData(), p_builder.meshletCount(), p_uploadBatcher);
 }
 
+void Model::uploadVertices(const Vertex* p_vertices, const MeshPool::Allocation& p_allocation, UploadBatcher& p_uploadBatcher) {
+	assert(m_vertexCount >= 3 && "Vertex count must be at least 3");
 
-void Model::createIndexBuffer(const std::vector<uint32_t>& p_indices) {
-	m_indexCount = static_cast<uint32_t>(p_indices.size());
-	m_hasIndexBuffer = m_indexCount > 0;
+	VertexQuantization quantization = {};
+
+	if(VertexFormat::QUANTIZED_POSITION) {
+		glm::vec3 minimum = p_vertices[0].position;
+		glm::vec3 maximum = p_vertices[0].position;
+
+		for(uint32_t i = 1; i < m_vertexCount; i++) {
+			minimum = glm::min(minimum, p_vertices[i].position);
+			maximum = glm::max(maximum, p_vertices[i].position);
+		}
+
+		glm::vec3 center = (minimum + maximum) * 0.5f;
+		glm::vec3 extent = (maximum - minimum) * 0.5f;
+
+		quantization.positionCenter = center;
+		quantization.positionInverseExtent = {
+			extent.x > 0.0f ? 1.0f / extent.x : 0.0f,
+			extent.y > 0.0f ? 1.0f / extent.y : 0.0f,
+			extent.z > 0.0f ? 1.0f / extent.z : 0.0f,
+		};
+
+		m_positionTransform = glm::mat4 {
+			{extent.x, 0.0f, 0.0f, 0.0f},
+			{0.0f, extent.y, 0.0f, 0.0f},
+			{0.0f, 0.0f, extent.z, 0.0f},
+			{center.x, center.y, center.z, 1.0f},
+		};
+	}
+
+	MeshPool& meshPool = m_device.meshPool();
 
+	// Encode straight into the staging ring, or into the pool itself on unified memory, there is no intermediate
+	// GPU-format copy
+	// Staging may submit or wrap the ring, so each range is filled before the next one is reserved
+	if(SPLIT_POSITIONS) {
+		void* positions = meshPool.writePositions(p_allocation, p_uploadBatcher);
+		VertexFormat::encodePositions(p_vertices, m_vertexCount, quantization, positions);
+
+		void* attributes = meshPool.writeVertices(p_allocation, p_uploadBatcher);
+		VertexFormat::encodeAttributes(p_vertices, m_vertexCount, quantization, attributes);
+	} else {
+		void* vertices = meshPool.writeVertices(p_allocation, p_uploadBatcher);
+		VertexFormat::encode(p_vertices, m_vertexCount, quantization, vertices);
+	}
+}
+
+
+void Model::uploadIndices(const uint32_t* p_indices, const MeshPool::Allocation& p_allocation, UploadBatcher& p_uploadBatcher) {
 	if(!m_hasIndexBuffer) {
 		return;
 	}
 
-	VkDeviceSize bufferSize = sizeof(p_indices[0]) * m_indexCount;
-	uint32_t indexSize = sizeof(p_indices[0]);
+	VkDeviceSize bufferSize = static_cast<VkDeviceSize>(p_allocation.indexSize()) * m_indexCount;
+	void* destination = m_device.meshPool().writeIndices(p_allocation, p_uploadBatcher);
+
+	// Indices stay relative to the mesh, the pool's vertex offset is applied when drawing
+	if(m_indexType == VK_INDEX_TYPE_UINT16) {
+		uint16_t* indices = static_cast<uint16_t*>(destination);
+
+		for(uint32_t i = 0; i < m_indexCount; i++) {
+			indices[i] = static_cast<uint16_t>(p_indices[i]);
+		}
+	} else {
+		memcpy(destination, p_indices, bufferSize);
+	}
+}
+
+void Model::createMeshletBuffer(const Meshlet* p_meshlets, uint32_t p_meshletCount, UploadBatcher& p_uploadBatcher) {
+	m_meshletCount = p_meshletCount;
 
-	Buffer stagingBuffer{m_device, indexSize, m_indexCount, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT};
+	if(m_meshletCount == 0) {
+		return;
+	}
+
+	uint32_t meshletSize = sizeof(Meshlet);
+	VkDeviceSize bufferSize = static_cast<VkDeviceSize>(meshletSize) * m_meshletCount;
 
-	stagingBuffer.map();
-	stagingBuffer.writeToBuffer((void*)p_indices.data());
+	m_meshletBuffer = std::make_shared<Buffer>(m_device, meshletSize, m_meshletCount, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-	m_indexBuffer = std::make_unique<Buffer>(m_device, indexSize, m_indexCount, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	p_uploadBatcher.uploadBuffer(m_meshletBuffer->getBuffer(), p_meshlets, bufferSize);
+}
 
-	m_device.copyBuffer(stagingBuffer.getBuffer(), m_indexBuffer->getBuffer(), bufferSize);
+void Model::shareMesh(const Model& p_source) {
+	assert(m_meshHandle == MeshPool::INVALID_HANDLE && "Model already has a mesh");
+
+	m_device.meshPool().retain(p_source.m_meshHandle);
+	m_meshHandle = p_source.m_meshHandle;
+
+	m_vertexCount = p_source.m_vertexCount;
+	m_positionTransform = p_source.m_positionTransform;
+	m_hasIndexBuffer = p_source.m_hasIndexBuffer;
+	m_indexCount = p_source.m_indexCount;
+	m_indexType = p_source.m_indexType;
+	m_lods = p_source.m_lods;
+	m_meshletBuffer = p_source.m_meshletBuffer;
+	m_meshletCount = p_source.m_meshletCount;
+	m_ready = p_source.m_ready;
+}
+
+VkDeviceSize Model::getResidentBytes() const {
+	if(m_meshHandle == MeshPool::INVALID_HANDLE) {
+		return 0;
+	}
+
+	const MeshPool::Allocation& allocation = getMeshAllocation();
+
+	return static_cast<VkDeviceSize>(m_vertexCount) * VertexFormat::STRIDE + static_cast<VkDeviceSize>(m_indexCount) * allocation.indexSize() + static_cast<VkDeviceSize>(m_meshletCount) * sizeof(Meshlet);
 }
 
 void Model::bind(VkCommandBuffer p_commandBuffer) {
-	VkBuffer buffers[] = {m_vertexBuffer->getBuffer()};
-	VkDeviceSize offsets[] = {0};
+	m_device.meshPool().bind(p_commandBuffer, getMeshAllocation());
+}
 
-	vkCmdBindVertexBuffers(p_commandBuffer, 0, 1, buffers, offsets);
+void Model::bindPositions(VkCommandBuffer p_commandBuffer) {
+	m_device.meshPool().bindPositions(p_commandBuffer, getMeshAllocation());
+}
+
+void Model::draw(VkCommandBuffer p_commandBuffer, uint32_t p_lod) {
+	const MeshPool::Allocation& allocation = getMeshAllocation();
 
 	if(m_hasIndexBuffer) {
-		vkCmdBindIndexBuffer(p_commandBuffer, m_indexBuffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+		const Lod& lod = m_lods[std::min(p_lod, static_cast<uint32_t>(m_lods.size()) - 1)];
+		vkCmdDrawIndexed(p_commandBuffer, lod.indexCount, 1, allocation.firstIndex() + lod.firstIndex, static_cast<int32_t>(allocation.vertexOffset), 0);
+	} else {
+		vkCmdDraw(p_commandBuffer, m_vertexCount, 1, allocation.vertexOffset, 0);
 	}
 }
 
-void Model::draw(VkCommandBuffer p_commandBuffer) {
-	if(m_hasIndexBuffer) {
-		vkCmdDrawIndexed(p_commandBuffer, m_indexCount, 1, 0, 0, 0);
-	} else {
-		vkCmdDraw(p_commandBuffer, m_vertexCount, 1, 0, 0);
+uint32_t Model::selectLod(float p_errorScale, float p_maxError) const {
+	uint32_t lod = 0;
+
+	for(uint32_t i = 1; i < m_lods.size() && m_lods[i].error * p_errorScale <= p_maxError; i++) {
+		lod = i;
 	}
+
+	return lod;
 }
 
 } // FFL
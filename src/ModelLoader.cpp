@@ -0,0 +1,124 @@
+#include "ModelLoader.hpp"
+#include "UploadBatcher.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <utility>
+
+namespace FFL {
+
+ModelLoader::ModelLoader(Device& p_device, ThreadPool& p_threadPool) : m_device{p_device}, m_threadPool{p_threadPool} {}
+
+ModelLoader::~ModelLoader() {
+	// Workers may still be running the parse tasks
+	for(PendingParse& parse : m_pendingParses) {
+		parse.builder.wait();
+	}
+
+	retireUploads(true);
+}
+
+std::shared_ptr<Model> ModelLoader::load(const std::string& p_filePath) {
+	PendingParse parse = {};
+	parse.model = std::make_shared<Model>(m_device);
+	parse.filePath = p_filePath;
+	parse.builder = m_threadPool.submit([p_filePath]() {
+		std::unique_ptr<Model::Builder> builder = std::make_unique<Model::Builder>();
+		builder->loadModel(p_filePath);
+
+		return builder;
+	});
+
+	std::shared_ptr<Model> model = parse.model;
+	m_pendingParses.push_back(std::move(parse));
+
+	return model;
+}
+
+void ModelLoader::update() {
+	retireUploads(false);
+	startUploads(false);
+}
+
+void ModelLoader::waitIdle() {
+	for(PendingParse& parse : m_pendingParses) {
+		parse.builder.wait();
+	}
+
+	startUploads(true);
+	retireUploads(true);
+}
+
+void ModelLoader::startUploads(bool p_ignoreBudget) {
+	UploadBatcher& uploadBatcher = m_device.uploadBatcher();
+
+	PendingUpload upload = {};
+	VkDeviceSize uploadedBytes = 0;
+
+	for(size_t i = 0; i < m_pendingParses.size();) {
+		PendingParse& parse = m_pendingParses[i];
+
+		if(parse.builder.wait_for(std::chrono::seconds{0}) != std::future_status::ready) {
+			i++;
+			continue;
+		}
+
+		if(!p_ignoreBudget && uploadedBytes >= m_uploadBudget) {
+			break;
+		}
+
+		try {
+			std::unique_ptr<Model::Builder> builder = parse.builder.get();
+
+			if(m_uploadFilter && !m_uploadFilter(parse.model, *builder)) {
+				m_pendingParses.erase(m_pendingParses.begin() + i);
+				continue;
+			}
+
+			parse.model->createBuffers(*builder, uploadBatcher);
+			upload.models.push_back(parse.model);
+
+			uploadedBytes += static_cast<VkDeviceSize>(builder->vertexCount()) * sizeof(Model::Vertex) + static_cast<VkDeviceSize>(builder->indexCount()) * sizeof(uint32_t);
+
+			std::cout << parse.filePath << ": " << builder->vertexCount() << " vertices, " << builder->lodCount() << " LODs, " << builder->meshletCount() << " meshlets" << '\n';
+		} catch(const std::exception& e) {
+			// The model never becomes ready, objects holding it are simply not drawn
+			std::cerr << "Failed to load model " << parse.filePath << ": " << e.what() << '\n';
+		}
+
+		m_pendingParses.erase(m_pendingParses.begin() + i);
+	}
+
+	if(upload.models.empty()) {
+		return;
+	}
+
+	upload.ticket = uploadBatcher.submit();
+	m_pendingUploads.push_back(std::move(upload));
+}
+
+void ModelLoader::retireUploads(bool p_wait) {
+	for(size_t i = 0; i < m_pendingUploads.size();) {
+		PendingUpload& upload = m_pendingUploads[i];
+
+		if(p_wait) {
+			m_device.uploadBatcher().wait(upload.ticket);
+		} else if(!m_device.uploadBatcher().isComplete(upload.ticket)) {
+			i++;
+			continue;
+		}
+
+		for(std::shared_ptr<Model>& model : upload.models) {
+			model->m_ready = true;
+		}
+
+		m_pendingUploads.erase(m_pendingUploads.begin() + i);
+	}
+}
+
+} // FFL
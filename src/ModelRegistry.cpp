@@ -0,0 +1,195 @@
+#include "ModelRegistry.hpp"
+#include "MappedFile.hpp"
+#include "MeshPool.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <unordered_set>
+#include <utility>
+
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
+namespace FFL {
+
+// Byte comparison of two source files, a file that can no longer be read counts as different
+static bool sameSource(const std::string& p_first, const std::string& p_second) {
+	try {
+		MappedFile first{ENGINE_DIR + p_first};
+		MappedFile second{ENGINE_DIR + p_second};
+
+		return first.size() == second.size() && (first.size() == 0 || std::memcmp(first.data(), second.data(), first.size()) == 0);
+	} catch(const std::exception&) {
+		return false;
+	}
+}
+
+ModelRegistry::ModelRegistry(Device& p_device, ThreadPool& p_threadPool) : m_device{p_device}, m_loader{p_device, p_threadPool} {
+	m_loader.setUploadFilter([this](const std::shared_ptr<Model>& p_model, const Model::Builder& p_builder) {
+		return filterUpload(p_model, p_builder);
+	});
+}
+
+std::shared_ptr<Model> ModelRegistry::load(const std::string& p_filePath) {
+	auto it = m_entries.find(p_filePath);
+	if(it != m_entries.end()) {
+		return it->second.model;
+	}
+
+	Entry entry = {};
+	entry.model = m_loader.load(p_filePath);
+
+	std::shared_ptr<Model> model = entry.model;
+	m_entries.emplace(p_filePath, std::move(entry));
+
+	return model;
+}
+
+void ModelRegistry::update() {
+	m_loader.update();
+	retireAliases();
+	evictUnused();
+}
+
+void ModelRegistry::waitIdle() {
+	m_loader.waitIdle();
+	retireAliases();
+}
+
+std::vector<ModelRegistry::AssetInfo> ModelRegistry::residentAssets() const {
+	std::vector<AssetInfo> assets = {};
+	assets.reserve(m_entries.size());
+
+	for(const auto& [path, entry] : m_entries) {
+		AssetInfo info = {};
+		info.path = path;
+		info.contentHash = entry.contentHash;
+		info.ready = entry.model->isReady();
+		info.residentBytes = info.ready ? entry.model->getResidentBytes() : 0;
+		info.shared = entry.shared;
+
+		assets.push_back(std::move(info));
+	}
+
+	return assets;
+}
+
+VkDeviceSize ModelRegistry::residentBytes(const std::string& p_filePath) const {
+	auto it = m_entries.find(p_filePath);
+	if(it == m_entries.end() || !it->second.model->isReady()) {
+		return 0;
+	}
+
+	return it->second.model->getResidentBytes();
+}
+
+VkDeviceSize ModelRegistry::totalResidentBytes() const {
+	std::unordered_set<MeshPool::Handle> counted = {};
+	VkDeviceSize totalBytes = 0;
+
+	for(const auto& [path, entry] : m_entries) {
+		if(!entry.model->isReady() || !counted.insert(entry.model->m_meshHandle).second) {
+			continue;
+		}
+
+		totalBytes += entry.model->getResidentBytes();
+	}
+
+	return totalBytes;
+}
+
+bool ModelRegistry::filterUpload(const std::shared_ptr<Model>& p_model, const Model::Builder& p_builder) {
+	uint64_t contentHash = p_builder.sourceHash();
+
+	auto entry = findEntry(p_model.get());
+	if(entry == m_entries.end() || contentHash == 0) {
+		return true;
+	}
+
+	entry->second.contentHash = contentHash;
+
+	ContentSource& indexed = m_contentIndex[contentHash];
+	std::shared_ptr<Model> source = indexed.model.lock();
+
+	// A source whose upload failed has no mesh to share
+	if(source == nullptr || source->m_meshHandle == MeshPool::INVALID_HANDLE) {
+		indexed = {p_model, entry->first};
+		return true;
+	}
+
+	// The hash only finds the candidate, a collision uploads its own mesh instead of drawing another file's
+	bool sameCounts = source->m_vertexCount == p_builder.vertexCount() && source->m_indexCount == p_builder.indexCount() && source->m_meshletCount == p_builder.meshletCount();
+	if(!sameCounts || !sameSource(indexed.path, entry->first)) {
+		return true;
+	}
+
+	p_model->shareMesh(*source);
+	entry->second.shared = true;
+
+	if(!p_model->isReady()) {
+		m_pendingAliases.push_back({p_model, std::move(source)});
+	}
+
+	return false;
+}
+
+void ModelRegistry::retireAliases() {
+	for(size_t i = 0; i < m_pendingAliases.size();) {
+		PendingAlias& alias = m_pendingAliases[i];
+
+		if(!alias.source->isReady()) {
+			i++;
+			continue;
+		}
+
+		alias.model->m_ready = true;
+		m_pendingAliases.erase(m_pendingAliases.begin() + i);
+	}
+}
+
+void ModelRegistry::evictUnused() {
+	for(auto it = m_entries.begin(); it != m_entries.end();) {
+		// The loader and pending aliases hold their own references, so only settled models are dropped here
+		if(it->second.model.use_count() > 1) {
+			++it;
+			continue;
+		}
+
+		it = m_entries.erase(it);
+	}
+
+	// Hand the GPU data of an evicted source over to an alias still using it
+	for(auto& [path, entry] : m_entries) {
+		if(entry.contentHash == 0 || !entry.model->isReady()) {
+			continue;
+		}
+
+		ContentSource& indexed = m_contentIndex[entry.contentHash];
+		if(indexed.model.expired()) {
+			indexed = {entry.model, path};
+			entry.shared = false;
+		}
+	}
+
+	for(auto it = m_contentIndex.begin(); it != m_contentIndex.end();) {
+		it = it->second.model.expired() ? m_contentIndex.erase(it) : std::next(it);
+	}
+}
+
+std::unordered_map<std::string, ModelRegistry::Entry>::iterator ModelRegistry::findEntry(const Model* p_model) {
+	for(auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+		if(it->second.model.get() == p_model) {
+			return it;
+		}
+	}
+
+	return m_entries.end();
+}
+
+} // FFL
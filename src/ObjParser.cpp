@@ -0,0 +1,389 @@
+#include "ObjParser.hpp"
+
+// STD
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace FFL {
+
+static constexpr size_t MIN_CHUNK_SIZE = 64 * 1024;
+
+static bool isBlank(char p_c) {
+	return p_c == ' ' || p_c == '\t' || p_c == '\r';
+}
+
+static bool isDigit(char p_c) {
+	return p_c >= '0' && p_c <= '9';
+}
+
+static const char* skipBlanks(const char* p_begin, const char* p_end) {
+	while(p_begin < p_end && isBlank(*p_begin)) {
+		p_begin++;
+	}
+
+	return p_begin;
+}
+
+static const char* findLineEnd(const char* p_begin, const char* p_end) {
+	const char* newline = static_cast<const char*>(memchr(p_begin, '\n', static_cast<size_t>(p_end - p_begin)));
+
+	return newline ? newline : p_end;
+}
+
+static const char* parseInt(const char* p_begin, const char* p_end, int64_t& p_value) {
+	const char* p = p_begin;
+
+	bool negative = false;
+	if(p < p_end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+
+	if(p == p_end || !isDigit(*p)) {
+		return p_begin;
+	}
+
+	int64_t value = 0;
+	while(p < p_end && isDigit(*p)) {
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+
+	p_value = negative ? -value : value;
+
+	return p;
+}
+
+const char* ObjParser::parseFloat(const char* p_begin, const char* p_end, float& p_value) {
+	// Exactly representable as doubles, so mantissa * 10^e is correctly rounded for small exponents (Clinger's fast path)
+	static constexpr double powersOfTen[] = {
+		1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+	};
+
+	const char* p = p_begin;
+
+	bool negative = false;
+	if(p < p_end && (*p == '-' || *p == '+')) {
+		negative = *p == '-';
+		p++;
+	}
+
+	uint64_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool hasDigits = false;
+
+	while(p < p_end && isDigit(*p)) {
+		if(significantDigits < 19) {
+			mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+			significantDigits += mantissa != 0;
+		} else {
+			exponent++;
+		}
+
+		hasDigits = true;
+		p++;
+	}
+
+	if(p < p_end && *p == '.') {
+		p++;
+
+		while(p < p_end && isDigit(*p)) {
+			if(significantDigits < 19) {
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				significantDigits += mantissa != 0;
+				exponent--;
+			}
+
+			hasDigits = true;
+			p++;
+		}
+	}
+
+	if(!hasDigits) {
+		return p_begin;
+	}
+
+	if(p < p_end && (*p == 'e' || *p == 'E')) {
+		int64_t explicitExponent = 0;
+		const char* exponentEnd = parseInt(p + 1, p_end, explicitExponent);
+
+		if(exponentEnd != p + 1) {
+			exponent += static_cast<int>(std::clamp<int64_t>(explicitExponent, -100000, 100000));
+			p = exponentEnd;
+		}
+	}
+
+	double value;
+	if(mantissa == 0) {
+		value = 0.0;
+	} else if(mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+		value = static_cast<double>(mantissa);
+		value = exponent < 0 ? value / powersOfTen[-exponent] : value * powersOfTen[exponent];
+	} else {
+		// Rare in mesh data, hand the token to the C library
+		char token[64] = {};
+		size_t length = std::min(static_cast<size_t>(p - p_begin), sizeof(token) - 1);
+		memcpy(token, p_begin, length);
+
+		p_value = static_cast<float>(std::strtod(token, nullptr));
+		return p;
+	}
+
+	p_value = static_cast<float>(negative ? -value : value);
+
+	return p;
+}
+
+ObjParser::ObjParser(const std::string& p_filePath) : m_filePath{p_filePath}, m_file{p_filePath} {}
+
+void ObjParser::parseAttributes(ThreadPool& p_pool) {
+	splitChunks((p_pool.threadCount() + 1) * 4);
+
+	p_pool.parallelFor(m_chunks.size(), [this](size_t p_index) {
+		countChunk(m_chunks[p_index]);
+	});
+
+	size_t positionCount = 0;
+	size_t normalCount = 0;
+	size_t texcoordCount = 0;
+	m_cornerCount = 0;
+	for(Chunk& chunk : m_chunks) {
+		chunk.firstPosition = positionCount;
+		chunk.firstNormal = normalCount;
+		chunk.firstTexcoord = texcoordCount;
+
+		positionCount += chunk.positionCount;
+		normalCount += chunk.normalCount;
+		texcoordCount += chunk.texcoordCount;
+		m_cornerCount += chunk.cornerCount;
+	}
+
+	m_positions.resize(positionCount * 3);
+	m_colors.resize(positionCount * 3);
+	m_normals.resize(normalCount * 3);
+	m_texcoords.resize(texcoordCount * 2);
+
+	p_pool.parallelFor(m_chunks.size(), [this](size_t p_index) {
+		parseChunkAttributes(m_chunks[p_index]);
+	});
+}
+
+void ObjParser::parseFaces(ThreadPool& p_pool, const CornerCallback& p_onCorners) {
+	// Faces may reference any attribute in the file, so they are only resolved once every attribute is parsed
+	size_t windowSize = (p_pool.threadCount() + 1) * 2;
+	std::vector<std::vector<Corner>> windowCorners(windowSize);
+
+	for(size_t windowBegin = 0; windowBegin < m_chunks.size(); windowBegin += windowSize) {
+		size_t windowCount = std::min(windowSize, m_chunks.size() - windowBegin);
+
+		p_pool.parallelFor(windowCount, [this, windowBegin, &windowCorners](size_t p_index) {
+			windowCorners[p_index].clear();
+			parseChunkFaces(m_chunks[windowBegin + p_index], windowCorners[p_index]);
+		});
+
+		for(size_t i = 0; i < windowCount; i++) {
+			p_onCorners(windowCorners[i].data(), windowCorners[i].size());
+		}
+	}
+}
+
+void ObjParser::splitChunks(size_t p_targetCount) {
+	const char* begin = reinterpret_cast<const char*>(m_file.data());
+	const char* end = begin + m_file.size();
+
+	size_t chunkSize = std::clamp(m_file.size() / std::max<size_t>(p_targetCount, 1), MIN_CHUNK_SIZE, CHUNK_SIZE);
+
+	m_chunks.clear();
+	while(begin < end) {
+		const char* chunkEnd = begin + std::min(chunkSize, static_cast<size_t>(end - begin));
+		chunkEnd = chunkEnd < end ? findLineEnd(chunkEnd, end) : end;
+		chunkEnd = chunkEnd < end ? chunkEnd + 1 : end;
+
+		Chunk chunk = {};
+		chunk.begin = begin;
+		chunk.end = chunkEnd;
+		m_chunks.push_back(chunk);
+
+		begin = chunkEnd;
+	}
+}
+
+void ObjParser::countChunk(Chunk& p_chunk) {
+	for(const char* line = p_chunk.begin; line < p_chunk.end;) {
+		const char* lineEnd = findLineEnd(line, p_chunk.end);
+		const char* p = skipBlanks(line, lineEnd);
+
+		if(lineEnd - p >= 2 && p[0] == 'v') {
+			if(isBlank(p[1])) {
+				p_chunk.positionCount++;
+			} else if(lineEnd - p >= 3 && isBlank(p[2])) {
+				p_chunk.normalCount += p[1] == 'n';
+				p_chunk.texcoordCount += p[1] == 't';
+			}
+		} else if(lineEnd - p >= 2 && p[0] == 'f' && isBlank(p[1])) {
+			// Count vertex tokens to size the triangulated output up front
+			size_t tokenCount = 0;
+			for(p++; p < lineEnd; p++) {
+				tokenCount += isBlank(p[-1]) && !isBlank(p[0]);
+			}
+
+			p_chunk.cornerCount += tokenCount >= 3 ? (tokenCount - 2) * 3 : 0;
+		}
+
+		line = lineEnd + 1;
+	}
+}
+
+void ObjParser::parseChunkAttributes(const Chunk& p_chunk) {
+	float* positions = m_positions.data() + p_chunk.firstPosition * 3;
+	float* colors = m_colors.data() + p_chunk.firstPosition * 3;
+	float* normals = m_normals.data() + p_chunk.firstNormal * 3;
+	float* texcoords = m_texcoords.data() + p_chunk.firstTexcoord * 2;
+
+	for(const char* line = p_chunk.begin; line < p_chunk.end;) {
+		const char* lineEnd = findLineEnd(line, p_chunk.end);
+		const char* p = skipBlanks(line, lineEnd);
+
+		if(lineEnd - p < 2 || p[0] != 'v') {
+			line = lineEnd + 1;
+			continue;
+		}
+
+		char type = isBlank(p[1]) ? ' ' : p[1];
+		if(type != ' ' && (lineEnd - p < 3 || !isBlank(p[2]))) {
+			line = lineEnd + 1;
+			continue;
+		}
+
+		p += type == ' ' ? 1 : 2;
+
+		// Positions may carry a vertex color (x y z r g b), colors default to white like tinyobj
+		float values[6] = {0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+		size_t valueCount = 0;
+		while(valueCount < 6) {
+			p = skipBlanks(p, lineEnd);
+
+			const char* next = parseFloat(p, lineEnd, values[valueCount]);
+			if(next == p) {
+				break;
+			}
+
+			p = next;
+			valueCount++;
+		}
+
+		if(type == ' ') {
+			memcpy(positions, values, 3 * sizeof(float));
+			if(valueCount < 6) {
+				values[3] = values[4] = values[5] = 1.0f;
+			}
+			memcpy(colors, values + 3, 3 * sizeof(float));
+
+			positions += 3;
+			colors += 3;
+		} else if(type == 'n') {
+			memcpy(normals, values, 3 * sizeof(float));
+			normals += 3;
+		} else if(type == 't') {
+			memcpy(texcoords, values, 2 * sizeof(float));
+			texcoords += 2;
+		}
+
+		line = lineEnd + 1;
+	}
+}
+
+void ObjParser::parseChunkFaces(const Chunk& p_chunk, std::vector<Corner>& p_corners) {
+	const int64_t totalPositions = static_cast<int64_t>(m_positions.size() / 3);
+	const int64_t totalNormals = static_cast<int64_t>(m_normals.size() / 3);
+	const int64_t totalTexcoords = static_cast<int64_t>(m_texcoords.size() / 2);
+
+	// Attributes defined before the current line, needed to resolve negative (relative) indices
+	int64_t positionsSoFar = static_cast<int64_t>(p_chunk.firstPosition);
+	int64_t normalsSoFar = static_cast<int64_t>(p_chunk.firstNormal);
+	int64_t texcoordsSoFar = static_cast<int64_t>(p_chunk.firstTexcoord);
+
+	auto resolve = [this](int64_t p_index, int64_t p_soFar, int64_t p_total) {
+		int64_t resolved = p_index > 0 ? p_index - 1 : p_soFar + p_index;
+
+		if(p_index == 0 || resolved < 0 || resolved >= p_total) {
+			throw std::runtime_error("invalid face index in " + m_filePath);
+		}
+
+		return static_cast<int32_t>(resolved);
+	};
+
+	std::vector<Corner> polygon = {};
+
+	for(const char* line = p_chunk.begin; line < p_chunk.end;) {
+		const char* lineEnd = findLineEnd(line, p_chunk.end);
+		const char* p = skipBlanks(line, lineEnd);
+
+		if(lineEnd - p >= 2 && p[0] == 'v') {
+			if(isBlank(p[1])) {
+				positionsSoFar++;
+			} else if(lineEnd - p >= 3 && isBlank(p[2])) {
+				normalsSoFar += p[1] == 'n';
+				texcoordsSoFar += p[1] == 't';
+			}
+		}
+
+		if(lineEnd - p < 2 || p[0] != 'f' || !isBlank(p[1])) {
+			line = lineEnd + 1;
+			continue;
+		}
+
+		p += 1;
+		polygon.clear();
+
+		while(true) {
+			p = skipBlanks(p, lineEnd);
+
+			int64_t index = 0;
+			const char* next = parseInt(p, lineEnd, index);
+			if(next == p) {
+				break;
+			}
+
+			Corner corner = {};
+			corner.position = resolve(index, positionsSoFar, totalPositions);
+			p = next;
+
+			if(p < lineEnd && *p == '/') {
+				p++;
+
+				next = parseInt(p, lineEnd, index);
+				if(next != p) {
+					corner.texcoord = resolve(index, texcoordsSoFar, totalTexcoords);
+					p = next;
+				}
+
+				if(p < lineEnd && *p == '/') {
+					p++;
+
+					next = parseInt(p, lineEnd, index);
+					if(next != p) {
+						corner.normal = resolve(index, normalsSoFar, totalNormals);
+						p = next;
+					}
+				}
+			}
+
+			polygon.push_back(corner);
+		}
+
+		for(size_t i = 2; i < polygon.size(); i++) {
+			p_corners.push_back(polygon[0]);
+			p_corners.push_back(polygon[i - 1]);
+			p_corners.push_back(polygon[i]);
+		}
+
+		line = lineEnd + 1;
+	}
+}
+
+} // FFL
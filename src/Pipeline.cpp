@@ -1,124 +1,422 @@
 #include "Pipeline.hpp"
 #include "Model.hpp"
+#include "PipelineCache.hpp"
+#include "ShaderReloader.hpp"
 
 // Libraries
 #include <array>
 #include <vulkan/vulkan_core.h>
 
 // STD
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
-#include <fstream>
+#include <exception>
+#include <functional>
 #include <iostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
 #include <cassert>
 #include <vector>
 
-#ifndef ENGINE_DIR
-#define ENGINE_DIR "../"
-#endif
-
 namespace FFL {
 
-Pipeline::Pipeline(Device& p_device, const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath) : m_device{p_device} {
-	createGraphicsPipeline(p_configInfo, p_vertPath, p_fragPath);
+// The create info of a graphics pipeline and the state it points to, shared by whole pipelines and library parts
+struct GraphicsPipelineState {
+	VkPipelineShaderStageCreateInfo shaderStages[2];
+	VkShaderModuleCreateInfo inlineModules[2];
+	VkSpecializationInfo specializationInfo;
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo;
+	VkGraphicsPipelineCreateInfo pipelineInfo;
+};
+
+// Library parts are keyed by the raw bytes of every field they are built from, compared in full on a lookup
+template<typename... T>
+static void appendKey(std::string& p_key, const T&... p_values) {
+	(p_key.append(reinterpret_cast<const char*>(&p_values), sizeof(T)), ...);
+}
+
+// Prefixed with the count so neighbouring arrays cannot trade elements
+template<typename T>
+static void appendKeyArray(std::string& p_key, const T* p_values, size_t p_count) {
+	appendKey(p_key, p_count);
+	p_key.append(reinterpret_cast<const char*>(p_values), p_count * sizeof(T));
+}
+
+static void fillGraphicsPipelineState(const PipelineConfigInfo& p_configInfo, const std::vector<std::shared_ptr<ShaderModule>>& p_shaders, GraphicsPipelineState& p_state) {
+	p_shaders[0]->fillStageInfo(VK_SHADER_STAGE_VERTEX_BIT, p_state.shaderStages[0], p_state.inlineModules[0]);
+	p_shaders[1]->fillStageInfo(VK_SHADER_STAGE_FRAGMENT_BIT, p_state.shaderStages[1], p_state.inlineModules[1]);
+
+	p_state.specializationInfo = {};
+	p_state.specializationInfo.mapEntryCount = static_cast<uint32_t>(p_configInfo.specializationEntries.size());
+	p_state.specializationInfo.pMapEntries = p_configInfo.specializationEntries.data();
+	p_state.specializationInfo.dataSize = p_configInfo.specializationData.size();
+	p_state.specializationInfo.pData = p_configInfo.specializationData.data();
+
+	if(p_state.specializationInfo.mapEntryCount > 0) {
+		p_state.shaderStages[0].pSpecializationInfo = &p_state.specializationInfo;
+		p_state.shaderStages[1].pSpecializationInfo = &p_state.specializationInfo;
+	}
+
+	const std::vector<VkVertexInputBindingDescription>& bindingDescriptions = p_configInfo.bindingDescriptions;
+	const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions = p_configInfo.attributeDescriptions;
+
+	p_state.vertexInputInfo = {};
+	p_state.vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+	p_state.vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	p_state.vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+	p_state.vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+	p_state.vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+
+	p_state.pipelineInfo = {};
+	p_state.pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	p_state.pipelineInfo.stageCount = 2;
+	p_state.pipelineInfo.pStages = p_state.shaderStages;
+	p_state.pipelineInfo.pVertexInputState = &p_state.vertexInputInfo;
+	p_state.pipelineInfo.pInputAssemblyState = &p_configInfo.inputAssemblyInfo;
+	p_state.pipelineInfo.pViewportState = &p_configInfo.viewportInfo;
+	p_state.pipelineInfo.pRasterizationState = &p_configInfo.rasterizationInfo;
+	p_state.pipelineInfo.pMultisampleState = &p_configInfo.multisampleInfo;
+	p_state.pipelineInfo.pColorBlendState = &p_configInfo.colorBlendInfo;
+	p_state.pipelineInfo.pDepthStencilState = &p_configInfo.depthStencilInfo;
+	p_state.pipelineInfo.pDynamicState = &p_configInfo.dynamicStateInfo;
+	p_state.pipelineInfo.layout = p_configInfo.pipelineLayout;
+	p_state.pipelineInfo.renderPass = p_configInfo.renderPass;
+	p_state.pipelineInfo.subpass = p_configInfo.subpass;
+	p_state.pipelineInfo.basePipelineIndex = -1;
+	p_state.pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+}
+
+// Builds one part of a graphics pipeline library from the stages in [p_firstStage, p_firstStage + p_stageCount)
+// State outside the part is ignored by the driver
+static VkPipeline createPipelineLibrary(Device& p_device, const GraphicsPipelineState& p_state, VkGraphicsPipelineLibraryFlagsEXT p_part, uint32_t p_firstStage, uint32_t p_stageCount) {
+	VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo = {};
+	libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+	libraryInfo.flags = p_part;
+
+	VkGraphicsPipelineCreateInfo pipelineInfo = p_state.pipelineInfo;
+	pipelineInfo.pNext = &libraryInfo;
+	pipelineInfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR;
+	pipelineInfo.stageCount = p_stageCount;
+	pipelineInfo.pStages = p_stageCount > 0 ? &p_state.shaderStages[p_firstStage] : nullptr;
+
+	VkPipeline library = VK_NULL_HANDLE;
+	if(vkCreateGraphicsPipelines(p_device.device(), p_device.pipelineCache().getPipelineCache(), 1, &pipelineInfo, nullptr, &library) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline library!");
+	}
+
+	return library;
+}
+
+Pipeline::Pipeline(Device& p_device, const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath) : Pipeline(p_device, p_configInfo, p_vertPath, p_fragPath, Deferred{}) {
+	waitForBuild();
+}
+
+Pipeline::Pipeline(Device& p_device, VkPipelineLayout p_pipelineLayout, const std::string& p_compPath) : Pipeline(p_device, p_pipelineLayout, p_compPath, Deferred{}) {
+	waitForBuild();
+}
+
+Pipeline::Pipeline(Device& p_device, const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath, Deferred) : m_device{p_device}, m_shaderPaths{p_vertPath, p_fragPath}, m_configInfo{new PipelineConfigInfo{}}, m_pendingBuild{std::make_shared<PendingBuild>()} {
+	copyConfigInfo(p_configInfo, *m_configInfo);
+
+	std::cout << "Creating graphics pipeline: " << p_vertPath << ", " << p_fragPath << '\n';
+
+	m_device.shaderReloader().track(this);
+}
+
+Pipeline::Pipeline(Device& p_device, VkPipelineLayout p_pipelineLayout, const std::string& p_compPath, Deferred) : m_device{p_device}, m_bindPoint{VK_PIPELINE_BIND_POINT_COMPUTE}, m_shaderPaths{p_compPath}, m_computeLayout{p_pipelineLayout}, m_pendingBuild{std::make_shared<PendingBuild>()} {
+	std::cout << "Creating compute pipeline: " << p_compPath << '\n';
+
+	m_device.shaderReloader().track(this);
 }
 
 Pipeline::~Pipeline() {
-	vkDestroyShaderModule(m_device.device(), m_vertShaderModule, nullptr);
-	vkDestroyShaderModule(m_device.device(), m_fragShaderModule, nullptr);
-	vkDestroyPipeline(m_device.device(), m_graphicsPipeline, nullptr);
+	m_device.shaderReloader().untrack(this);
+
+	vkDestroyPipeline(m_device.device(), cancelBuild(), nullptr);
+	vkDestroyPipeline(m_device.device(), m_pipeline, nullptr);
+}
+
+void Pipeline::bind(VkCommandBuffer p_commandBuffer) {
+	waitForBuild();
+
+	vkCmdBindPipeline(p_commandBuffer, m_bindPoint, m_pipeline);
 }
 
-std::vector<char> Pipeline::readFile(const std::string& p_filePath) {
-	std::string enginePath = ENGINE_DIR + p_filePath;
-	std::ifstream file(enginePath, std::ios::ate | std::ios::binary);
+bool Pipeline::usesShader(const std::string& p_filePath) const {
+	return std::find(m_shaderPaths.begin(), m_shaderPaths.end(), p_filePath) != m_shaderPaths.end();
+}
+
+VkPipeline Pipeline::createPipeline(std::vector<std::shared_ptr<ShaderModule>>& p_shaders, bool p_fastLink) const {
+	VkPipeline pipeline = VK_NULL_HANDLE;
 
-	if(!file.is_open()) {
-		throw std::runtime_error("failed to open file: " + enginePath);
+	if(m_bindPoint == VK_PIPELINE_BIND_POINT_COMPUTE) {
+		pipeline = createComputePipeline(p_shaders);
+	} else if(p_fastLink && m_device.supportsPipelineLibraries()) {
+		pipeline = createLinkedPipeline(p_shaders);
+	} else {
+		pipeline = createGraphicsPipeline(p_shaders);
 	}
 
-	size_t fileSize = static_cast<size_t>(file.tellg());
-	std::vector<char> buffer(fileSize);
+	// Without inline SPIR-V the modules are kept for the next pipeline using them
+	if(m_device.supportsInlineShaders()) {
+		p_shaders.clear();
+	}
 
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
+	return pipeline;
+}
+
+VkPipeline Pipeline::replacePipeline(VkPipeline p_pipeline, std::vector<std::shared_ptr<ShaderModule>> p_shaders) {
+	// A build that has not finished yet is superseded, whatever it produced is retired with the old pipeline
+	VkPipeline oldPipeline = m_pipeline != VK_NULL_HANDLE ? m_pipeline : cancelBuild();
 
-	file.close();
+	m_pipeline = p_pipeline;
+	m_shaders = std::move(p_shaders);
 
-	return buffer;
+	return oldPipeline;
 }
 
-void Pipeline::createGraphicsPipeline(const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath) {
-	assert(p_configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in p_configInfo");
-	assert(p_configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in p_configInfo");
+std::function<void()> Pipeline::deferBuild() {
+	return [this, build = m_pendingBuild]() {
+		// Whoever claims the build first runs it, a pipeline that is bound or destroyed before a worker gets here
+		// has already claimed it and this must not touch it
+		if(!build->claimed.exchange(true)) {
+			runBuild(*build, false);
+		}
+	};
+}
 
-	std::vector<char> vertShaderCode = readFile(p_vertPath);
-	std::vector<char> fragShaderCode = readFile(p_fragPath);
+void Pipeline::runBuild(PendingBuild& p_build, bool p_fastLink) const {
+	try {
+		p_build.pipeline = createPipeline(p_build.shaders, p_fastLink);
+		p_build.linked = p_fastLink && m_bindPoint == VK_PIPELINE_BIND_POINT_GRAPHICS && m_device.supportsPipelineLibraries();
+	} catch(...) {
+		p_build.error = std::current_exception();
+	}
 
-	std::cout << "Vertex Shader Code Size: " << vertShaderCode.size() << '\n';
-	std::cout << "Fragment Shader Code Size: " << fragShaderCode.size() << '\n';
+	p_build.finished.set_value();
+}
 
-	createShaderModule(vertShaderCode, &m_vertShaderModule);
-	createShaderModule(fragShaderCode, &m_fragShaderModule);
+void Pipeline::waitForBuild() {
+	if(m_pendingBuild == nullptr) {
+		return;
+	}
 
-	VkPipelineShaderStageCreateInfo shaderStages[2];
-	shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
-	shaderStages[0].module = m_vertShaderModule;
-	shaderStages[0].pName = "main";
-	shaderStages[0].flags = 0;
-	shaderStages[0].pNext = nullptr;
-	shaderStages[0].pSpecializationInfo = nullptr;
-
-	shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-	shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-	shaderStages[1].module = m_fragShaderModule;
-	shaderStages[1].pName = "main";
-	shaderStages[1].flags = 0;
-	shaderStages[1].pNext = nullptr;
-	shaderStages[1].pSpecializationInfo = nullptr;
+	std::shared_ptr<PendingBuild> build = std::move(m_pendingBuild);
+	m_pendingBuild = nullptr;
 
-	const std::vector<VkVertexInputBindingDescription>& bindingDescriptions = p_configInfo.bindingDescriptions;
-	const std::vector<VkVertexInputAttributeDescription>& attributeDescriptions = p_configInfo.attributeDescriptions;
+	// Needed right now, linking from cached parts is the quickest way to get there
+	if(!build->claimed.exchange(true)) {
+		runBuild(*build, true);
+	}
 
-	VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-	vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-	vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
-	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-	vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+	build->finished.get_future().wait();
+
+	if(build->error != nullptr) {
+		std::rethrow_exception(build->error);
+	}
+
+	m_pipeline = build->pipeline;
+	m_shaders = std::move(build->shaders);
+
+	// Linked pipelines skip cross-stage optimization, an optimized one replaces it once built
+	if(build->linked) {
+		m_device.shaderReloader().rebuild(this);
+	}
+}
+
+VkPipeline Pipeline::cancelBuild() {
+	if(m_pendingBuild == nullptr) {
+		return VK_NULL_HANDLE;
+	}
+
+	std::shared_ptr<PendingBuild> build = std::move(m_pendingBuild);
+	m_pendingBuild = nullptr;
+
+	if(!build->claimed.exchange(true)) {
+		return VK_NULL_HANDLE;
+	}
+
+	build->finished.get_future().wait();
+
+	return build->pipeline;
+}
+
+VkPipeline Pipeline::createGraphicsPipeline(std::vector<std::shared_ptr<ShaderModule>>& p_shaders) const {
+	const PipelineConfigInfo& configInfo = *m_configInfo;
+
+	assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in p_configInfo");
+	assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in p_configInfo");
+
+	p_shaders = {m_device.shaderLibrary().load(m_shaderPaths[0]), m_device.shaderLibrary().load(m_shaderPaths[1])};
+
+	GraphicsPipelineState state;
+	fillGraphicsPipelineState(configInfo, p_shaders, state);
+
+	PipelineCache& pipelineCache = m_device.pipelineCache();
+	auto startTime = std::chrono::steady_clock::now();
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if(vkCreateGraphicsPipelines(m_device.device(), pipelineCache.getPipelineCache(), 1, &state.pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create graphics pipeline!");
+	}
+
+	pipelineCache.recordCreation(std::chrono::steady_clock::now() - startTime);
+
+	return pipeline;
+}
+
+VkPipeline Pipeline::createLinkedPipeline(std::vector<std::shared_ptr<ShaderModule>>& p_shaders) const {
+	const PipelineConfigInfo& configInfo = *m_configInfo;
+
+	assert(configInfo.pipelineLayout != VK_NULL_HANDLE && "Cannot create graphics pipeline: no pipelineLayout provided in p_configInfo");
+	assert(configInfo.renderPass != VK_NULL_HANDLE && "Cannot create graphics pipeline: no renderPass provided in p_configInfo");
+
+	p_shaders = {m_device.shaderLibrary().load(m_shaderPaths[0]), m_device.shaderLibrary().load(m_shaderPaths[1])};
+
+	GraphicsPipelineState state;
+	fillGraphicsPipelineState(configInfo, p_shaders, state);
+
+	// Parts are keyed field by field, the Vulkan structures have padding and pointers
+	const VkPipelineRasterizationStateCreateInfo& rasterization = configInfo.rasterizationInfo;
+	const VkPipelineMultisampleStateCreateInfo& multisample = configInfo.multisampleInfo;
+	const VkPipelineDepthStencilStateCreateInfo& depthStencil = configInfo.depthStencilInfo;
+	const VkPipelineColorBlendStateCreateInfo& colorBlend = configInfo.colorBlendInfo;
+
+	std::string sharedKey;
+	appendKey(sharedKey, configInfo.pipelineLayout, configInfo.renderPass, configInfo.subpass);
+	appendKeyArray(sharedKey, configInfo.dynamicStateInfo.pDynamicStates, configInfo.dynamicStateInfo.dynamicStateCount);
+
+	std::string specializationKey;
+	appendKeyArray(specializationKey, configInfo.specializationEntries.data(), configInfo.specializationEntries.size());
+	appendKeyArray(specializationKey, configInfo.specializationData.data(), configInfo.specializationData.size());
+
+	std::string multisampleKey;
+	appendKey(multisampleKey, multisample.rasterizationSamples, multisample.sampleShadingEnable, multisample.minSampleShading, multisample.alphaToCoverageEnable, multisample.alphaToOneEnable);
+
+	std::string vertexInputKey = sharedKey;
+	appendKey(vertexInputKey, VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT, configInfo.inputAssemblyInfo.topology, configInfo.inputAssemblyInfo.primitiveRestartEnable);
+	appendKeyArray(vertexInputKey, configInfo.bindingDescriptions.data(), configInfo.bindingDescriptions.size());
+	appendKeyArray(vertexInputKey, configInfo.attributeDescriptions.data(), configInfo.attributeDescriptions.size());
+
+	// The shader stages carry their whole SPIR-V, a content hash alone could collide
+	std::string preRasterizationKey = sharedKey;
+	appendKey(preRasterizationKey, VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT);
+	appendKeyArray(preRasterizationKey, p_shaders[0]->code(), p_shaders[0]->codeSize() / sizeof(uint32_t));
+	preRasterizationKey += specializationKey;
+	appendKey(preRasterizationKey, configInfo.viewportInfo.viewportCount, configInfo.viewportInfo.scissorCount);
+	appendKey(preRasterizationKey, rasterization.depthClampEnable, rasterization.rasterizerDiscardEnable, rasterization.polygonMode, rasterization.cullMode, rasterization.frontFace);
+	appendKey(preRasterizationKey, rasterization.depthBiasEnable, rasterization.depthBiasConstantFactor, rasterization.depthBiasClamp, rasterization.depthBiasSlopeFactor, rasterization.lineWidth);
+
+	std::string fragmentShaderKey = sharedKey;
+	appendKey(fragmentShaderKey, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+	appendKeyArray(fragmentShaderKey, p_shaders[1]->code(), p_shaders[1]->codeSize() / sizeof(uint32_t));
+	fragmentShaderKey += specializationKey + multisampleKey;
+	appendKey(fragmentShaderKey, depthStencil.depthTestEnable, depthStencil.depthWriteEnable, depthStencil.depthCompareOp, depthStencil.depthBoundsTestEnable, depthStencil.stencilTestEnable);
+	appendKey(fragmentShaderKey, depthStencil.front, depthStencil.back, depthStencil.minDepthBounds, depthStencil.maxDepthBounds);
+
+	std::string fragmentOutputKey = sharedKey;
+	appendKey(fragmentOutputKey, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT);
+	fragmentOutputKey += multisampleKey;
+	appendKey(fragmentOutputKey, colorBlend.logicOpEnable, colorBlend.logicOp);
+	appendKeyArray(fragmentOutputKey, colorBlend.pAttachments, colorBlend.attachmentCount);
+	appendKey(fragmentOutputKey, colorBlend.blendConstants);
+
+	PipelineCache& pipelineCache = m_device.pipelineCache();
+	auto startTime = std::chrono::steady_clock::now();
+
+	std::array<VkPipeline, 4> libraries = {
+		pipelineCache.getLibrary(vertexInputKey, {}, [&]() {return createPipelineLibrary(m_device, state, VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT, 0, 0);}),
+		pipelineCache.getLibrary(preRasterizationKey, {p_shaders[0]}, [&]() {return createPipelineLibrary(m_device, state, VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT, 0, 1);}),
+		pipelineCache.getLibrary(fragmentShaderKey, {p_shaders[1]}, [&]() {return createPipelineLibrary(m_device, state, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT, 1, 1);}),
+		pipelineCache.getLibrary(fragmentOutputKey, {}, [&]() {return createPipelineLibrary(m_device, state, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT, 0, 0);})
+	};
+
+	VkPipelineLibraryCreateInfoKHR linkInfo = {};
+	linkInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+	linkInfo.libraryCount = static_cast<uint32_t>(libraries.size());
+	linkInfo.pLibraries = libraries.data();
 
 	VkGraphicsPipelineCreateInfo pipelineInfo = {};
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-	pipelineInfo.stageCount = 2;
-	pipelineInfo.pStages = shaderStages;
-	pipelineInfo.pVertexInputState = &vertexInputInfo;
-	pipelineInfo.pInputAssemblyState = &p_configInfo.inputAssemblyInfo;
-	pipelineInfo.pViewportState = &p_configInfo.viewportInfo;
-	pipelineInfo.pRasterizationState = &p_configInfo.rasterizationInfo;
-	pipelineInfo.pMultisampleState = &p_configInfo.multisampleInfo;
-	pipelineInfo.pColorBlendState = &p_configInfo.colorBlendInfo;
-	pipelineInfo.pDepthStencilState = &p_configInfo.depthStencilInfo;
-	pipelineInfo.pDynamicState = &p_configInfo.dynamicStateInfo;
-	pipelineInfo.layout = p_configInfo.pipelineLayout;
-	pipelineInfo.renderPass = p_configInfo.renderPass;
-	pipelineInfo.subpass = p_configInfo.subpass;
+	pipelineInfo.pNext = &linkInfo;
+	pipelineInfo.layout = configInfo.pipelineLayout;
+	pipelineInfo.renderPass = configInfo.renderPass;
+	pipelineInfo.subpass = configInfo.subpass;
 	pipelineInfo.basePipelineIndex = -1;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 
-	if(vkCreateGraphicsPipelines(m_device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create graphics pipeline!");
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if(vkCreateGraphicsPipelines(m_device.device(), pipelineCache.getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to link graphics pipeline!");
 	}
+
+	pipelineCache.recordCreation(std::chrono::steady_clock::now() - startTime);
+
+	return pipeline;
 }
 
-void Pipeline::createShaderModule(const std::vector<char>& p_code, VkShaderModule* p_shaderModule) {
-	VkShaderModuleCreateInfo createInfo = {};
-	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = p_code.size();
-	createInfo.pCode = reinterpret_cast<const uint32_t*>(p_code.data());
+VkPipeline Pipeline::createComputePipeline(std::vector<std::shared_ptr<ShaderModule>>& p_shaders) const {
+	assert(m_computeLayout != VK_NULL_HANDLE && "Cannot create compute pipeline: no pipelineLayout provided");
+
+	p_shaders = {m_device.shaderLibrary().load(m_shaderPaths[0])};
 
-	if(vkCreateShaderModule(m_device.device(), &createInfo, nullptr, p_shaderModule) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create shader module!");
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	VkShaderModuleCreateInfo inlineModule;
+	p_shaders[0]->fillStageInfo(VK_SHADER_STAGE_COMPUTE_BIT, pipelineInfo.stage, inlineModule);
+	pipelineInfo.layout = m_computeLayout;
+	pipelineInfo.basePipelineIndex = -1;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+	PipelineCache& pipelineCache = m_device.pipelineCache();
+	auto startTime = std::chrono::steady_clock::now();
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	if(vkCreateComputePipelines(m_device.device(), pipelineCache.getPipelineCache(), 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute pipeline!");
 	}
+
+	pipelineCache.recordCreation(std::chrono::steady_clock::now() - startTime);
+
+	return pipeline;
+}
+
+void Pipeline::copyConfigInfo(const PipelineConfigInfo& p_source, PipelineConfigInfo& p_destination) {
+	p_destination.bindingDescriptions = p_source.bindingDescriptions;
+	p_destination.attributeDescriptions = p_source.attributeDescriptions;
+	p_destination.viewportInfo = p_source.viewportInfo;
+	p_destination.inputAssemblyInfo = p_source.inputAssemblyInfo;
+	p_destination.rasterizationInfo = p_source.rasterizationInfo;
+	p_destination.multisampleInfo = p_source.multisampleInfo;
+	p_destination.colorBlendAttachment = p_source.colorBlendAttachment;
+	p_destination.colorBlendInfo = p_source.colorBlendInfo;
+	p_destination.depthStencilInfo = p_source.depthStencilInfo;
+	p_destination.dynamicStateEnables = p_source.dynamicStateEnables;
+	p_destination.dynamicStateInfo = p_source.dynamicStateInfo;
+	p_destination.pipelineLayout = p_source.pipelineLayout;
+	p_destination.renderPass = p_source.renderPass;
+	p_destination.subpass = p_source.subpass;
+	p_destination.specializationEntries = p_source.specializationEntries;
+	p_destination.specializationData = p_source.specializationData;
+	p_destination.variantKey = p_source.variantKey;
+
+	// Re-point the state that refers into the config itself
+	if(p_source.colorBlendInfo.pAttachments == &p_source.colorBlendAttachment) {
+		p_destination.colorBlendInfo.pAttachments = &p_destination.colorBlendAttachment;
+	}
+
+	if(p_source.dynamicStateInfo.pDynamicStates == p_source.dynamicStateEnables.data()) {
+		p_destination.dynamicStateInfo.pDynamicStates = p_destination.dynamicStateEnables.data();
+	}
+}
+
+void PipelineConfigInfo::setSpecializationInfo(const VkSpecializationInfo& p_specializationInfo) {
+	specializationEntries.assign(p_specializationInfo.pMapEntries, p_specializationInfo.pMapEntries + p_specializationInfo.mapEntryCount);
+
+	const char* data = static_cast<const char*>(p_specializationInfo.pData);
+	specializationData.assign(data, data + p_specializationInfo.dataSize);
 }
 
 void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& p_configInfo) {
@@ -188,12 +486,21 @@ void Pipeline::defaultPipelineConfigInfo(PipelineConfigInfo& p_configInfo) {
 	p_configInfo.dynamicStateInfo.dynamicStateCount = static_cast<uint32_t>(p_configInfo.dynamicStateEnables.size());
 	p_configInfo.dynamicStateInfo.flags = 0;
 
-	p_configInfo.bindingDescriptions = Model::Vertex::getBindingDescriptions();
-	p_configInfo.attributeDescriptions = Model::Vertex::getAttributeDescriptions();
+	if(Model::SPLIT_POSITIONS) {
+		p_configInfo.bindingDescriptions = Model::VertexFormat::getSplitBindingDescriptions();
+		p_configInfo.attributeDescriptions = Model::VertexFormat::getSplitAttributeDescriptions();
+	} else {
+		p_configInfo.bindingDescriptions = Model::VertexFormat::getBindingDescriptions();
+		p_configInfo.attributeDescriptions = Model::VertexFormat::getAttributeDescriptions();
+	}
 }
 
-void Pipeline::bind(VkCommandBuffer p_commandBuffer) {
-	vkCmdBindPipeline(p_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+void Pipeline::positionOnlyPipelineConfigInfo(PipelineConfigInfo& p_configInfo) {
+	defaultPipelineConfigInfo(p_configInfo);
+
+	uint32_t stride = Model::SPLIT_POSITIONS ? Model::VertexFormat::POSITION_STRIDE : Model::VertexFormat::STRIDE;
+	p_configInfo.bindingDescriptions = Model::VertexFormat::getPositionBindingDescriptions(stride);
+	p_configInfo.attributeDescriptions = Model::VertexFormat::getPositionAttributeDescriptions();
 }
 
 } // FFL
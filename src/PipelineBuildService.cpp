@@ -0,0 +1,51 @@
+#include "PipelineBuildService.hpp"
+#include "Device.hpp"
+
+// STD
+#include <iostream>
+#include <utility>
+
+namespace FFL {
+
+PipelineBuildService::PipelineBuildService(Device& p_device, ThreadPool& p_threadPool) : m_device{p_device}, m_threadPool{p_threadPool} {}
+
+std::unique_ptr<Pipeline> PipelineBuildService::createGraphicsPipeline(const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath) {
+	// The deferred constructors are private, make_unique cannot reach them
+	std::unique_ptr<Pipeline> pipeline{new Pipeline{m_device, p_configInfo, p_vertPath, p_fragPath, Pipeline::Deferred{}}};
+
+	std::lock_guard<std::mutex> lock{m_mutex};
+	m_builds.push_back(pipeline->deferBuild());
+
+	return pipeline;
+}
+
+std::unique_ptr<Pipeline> PipelineBuildService::createComputePipeline(VkPipelineLayout p_pipelineLayout, const std::string& p_compPath) {
+	std::unique_ptr<Pipeline> pipeline{new Pipeline{m_device, p_pipelineLayout, p_compPath, Pipeline::Deferred{}}};
+
+	std::lock_guard<std::mutex> lock{m_mutex};
+	m_builds.push_back(pipeline->deferBuild());
+
+	return pipeline;
+}
+
+void PipelineBuildService::submit() {
+	std::vector<std::function<void()>> builds = {};
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		builds = std::move(m_builds);
+		m_builds.clear();
+	}
+
+	if(builds.empty()) {
+		return;
+	}
+
+	std::cout << "Building " << builds.size() << " pipelines on " << m_threadPool.threadCount() << " threads" << '\n';
+
+	// Nothing waits on the futures, pipelines wait on their own build when first bound
+	for(std::function<void()>& build : builds) {
+		m_threadPool.submit(std::move(build));
+	}
+}
+
+} // FFL
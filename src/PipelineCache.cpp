@@ -0,0 +1,194 @@
+#include "PipelineCache.hpp"
+#include "Device.hpp"
+#include "ShaderLibrary.hpp"
+#include "Utils.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace FFL {
+
+PipelineCache::PipelineCache(Device& p_device, const std::string& p_filePath) : m_device{p_device}, m_filePath{p_filePath} {
+	std::vector<char> data = {};
+
+	std::ifstream file(m_filePath, std::ios::binary);
+	if(file.is_open()) {
+		Header header = {};
+		Header expected = expectedHeader();
+
+		file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+
+		bool matches = file.good() && header.magic == expected.magic && header.version == expected.version && header.vendorID == expected.vendorID && header.deviceID == expected.deviceID && header.driverVersion == expected.driverVersion && memcmp(header.pipelineCacheUUID, expected.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+
+		if(matches) {
+			data.resize(header.dataSize);
+			file.read(data.data(), static_cast<std::streamsize>(data.size()));
+
+			if(!file.good() || hashBytes(data.data(), data.size()) != header.dataHash) {
+				data.clear();
+			}
+		}
+
+		if(data.empty()) {
+			std::cout << "Pipeline cache " << m_filePath << " is stale or corrupt, starting cold" << '\n';
+		}
+	}
+
+	m_warm = !data.empty();
+
+	VkPipelineCacheCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = data.size();
+	createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+	if(vkCreatePipelineCache(m_device.device(), &createInfo, nullptr, &m_pipelineCache) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline cache!");
+	}
+}
+
+PipelineCache::~PipelineCache() {
+	if(m_creationCount > 0) {
+		std::cout << "Created " << m_creationCount << " pipelines in " << std::chrono::duration<double, std::milli>(m_creationTime).count() << " ms with a " << (m_warm ? "warm" : "cold") << " pipeline cache" << '\n';
+	}
+
+	for(auto& [key, library] : m_libraries) {
+		vkDestroyPipeline(m_device.device(), library.pipeline, nullptr);
+	}
+
+	vkDestroyPipelineCache(m_device.device(), m_pipelineCache, nullptr);
+}
+
+PipelineCache::Header PipelineCache::expectedHeader() const {
+	Header header = {};
+	header.magic = MAGIC;
+	header.version = VERSION;
+	header.vendorID = m_device.properties.vendorID;
+	header.deviceID = m_device.properties.deviceID;
+	header.driverVersion = m_device.properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, m_device.properties.pipelineCacheUUID, VK_UUID_SIZE);
+
+	return header;
+}
+
+bool PipelineCache::save() {
+	size_t dataSize = 0;
+	if(vkGetPipelineCacheData(m_device.device(), m_pipelineCache, &dataSize, nullptr) != VK_SUCCESS) {
+		return false;
+	}
+
+	std::vector<char> data(dataSize);
+	if(vkGetPipelineCacheData(m_device.device(), m_pipelineCache, &dataSize, data.data()) != VK_SUCCESS) {
+		return false;
+	}
+
+	data.resize(dataSize);
+
+	Header header = expectedHeader();
+	header.dataSize = data.size();
+	header.dataHash = hashBytes(data.data(), data.size());
+
+	std::string tempPath = m_filePath + ".tmp";
+	{
+		std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+		if(!file.is_open()) {
+			std::cerr << "Failed to open pipeline cache " << tempPath << '\n';
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		file.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+		if(!file.good()) {
+			std::cerr << "Failed to write pipeline cache " << tempPath << '\n';
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(tempPath, m_filePath, error);
+	if(error) {
+		std::cerr << "Failed to replace pipeline cache " << m_filePath << ": " << error.message() << '\n';
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+void PipelineCache::recordCreation(std::chrono::nanoseconds p_duration) {
+	std::lock_guard<std::mutex> lock{m_statsMutex};
+
+	m_creationCount++;
+	m_creationTime += p_duration;
+}
+
+VkPipeline PipelineCache::getLibrary(const std::string& p_key, const std::vector<std::shared_ptr<ShaderModule>>& p_shaders, const std::function<VkPipeline()>& p_create) {
+	{
+		std::lock_guard<std::mutex> lock{m_libraryMutex};
+
+		auto it = m_libraries.find(p_key);
+		if(it != m_libraries.end()) {
+			it->second.shaders.assign(p_shaders.begin(), p_shaders.end());
+			return it->second.pipeline;
+		}
+	}
+
+	// Built unlocked so other parts are not held up, a thread that loses the race drops its copy
+	VkPipeline library = p_create();
+
+	std::lock_guard<std::mutex> lock{m_libraryMutex};
+
+	// A miss is what follows a shader edit, so this is where parts of the old code go
+	evictLibraries();
+
+	LibraryPart part = {};
+	part.pipeline = library;
+	for(const std::shared_ptr<ShaderModule>& shader : p_shaders) {
+		part.contentHashes.push_back(shader->getContentHash());
+	}
+
+	auto [it, inserted] = m_libraries.emplace(p_key, std::move(part));
+	if(!inserted) {
+		vkDestroyPipeline(m_device.device(), library, nullptr);
+	}
+
+	it->second.shaders.assign(p_shaders.begin(), p_shaders.end());
+
+	return it->second.pipeline;
+}
+
+void PipelineCache::evictLibraries() {
+	ShaderLibrary& shaderLibrary = m_device.shaderLibrary();
+
+	for(auto it = m_libraries.begin(); it != m_libraries.end();) {
+		const LibraryPart& part = it->second;
+
+		bool inUse = std::any_of(part.shaders.begin(), part.shaders.end(), [](const std::weak_ptr<ShaderModule>& p_shader) {
+			return !p_shader.expired();
+		});
+
+		bool loaded = std::all_of(part.contentHashes.begin(), part.contentHashes.end(), [&shaderLibrary](uint64_t p_contentHash) {
+			return shaderLibrary.isLoaded(p_contentHash);
+		});
+
+		if(inUse || loaded) {
+			it++;
+			continue;
+		}
+
+		// Linked pipelines do not refer to the libraries they were linked from, only builds still in flight do
+		vkDestroyPipeline(m_device.device(), part.pipeline, nullptr);
+		it = m_libraries.erase(it);
+	}
+}
+
+} // FFL
@@ -0,0 +1,47 @@
+#include "PipelineVariantCache.hpp"
+#include "PipelineBuildService.hpp"
+
+// STD
+#include <utility>
+
+namespace FFL {
+
+PipelineVariantCache::PipelineVariantCache(Device& p_device, const PipelineConfigInfo& p_configInfo, const std::string& p_vertPath, const std::string& p_fragPath, ConfigureFunction p_configure) : m_device{p_device}, m_configInfo{new PipelineConfigInfo{}}, m_vertPath{p_vertPath}, m_fragPath{p_fragPath}, m_configure{std::move(p_configure)} {
+	Pipeline::copyConfigInfo(p_configInfo, *m_configInfo);
+}
+
+Pipeline& PipelineVariantCache::get(uint64_t p_variantKey) {
+	std::unique_ptr<Pipeline>& variant = m_variants[p_variantKey];
+	if(variant != nullptr) {
+		return *variant;
+	}
+
+	PipelineConfigInfo configInfo = {};
+	configureVariant(p_variantKey, configInfo);
+
+	variant = std::make_unique<Pipeline>(m_device, configInfo, m_vertPath, m_fragPath);
+
+	return *variant;
+}
+
+void PipelineVariantCache::warmUp(const std::vector<uint64_t>& p_variantKeys) {
+	for(uint64_t variantKey : p_variantKeys) {
+		std::unique_ptr<Pipeline>& variant = m_variants[variantKey];
+		if(variant != nullptr) {
+			continue;
+		}
+
+		PipelineConfigInfo configInfo = {};
+		configureVariant(variantKey, configInfo);
+
+		variant = m_device.pipelineBuilds().createGraphicsPipeline(configInfo, m_vertPath, m_fragPath);
+	}
+}
+
+void PipelineVariantCache::configureVariant(uint64_t p_variantKey, PipelineConfigInfo& p_configInfo) const {
+	Pipeline::copyConfigInfo(*m_configInfo, p_configInfo);
+	p_configInfo.variantKey = p_variantKey;
+	m_configure(p_variantKey, p_configInfo);
+}
+
+} // FFL
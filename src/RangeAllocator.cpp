@@ -0,0 +1,94 @@
+#include "RangeAllocator.hpp"
+
+// STD
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+
+namespace FFL {
+
+RangeAllocator::RangeAllocator(uint64_t p_capacity) : m_capacity{p_capacity}, m_freeSize{p_capacity} {
+	if(p_capacity > 0) {
+		m_freeRanges.emplace(0, p_capacity);
+	}
+}
+
+uint64_t RangeAllocator::allocate(uint64_t p_size, uint64_t p_alignment) {
+	assert((p_alignment & (p_alignment - 1)) == 0 && "Alignment must be a power of two");
+
+	if(p_size == 0) {
+		return INVALID_OFFSET;
+	}
+
+	for(auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it) {
+		uint64_t rangeOffset = it->first;
+		uint64_t rangeSize = it->second;
+
+		uint64_t offset = (rangeOffset + p_alignment - 1) & ~(p_alignment - 1);
+		uint64_t padding = offset - rangeOffset;
+		if(padding + p_size > rangeSize) {
+			continue;
+		}
+
+		// Keep the alignment padding in front and the remainder behind as free ranges
+		m_freeRanges.erase(it);
+
+		if(padding > 0) {
+			m_freeRanges.emplace(rangeOffset, padding);
+		}
+
+		if(padding + p_size < rangeSize) {
+			m_freeRanges.emplace(offset + p_size, rangeSize - padding - p_size);
+		}
+
+		m_freeSize -= p_size;
+
+		return offset;
+	}
+
+	return INVALID_OFFSET;
+}
+
+void RangeAllocator::free(uint64_t p_offset, uint64_t p_size) {
+	assert(p_offset + p_size <= m_capacity && "Range is outside of the allocator");
+
+	if(p_size == 0) {
+		return;
+	}
+
+	m_freeSize += p_size;
+
+	auto next = m_freeRanges.lower_bound(p_offset);
+	assert((next == m_freeRanges.end() || p_offset + p_size <= next->first) && "Range overlaps a free range");
+
+	// Merge with the following range
+	if(next != m_freeRanges.end() && p_offset + p_size == next->first) {
+		p_size += next->second;
+		next = m_freeRanges.erase(next);
+	}
+
+	// Merge with the preceding range
+	if(next != m_freeRanges.begin()) {
+		auto previous = std::prev(next);
+		assert(previous->first + previous->second <= p_offset && "Range overlaps a free range");
+
+		if(previous->first + previous->second == p_offset) {
+			previous->second += p_size;
+			return;
+		}
+	}
+
+	m_freeRanges.emplace_hint(next, p_offset, p_size);
+}
+
+uint64_t RangeAllocator::largestFreeRange() const {
+	uint64_t largest = 0;
+
+	for(const auto& [offset, size] : m_freeRanges) {
+		largest = std::max(largest, size);
+	}
+
+	return largest;
+}
+
+} // FFL
@@ -1,5 +1,6 @@
 #include "Renderer.hpp"
 #include "Device.hpp"
+#include "FrameArena.hpp"
 #include "SwapChain.hpp"
 #include "Window.hpp"
 
@@ -40,6 +41,9 @@ VkCommandBuffer Renderer::beginFrame() {
 
 	m_isFrameStarted = true;
 
+	// Everything the previous frame allocated from the arena is done with
+	FrameArena::shared().reset();
+
 	VkCommandBuffer commandBuffer = getCurrentCommandBuffer();
 
 	VkCommandBufferBeginInfo beginInfo = {};
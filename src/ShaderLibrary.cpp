@@ -0,0 +1,132 @@
+#include "ShaderLibrary.hpp"
+#include "Device.hpp"
+#include "Utils.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
+namespace FFL {
+
+ShaderModule::ShaderModule(Device& p_device, const std::string& p_filePath, std::unique_ptr<MappedFile> p_file, uint64_t p_contentHash) : m_device{p_device}, m_filePath{p_filePath}, m_file{std::move(p_file)}, m_contentHash{p_contentHash} {
+	if(m_file->size() == 0 || m_file->size() % sizeof(uint32_t) != 0) {
+		throw std::runtime_error("invalid SPIR-V: " + m_filePath);
+	}
+
+	if(m_device.supportsInlineShaders()) {
+		return;
+	}
+
+	VkShaderModuleCreateInfo createInfo = {};
+	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	createInfo.codeSize = codeSize();
+	createInfo.pCode = code();
+
+	if(vkCreateShaderModule(m_device.device(), &createInfo, nullptr, &m_shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create shader module!");
+	}
+}
+
+ShaderModule::~ShaderModule() {
+	vkDestroyShaderModule(m_device.device(), m_shaderModule, nullptr);
+}
+
+void ShaderModule::fillStageInfo(VkShaderStageFlagBits p_stage, VkPipelineShaderStageCreateInfo& p_stageInfo, VkShaderModuleCreateInfo& p_moduleInfo) const {
+	p_stageInfo = {};
+	p_stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	p_stageInfo.stage = p_stage;
+	p_stageInfo.module = m_shaderModule;
+	p_stageInfo.pName = "main";
+
+	if(m_shaderModule != VK_NULL_HANDLE) {
+		return;
+	}
+
+	p_moduleInfo = {};
+	p_moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	p_moduleInfo.codeSize = codeSize();
+	p_moduleInfo.pCode = code();
+
+	p_stageInfo.pNext = &p_moduleInfo;
+}
+
+ShaderLibrary::ShaderLibrary(Device& p_device) : m_device{p_device} {}
+
+std::shared_ptr<ShaderModule> ShaderLibrary::load(const std::string& p_filePath) {
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	std::weak_ptr<ShaderModule>& byPath = m_paths[p_filePath];
+	if(std::shared_ptr<ShaderModule> shader = byPath.lock()) {
+		return shader;
+	}
+
+	std::string enginePath = ENGINE_DIR + p_filePath;
+	std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>(enginePath);
+	uint64_t contentHash = hashBytes(file->data(), file->size());
+
+	std::weak_ptr<ShaderModule>& byContent = m_contents[contentHash];
+	std::shared_ptr<ShaderModule> shader = byContent.lock();
+
+	// The hash only finds the candidate, a colliding file with other code gets a module of its own
+	bool sameCode = shader != nullptr && shader->codeSize() == file->size() && memcmp(shader->code(), file->data(), file->size()) == 0;
+	if(!sameCode) {
+		std::shared_ptr<ShaderModule> loaded = std::make_shared<ShaderModule>(m_device, p_filePath, std::move(file), contentHash);
+		if(shader == nullptr) {
+			byContent = loaded;
+		}
+
+		shader = std::move(loaded);
+	}
+
+	byPath = shader;
+	m_loadedHashes[p_filePath] = contentHash;
+
+	evictExpired();
+
+	return shader;
+}
+
+void ShaderLibrary::invalidate(const std::string& p_filePath) {
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	m_paths.erase(p_filePath);
+	m_loadedHashes.erase(p_filePath);
+}
+
+size_t ShaderLibrary::getModuleCount() {
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	evictExpired();
+
+	return m_contents.size();
+}
+
+bool ShaderLibrary::isLoaded(uint64_t p_contentHash) {
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	return std::any_of(m_loadedHashes.begin(), m_loadedHashes.end(), [p_contentHash](const auto& p_entry) {
+		return p_entry.second == p_contentHash;
+	});
+}
+
+void ShaderLibrary::evictExpired() {
+	for(auto it = m_paths.begin(); it != m_paths.end();) {
+		it = it->second.expired() ? m_paths.erase(it) : std::next(it);
+	}
+
+	for(auto it = m_contents.begin(); it != m_contents.end();) {
+		it = it->second.expired() ? m_contents.erase(it) : std::next(it);
+	}
+}
+
+} // FFL
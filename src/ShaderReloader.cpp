@@ -0,0 +1,392 @@
+#include "ShaderReloader.hpp"
+#include "Device.hpp"
+#include "Pipeline.hpp"
+#include "ShaderLibrary.hpp"
+#include "SwapChain.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <cerrno>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+#endif
+
+// STD
+#include <algorithm>
+#include <exception>
+#include <iostream>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+#ifndef ENGINE_DIR
+#define ENGINE_DIR "../"
+#endif
+
+#ifndef FFL_GLSL_VALIDATOR
+#define FFL_GLSL_VALIDATOR "glslangValidator"
+#endif
+
+namespace FFL {
+
+template<typename T>
+static bool isReady(const std::future<T>& p_future) {
+	return p_future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+ShaderReloader::ShaderReloader(Device& p_device, ThreadPool& p_threadPool) : m_device{p_device}, m_threadPool{p_threadPool}, m_shaderDir{ENGINE_DIR "shaders/"} {
+#ifdef FFL_SHADER_HOT_RELOAD
+#ifdef __linux__
+	m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if(m_inotify >= 0 && inotify_add_watch(m_inotify, m_shaderDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+		close(m_inotify);
+		m_inotify = -1;
+	}
+#else
+	std::error_code error;
+	for(const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(m_shaderDir, error)) {
+		m_writeTimes[entry.path().filename().string()] = entry.last_write_time(error);
+	}
+
+	m_watching = !error;
+#endif
+
+	if(!isWatching()) {
+		std::cerr << "Failed to watch " << m_shaderDir << ", shader hot reload is disabled" << '\n';
+	}
+#endif
+}
+
+ShaderReloader::~ShaderReloader() {
+	for(Compile& compile : m_compiles) {
+		compile.result.wait();
+	}
+
+	for(Rebuild& rebuild : m_rebuilds) {
+		vkDestroyPipeline(m_device.device(), rebuild.result.get().pipeline, nullptr);
+	}
+
+	for(RetiredPipeline& retired : m_retired) {
+		vkDestroyPipeline(m_device.device(), retired.pipeline, nullptr);
+	}
+
+#ifdef __linux__
+	if(m_inotify >= 0) {
+		close(m_inotify);
+	}
+#endif
+}
+
+bool ShaderReloader::isWatching() const {
+#ifdef __linux__
+	return m_inotify >= 0;
+#else
+	return m_watching;
+#endif
+}
+
+void ShaderReloader::track(Pipeline* p_pipeline) {
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	m_pipelines.push_back(p_pipeline);
+}
+
+void ShaderReloader::untrack(Pipeline* p_pipeline) {
+	std::vector<Rebuild> rebuilds = {};
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+
+		m_pipelines.erase(std::remove(m_pipelines.begin(), m_pipelines.end(), p_pipeline), m_pipelines.end());
+
+		auto running = std::stable_partition(m_rebuilds.begin(), m_rebuilds.end(), [p_pipeline](const Rebuild& p_rebuild) {
+			return p_rebuild.pipeline != p_pipeline;
+		});
+
+		std::move(running, m_rebuilds.end(), std::back_inserter(rebuilds));
+		m_rebuilds.erase(running, m_rebuilds.end());
+	}
+
+	// The tasks still read p_pipeline, so it has to outlive them
+	for(Rebuild& rebuild : rebuilds) {
+		vkDestroyPipeline(m_device.device(), rebuild.result.get().pipeline, nullptr);
+	}
+}
+
+void ShaderReloader::update() {
+	m_frame++;
+	retirePipelines();
+
+	for(const std::string& sourceName : pollChanges()) {
+		if(m_compiling.count(sourceName) > 0) {
+			m_stale.insert(sourceName);
+		} else {
+			startCompile(sourceName);
+		}
+	}
+
+	for(size_t i = 0; i < m_compiles.size();) {
+		if(!isReady(m_compiles[i].result)) {
+			i++;
+			continue;
+		}
+
+		std::string sourceName = std::move(m_compiles[i].sourceName);
+		bool compiled = m_compiles[i].result.get();
+		m_compiles.erase(m_compiles.begin() + i);
+		m_compiling.erase(sourceName);
+
+		if(m_stale.erase(sourceName) > 0) {
+			startCompile(sourceName);
+		} else if(compiled) {
+			startRebuilds(sourceName);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	for(size_t i = 0; i < m_rebuilds.size();) {
+		if(!isReady(m_rebuilds[i].result)) {
+			i++;
+			continue;
+		}
+
+		Pipeline* pipeline = m_rebuilds[i].pipeline;
+		BuildResult result = m_rebuilds[i].result.get();
+		m_rebuilds.erase(m_rebuilds.begin() + i);
+
+		if(result.pipeline == VK_NULL_HANDLE) {
+			continue;
+		}
+
+		VkPipeline oldPipeline = pipeline->replacePipeline(result.pipeline, std::move(result.shaders));
+		m_retired.push_back({m_frame + SwapChain::MAX_FRAMES_IN_FLIGHT, oldPipeline});
+	}
+}
+
+std::set<std::string> ShaderReloader::pollChanges() {
+	std::set<std::string> changes = {};
+
+#ifdef __linux__
+	if(m_inotify < 0) {
+		return changes;
+	}
+
+	alignas(inotify_event) char buffer[4096];
+	ssize_t length = 0;
+
+	while((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+		for(char* event = buffer; event < buffer + length;) {
+			const inotify_event* notification = reinterpret_cast<const inotify_event*>(event);
+
+			if(notification->len > 0 && isShaderSource(notification->name)) {
+				changes.insert(notification->name);
+			}
+
+			event += sizeof(inotify_event) + notification->len;
+		}
+	}
+#else
+	if(!m_watching || std::chrono::steady_clock::now() < m_nextPoll) {
+		return changes;
+	}
+
+	m_nextPoll = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+
+	std::error_code error;
+	for(const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(m_shaderDir, error)) {
+		std::string fileName = entry.path().filename().string();
+		std::filesystem::file_time_type writeTime = entry.last_write_time(error);
+
+		auto it = m_writeTimes.find(fileName);
+		if(it != m_writeTimes.end() && it->second == writeTime) {
+			continue;
+		}
+
+		m_writeTimes[fileName] = writeTime;
+
+		if(isShaderSource(fileName)) {
+			changes.insert(fileName);
+		}
+	}
+#endif
+
+	return changes;
+}
+
+void ShaderReloader::startCompile(const std::string& p_sourceName) {
+	std::string sourcePath = m_shaderDir + p_sourceName;
+	std::string spirvPath = sourcePath + ".spv";
+
+	m_compiling.insert(p_sourceName);
+	m_compiles.push_back({p_sourceName, m_threadPool.submit([sourcePath, spirvPath]() {
+		return compileShader(sourcePath, spirvPath);
+	})});
+}
+
+void ShaderReloader::startRebuilds(const std::string& p_sourceName) {
+	// Pipelines refer to their shaders relative to ENGINE_DIR, like ShaderLibrary::load
+	std::string spirvPath = "shaders/" + p_sourceName + ".spv";
+	m_device.shaderLibrary().invalidate(spirvPath);
+
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	size_t rebuildCount = 0;
+	for(Pipeline* pipeline : m_pipelines) {
+		if(!pipeline->usesShader(spirvPath)) {
+			continue;
+		}
+
+		rebuildCount++;
+		submitRebuild(pipeline);
+	}
+
+	std::cout << "Recompiled " << spirvPath << ", rebuilding " << rebuildCount << " pipelines" << '\n';
+}
+
+void ShaderReloader::rebuild(Pipeline* p_pipeline) {
+	std::lock_guard<std::mutex> lock{m_mutex};
+
+	submitRebuild(p_pipeline);
+}
+
+void ShaderReloader::submitRebuild(Pipeline* p_pipeline) {
+	m_rebuilds.push_back({p_pipeline, m_threadPool.submit([p_pipeline]() {
+		BuildResult result = {};
+
+		try {
+			result.pipeline = p_pipeline->createPipeline(result.shaders);
+		} catch(const std::exception& p_exception) {
+			std::cerr << "Failed to rebuild pipeline: " << p_exception.what() << '\n';
+		}
+
+		return result;
+	})});
+}
+
+void ShaderReloader::retirePipelines() {
+	auto retired = std::stable_partition(m_retired.begin(), m_retired.end(), [this](const RetiredPipeline& p_retired) {
+		return p_retired.frame > m_frame;
+	});
+
+	for(auto it = retired; it != m_retired.end(); ++it) {
+		vkDestroyPipeline(m_device.device(), it->pipeline, nullptr);
+	}
+
+	m_retired.erase(retired, m_retired.end());
+}
+
+bool ShaderReloader::isShaderSource(const std::string& p_fileName) {
+	std::string extension = std::filesystem::path(p_fileName).extension().string();
+
+	return extension == ".vert" || extension == ".frag" || extension == ".comp";
+}
+
+bool ShaderReloader::compileShader(const std::string& p_sourcePath, const std::string& p_spirvPath) {
+	// Compiled next to the old SPIR-V and renamed over it, mappings of the old file stay valid
+	std::string tempPath = p_spirvPath + ".tmp";
+
+	std::error_code error;
+
+	if(runProcess({FFL_GLSL_VALIDATOR, "-V", p_sourcePath, "-o", tempPath}) != 0) {
+		std::cerr << "Failed to compile " << p_sourcePath << ", keeping the previous SPIR-V" << '\n';
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	std::filesystem::rename(tempPath, p_spirvPath, error);
+	if(error) {
+		std::cerr << "Failed to replace " << p_spirvPath << ": " << error.message() << '\n';
+		std::filesystem::remove(tempPath, error);
+		return false;
+	}
+
+	return true;
+}
+
+#ifdef _WIN32
+
+int ShaderReloader::runProcess(const std::vector<std::string>& p_arguments) {
+	// CreateProcess takes a single command line, quoted the way the C runtime splits it back into argv
+	std::string commandLine;
+	for(const std::string& argument : p_arguments) {
+		if(!commandLine.empty()) {
+			commandLine += ' ';
+		}
+
+		commandLine += '"';
+		size_t backslashes = 0;
+		for(char c : argument) {
+			if(c == '\\') {
+				backslashes++;
+				continue;
+			}
+
+			// Backslashes are only special in front of a quote
+			commandLine.append(c == '"' ? backslashes * 2 + 1 : backslashes, '\\');
+			commandLine += c;
+			backslashes = 0;
+		}
+
+		commandLine.append(backslashes * 2, '\\');
+		commandLine += '"';
+	}
+
+	STARTUPINFOA startupInfo = {};
+	startupInfo.cb = sizeof(startupInfo);
+	PROCESS_INFORMATION processInfo = {};
+
+	if(!CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo)) {
+		return -1;
+	}
+
+	WaitForSingleObject(processInfo.hProcess, INFINITE);
+
+	DWORD exitCode = 0;
+	if(!GetExitCodeProcess(processInfo.hProcess, &exitCode)) {
+		exitCode = static_cast<DWORD>(-1);
+	}
+
+	CloseHandle(processInfo.hThread);
+	CloseHandle(processInfo.hProcess);
+
+	return static_cast<int>(exitCode);
+}
+
+#else
+
+int ShaderReloader::runProcess(const std::vector<std::string>& p_arguments) {
+	std::vector<char*> argv;
+	for(const std::string& argument : p_arguments) {
+		argv.push_back(const_cast<char*>(argument.c_str()));
+	}
+
+	argv.push_back(nullptr);
+
+	pid_t pid = 0;
+	if(posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ) != 0) {
+		return -1;
+	}
+
+	int status = 0;
+	while(waitpid(pid, &status, 0) == -1) {
+		if(errno != EINTR) {
+			return -1;
+		}
+	}
+
+	return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+#endif
+
+} // FFL
@@ -93,7 +93,7 @@ SwapChain::~SwapChain() {
 	for(size_t i = 0; i < m_depthImages.size(); i++) {
 		vkDestroyImageView(m_device.device(), m_depthImageViews[i], nullptr);
 		vkDestroyImage(m_device.device(), m_depthImages[i], nullptr);
-		vkFreeMemory(m_device.device(), m_depthImageMemories[i], nullptr);
+		m_device.memoryAllocator().free(m_depthImageMemories[i]);
 	}
 
 	for(VkFramebuffer framebuffer : m_swapChainFramebuffers) {
@@ -1,7 +1,9 @@
 #include "Systems/PointLightSystem.hpp"
 #include "Camera.hpp"
+#include "FrameArena.hpp"
 #include "FrameInfo.hpp"
 #include "GameObject.hpp"
+#include "PipelineBuildService.hpp"
 
 // Libraries
 #define GLFW_INCLUDE_VULKAN
@@ -46,7 +48,7 @@ void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout p_globalSetLay
 	pushConstantRange.offset = 0;
 	pushConstantRange.size = sizeof(PointLightPushConstants);
 
-	std::vector<VkDescriptorSetLayout> descriptorSetLayouts = {p_globalSetLayout};
+	FrameVector<VkDescriptorSetLayout> descriptorSetLayouts = {p_globalSetLayout};
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -70,7 +72,7 @@ void PointLightSystem::createPipeline(VkRenderPass p_renderPass) {
 	pipelineConfig.renderPass = p_renderPass;
 	pipelineConfig.pipelineLayout = m_pipelineLayout;
 
-	m_pipeline = std::make_unique<Pipeline>(m_device, pipelineConfig, "shaders/point_light.vert.spv", "shaders/point_light.frag.spv");
+	m_pipeline = m_device.pipelineBuilds().createGraphicsPipeline(pipelineConfig, "shaders/point_light.vert.spv", "shaders/point_light.frag.spv");
 }
 
 void PointLightSystem::update(FrameInfo& p_frameInfo, GlobalUniformBufferObject& p_uniformBufferObject) {
@@ -103,7 +105,7 @@ void PointLightSystem::update(FrameInfo& p_frameInfo, GlobalUniformBufferObject&
 void PointLightSystem::render(FrameInfo& p_frameInfo) {
 	m_pipeline->bind(p_frameInfo.commandBuffer);
 
-	vkCmdBindDescriptorSets(p_frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &p_frameInfo.globalDescriptorSet, 0, nullptr);
+	vkCmdBindDescriptorSets(p_frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &p_frameInfo.globalDescriptorSet, 1, &p_frameInfo.globalUniformOffset);
 
 	for(auto& kv : p_frameInfo.gameObjects) {
 		GameObject& obj = kv.second;
@@ -1,7 +1,11 @@
 #include "Systems/SimpleRenderSystem.hpp"
 #include "Camera.hpp"
+#include "Descriptors.hpp"
+#include "FrameArena.hpp"
 #include "FrameInfo.hpp"
 #include "GameObject.hpp"
+#include "PipelineBuildService.hpp"
+#include "SwapChain.hpp"
 
 // Libraries
 #define GLM_FORCE_RADIANS
@@ -14,8 +18,10 @@
 #include <vulkan/vulkan_core.h>
 
 // STD
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <memory>
 #include <stdexcept>
@@ -24,18 +30,45 @@
 
 namespace FFL {
 
+// Models whose meshlets can be culled at once, further models fall back to regular draws
+static constexpr uint32_t MAX_CULLED_MODELS = 256;
+
+// Matches local_size_x in meshlet_cull.comp
+static constexpr uint32_t CULL_GROUP_SIZE = 64;
+
+// Surface deviation a level of detail may have on screen, as a fraction of the viewport height (a pixel at 1080p)
+static constexpr float LOD_SCREEN_ERROR = 1.0f / 1080.0f;
+
+// Specialization constant IDs in simple_shader.frag
+static constexpr uint32_t MAX_LIGHT_COUNT_CONSTANT = 0;
+static constexpr uint32_t SPECULAR_ENABLED_CONSTANT = 1;
+static constexpr uint32_t SPECULAR_EXPONENT_CONSTANT = 2;
+
+static constexpr float SPECULAR_EXPONENT = 512.0f;
+
 struct SimplePushConstantData {
 	glm::mat4 modelMatrix{1.0f};
 	glm::mat4 normalMatrix{1.0f};
 };
 
+struct CullPushConstantData {
+	glm::mat4 modelViewProjection{1.0f};
+	glm::vec4 cameraPosition = {};
+	uint32_t meshletCount = 0;
+	uint32_t commandOffset = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+};
+
 SimpleRenderSystem::SimpleRenderSystem(Device& p_device, VkRenderPass p_renderPass, VkDescriptorSetLayout p_globalSetLayout) : m_device{p_device} {
 	createPipelineLayout(p_globalSetLayout);
 	createPipeline(p_renderPass);
+	createCullPipeline();
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() {
 	vkDestroyPipelineLayout(m_device.device(), m_pipelineLayout, nullptr);
+	vkDestroyPipelineLayout(m_device.device(), m_cullPipelineLayout, nullptr);
 }
 
 void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout p_globalSetLayout) {
@@ -44,7 +77,7 @@ void SimpleRenderSystem::createPipelineLayout(VkDescriptorSetLayout p_globalSetL
 	pushConstantRange.offset = 0;
 	pushConstantRange.size = sizeof(SimplePushConstantData);
 
-	std::vector<VkDescriptorSetLayout> descriptorSetLayouts = {p_globalSetLayout};
+	FrameVector<VkDescriptorSetLayout> descriptorSetLayouts = {p_globalSetLayout};
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -66,29 +99,323 @@ void SimpleRenderSystem::createPipeline(VkRenderPass p_renderPass) {
 	pipelineConfig.renderPass = p_renderPass;
 	pipelineConfig.pipelineLayout = m_pipelineLayout;
 
-	m_pipeline = std::make_unique<Pipeline>(m_device, pipelineConfig, "shaders/simple_shader.vert.spv", "shaders/simple_shader.frag.spv");
+#ifdef FFL_QUANTIZED_VERTICES
+	const char* vertPath = "shaders/simple_shader_quantized.vert.spv";
+#else
+	const char* vertPath = "shaders/simple_shader.vert.spv";
+#endif
+
+	m_pipelines = std::make_unique<PipelineVariantCache>(m_device, pipelineConfig, vertPath, "shaders/simple_shader.frag.spv", configureVariant);
+
+	// Meshlet draws skip clusters that face away in the cull pass, so the rasterizer has to agree on what is back-facing
+	pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_BACK_BIT;
+
+	m_meshletPipelines = std::make_unique<PipelineVariantCache>(m_device, pipelineConfig, vertPath, "shaders/simple_shader.frag.spv", configureVariant);
+
+	// Every light count bucket of the current features builds in parallel with the rest of startup, the generic
+	// variant among them, so the first frame only waits for the variant it draws with
+	std::vector<uint64_t> variantKeys = {};
+	for(int lightCount = 0; lightCount < MAX_LIGHTS; lightCount = std::max(lightCount * 2, 1)) {
+		variantKeys.push_back(selectVariant(lightCount));
+	}
+
+	variantKeys.push_back(selectVariant(MAX_LIGHTS));
+
+	m_pipelines->warmUp(variantKeys);
+	m_meshletPipelines->warmUp(variantKeys);
 }
 
-void SimpleRenderSystem::renderGameObjects(FrameInfo& p_frameInfo) {
-	m_pipeline->bind(p_frameInfo.commandBuffer);
+uint64_t SimpleRenderSystem::selectVariant(int p_lightCount) const {
+	if(!m_specializeVariants) {
+		return variantKey(MAX_LIGHTS, ALL_FEATURES);
+	}
+
+	return variantKey(p_lightCount, m_features);
+}
+
+uint64_t SimpleRenderSystem::variantKey(int p_lightCount, uint32_t p_features) {
+	// Light counts are rounded up to a power of two, so a handful of variants covers every scene
+	uint32_t lightBucket = 0;
+	if(p_lightCount > 0) {
+		lightBucket = 1;
+		while(lightBucket < static_cast<uint32_t>(p_lightCount)) {
+			lightBucket *= 2;
+		}
+	}
+
+	lightBucket = std::min<uint32_t>(lightBucket, MAX_LIGHTS);
+
+	return (static_cast<uint64_t>(lightBucket) << 32) | p_features;
+}
+
+void SimpleRenderSystem::configureVariant(uint64_t p_variantKey, PipelineConfigInfo& p_configInfo) {
+	int32_t maxLightCount = static_cast<int32_t>(p_variantKey >> 32);
+	VkBool32 specularEnabled = (p_variantKey & FEATURE_SPECULAR) != 0 ? VK_TRUE : VK_FALSE;
+
+	p_configInfo.addSpecializationConstant(MAX_LIGHT_COUNT_CONSTANT, maxLightCount);
+	p_configInfo.addSpecializationConstant(SPECULAR_ENABLED_CONSTANT, specularEnabled);
+	p_configInfo.addSpecializationConstant(SPECULAR_EXPONENT_CONSTANT, SPECULAR_EXPONENT);
+}
+
+void SimpleRenderSystem::createCullPipeline() {
+	m_cullPool = DescriptorPool::Builder(m_device)
+		.setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
+		.setMaxSets(MAX_CULLED_MODELS + SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_CULLED_MODELS + SwapChain::MAX_FRAMES_IN_FLIGHT)
+		.build();
+
+	m_meshletSetLayout = DescriptorSetLayout::Builder(m_device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.build();
 
-	vkCmdBindDescriptorSets(p_frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &p_frameInfo.globalDescriptorSet, 0, nullptr);
+	m_commandSetLayout = DescriptorSetLayout::Builder(m_device)
+		.addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+		.build();
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(CullPushConstantData);
+
+	FrameVector<VkDescriptorSetLayout> descriptorSetLayouts = {m_meshletSetLayout->getDescriptorSetLayout(), m_commandSetLayout->getDescriptorSetLayout()};
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = 1;
+	pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if(vkCreatePipelineLayout(m_device.device(), &pipelineLayoutInfo, nullptr, &m_cullPipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create pipeline layout!");
+	}
+
+	m_cullPipeline = m_device.pipelineBuilds().createComputePipeline(m_cullPipelineLayout, "shaders/meshlet_cull.comp.spv");
+
+	m_drawCommandBuffers.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+	m_drawCommandSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+}
+
+VkDescriptorSet SimpleRenderSystem::getMeshletSet(const std::shared_ptr<Model>& p_model) {
+	auto it = m_meshletSets.find(p_model);
+	if(it != m_meshletSets.end()) {
+		return it->second;
+	}
+
+	VkDescriptorBufferInfo bufferInfo = p_model->getMeshletBufferInfo();
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	if(!DescriptorWriter(*m_meshletSetLayout, *m_cullPool).writeBuffer(0, &bufferInfo).build(descriptorSet)) {
+		return VK_NULL_HANDLE;
+	}
+
+	m_meshletSets.emplace(p_model, descriptorSet);
+
+	return descriptorSet;
+}
+
+void SimpleRenderSystem::retireMeshletSets() {
+	m_frame++;
+
+	auto retired = std::stable_partition(m_retiredSets.begin(), m_retiredSets.end(), [this](const RetiredSet& p_retired) {
+		return p_retired.frame > m_frame;
+	});
+
+	if(retired != m_retiredSets.end()) {
+		std::vector<VkDescriptorSet> descriptorSets = {};
+		for(auto it = retired; it != m_retiredSets.end(); ++it) {
+			descriptorSets.push_back(it->descriptorSet);
+		}
+
+		m_cullPool->freeDescriptors(descriptorSets);
+		m_retiredSets.erase(retired, m_retiredSets.end());
+	}
+
+	// Frames still in flight may have bound the set of a model that is gone since
+	for(auto it = m_meshletSets.begin(); it != m_meshletSets.end();) {
+		if(!it->first.expired()) {
+			++it;
+			continue;
+		}
+
+		m_retiredSets.push_back({m_frame + SwapChain::MAX_FRAMES_IN_FLIGHT, it->second});
+		it = m_meshletSets.erase(it);
+	}
+}
+
+void SimpleRenderSystem::reserveDrawCommands(int p_frameIndex, uint32_t p_commandCount) {
+	std::unique_ptr<Buffer>& buffer = m_drawCommandBuffers[p_frameIndex];
+	if(buffer != nullptr && buffer->getInstanceCount() >= p_commandCount) {
+		return;
+	}
+
+	// The frame's fence has signalled, so its previous buffer is no longer read by the GPU
+	uint32_t capacity = std::max(CULL_GROUP_SIZE, buffer != nullptr ? buffer->getInstanceCount() : 0);
+	while(capacity < p_commandCount) {
+		capacity *= 2;
+	}
+
+	buffer = std::make_unique<Buffer>(m_device, sizeof(VkDrawIndexedIndirectCommand), capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+	VkDescriptorBufferInfo bufferInfo = buffer->descriptorInfo();
+	DescriptorWriter writer{*m_commandSetLayout, *m_cullPool};
+	writer.writeBuffer(0, &bufferInfo);
+
+	if(m_drawCommandSets[p_frameIndex] != VK_NULL_HANDLE) {
+		writer.overwrite(m_drawCommandSets[p_frameIndex]);
+	} else if(!writer.build(m_drawCommandSets[p_frameIndex])) {
+		throw std::runtime_error("failed to allocate draw command descriptor set!");
+	}
+}
+
+void SimpleRenderSystem::prepareFrame(FrameInfo& p_frameInfo) {
+	m_drawItems.clear();
+	retireMeshletSets();
+
+	// A model-space error e at distance d covers e * projection[1][1] / d of the NDC height, which spans 2 units
+	// Orthographic projections have no perspective divide, so the distance drops out
+	const glm::mat4& projection = p_frameInfo.camera.getProjection();
+	glm::mat4 viewProjection = projection * p_frameInfo.camera.getView();
+	glm::vec3 cameraPosition = glm::vec3(p_frameInfo.camera.getInverseView()[3]);
+	bool perspective = projection[3][3] == 0.0f;
+	float maxError = LOD_SCREEN_ERROR * std::exp2(m_lodBias);
+
+	uint32_t commandCount = 0;
 
 	for(auto& kv : p_frameInfo.gameObjects) {
 		GameObject& obj = kv.second;
 
-		if(obj.model == nullptr) {
+		// Streamed models are skipped until their upload has finished
+		if(obj.model == nullptr || !obj.model->isReady()) {
 			continue;
 		}
 
-		SimplePushConstantData push = {};
-		push.modelMatrix = obj.transform.mat4();
-		push.normalMatrix = obj.transform.normalMatrix();
+		float scale = std::max({std::abs(obj.transform.scale.x), std::abs(obj.transform.scale.y), std::abs(obj.transform.scale.z)});
+		float distance = perspective ? glm::length(obj.transform.translation - cameraPosition) : 1.0f;
+
+		DrawItem item = {};
+		item.object = &obj;
+
+		if(distance > 0.0f) {
+			item.lod = obj.model->selectLod(scale * std::abs(projection[1][1]) * 0.5f / distance, maxError);
+		}
+
+		// Meshlets only cover level 0, coarser levels are small on screen and drawn whole
+		if(item.lod == 0 && obj.model->hasMeshlets()) {
+			item.firstCommand = commandCount;
+			commandCount += obj.model->getMeshletCount();
+		}
+
+		m_drawItems.push_back(item);
+	}
 
-		vkCmdPushConstants(p_frameInfo.commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+	// Objects sharing a mesh pool block and index type are drawn back to back, so they are bound once
+	std::sort(m_drawItems.begin(), m_drawItems.end(), [](const DrawItem& p_a, const DrawItem& p_b) {
+		const MeshPool::Allocation& a = p_a.object->model->getMeshAllocation();
+		const MeshPool::Allocation& b = p_b.object->model->getMeshAllocation();
+
+		return a.block != b.block ? a.block < b.block : a.indexType < b.indexType;
+	});
+
+	if(commandCount == 0) {
+		return;
+	}
 
-		obj.model->bind(p_frameInfo.commandBuffer);
-		obj.model->draw(p_frameInfo.commandBuffer);
+	reserveDrawCommands(p_frameInfo.frameIndex, commandCount);
+
+	m_cullPipeline->bind(p_frameInfo.commandBuffer);
+	vkCmdBindDescriptorSets(p_frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 1, 1, &m_drawCommandSets[p_frameInfo.frameIndex], 0, nullptr);
+
+	for(DrawItem& item : m_drawItems) {
+		if(item.firstCommand == UINT32_MAX) {
+			continue;
+		}
+
+		VkDescriptorSet meshletSet = getMeshletSet(item.object->model);
+		if(meshletSet == VK_NULL_HANDLE) {
+			item.firstCommand = UINT32_MAX;
+			continue;
+		}
+
+		// Culling runs in model space, the positions the meshlet bounds were computed from
+		glm::mat4 modelMatrix = item.object->transform.mat4();
+
+		CullPushConstantData push = {};
+		push.modelViewProjection = viewProjection * modelMatrix;
+		push.cameraPosition = glm::inverse(modelMatrix) * glm::vec4(cameraPosition, 1.0f);
+		push.meshletCount = item.object->model->getMeshletCount();
+		push.commandOffset = item.firstCommand;
+		push.firstIndex = item.object->model->getMeshAllocation().firstIndex();
+		push.vertexOffset = static_cast<int32_t>(item.object->model->getMeshAllocation().vertexOffset);
+
+		vkCmdBindDescriptorSets(p_frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1, &meshletSet, 0, nullptr);
+		vkCmdPushConstants(p_frameInfo.commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstantData), &push);
+		vkCmdDispatch(p_frameInfo.commandBuffer, (push.meshletCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+	}
+
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+
+	vkCmdPipelineBarrier(p_frameInfo.commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void SimpleRenderSystem::renderGameObjects(FrameInfo& p_frameInfo) {
+	Buffer* drawCommands = m_drawCommandBuffers[p_frameInfo.frameIndex].get();
+
+	// The tightest variant for this frame's lights and features, built the first time it is needed
+	uint64_t variantKey = selectVariant(p_frameInfo.numLights);
+	Pipeline* meshPipeline = &m_pipelines->get(variantKey);
+	Pipeline* meshletPipeline = &m_meshletPipelines->get(variantKey);
+
+	// Whole-mesh draws first, then meshlet draws, so each pipeline is bound once
+	for(Pipeline* pipeline : {meshPipeline, meshletPipeline}) {
+		bool meshletPass = pipeline == meshletPipeline;
+		bool bound = false;
+		const MeshPool::Allocation* boundMesh = nullptr;
+
+		for(const DrawItem& item : m_drawItems) {
+			if((item.firstCommand != UINT32_MAX) != meshletPass) {
+				continue;
+			}
+
+			if(!bound) {
+				pipeline->bind(p_frameInfo.commandBuffer);
+				vkCmdBindDescriptorSets(p_frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &p_frameInfo.globalDescriptorSet, 1, &p_frameInfo.globalUniformOffset);
+				bound = true;
+			}
+
+			GameObject& obj = *item.object;
+
+			SimplePushConstantData push = {};
+			push.modelMatrix = obj.transform.mat4() * obj.model->getPositionTransform();
+			push.normalMatrix = obj.transform.normalMatrix();
+
+			vkCmdPushConstants(p_frameInfo.commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantData), &push);
+
+			const MeshPool::Allocation& mesh = obj.model->getMeshAllocation();
+			if(boundMesh == nullptr || !MeshPool::sharesBinding(*boundMesh, mesh)) {
+				obj.model->bind(p_frameInfo.commandBuffer);
+				boundMesh = &mesh;
+			}
+
+			if(!meshletPass) {
+				obj.model->draw(p_frameInfo.commandBuffer, item.lod);
+				continue;
+			}
+
+			uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+			VkDeviceSize offset = static_cast<VkDeviceSize>(item.firstCommand) * stride;
+			uint32_t meshletCount = obj.model->getMeshletCount();
+
+			if(m_device.supportsMultiDrawIndirect()) {
+				vkCmdDrawIndexedIndirect(p_frameInfo.commandBuffer, drawCommands->getBuffer(), offset, meshletCount, stride);
+			} else {
+				for(uint32_t i = 0; i < meshletCount; i++) {
+					vkCmdDrawIndexedIndirect(p_frameInfo.commandBuffer, drawCommands->getBuffer(), offset + i * stride, 1, stride);
+				}
+			}
+		}
 	}
 }
 
@@ -0,0 +1,129 @@
+#include "ThreadPool.hpp"
+
+// STD
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace FFL {
+
+ThreadPool::ThreadPool(uint32_t p_threadCount) {
+	p_threadCount = std::max(p_threadCount, 1u);
+
+	m_threads.reserve(p_threadCount);
+	for(uint32_t i = 0; i < p_threadCount; i++) {
+		m_threads.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_stopping = true;
+	}
+
+	m_condition.notify_all();
+
+	for(std::thread& thread : m_threads) {
+		thread.join();
+	}
+}
+
+ThreadPool& ThreadPool::shared() {
+	static ThreadPool pool{};
+	return pool;
+}
+
+uint32_t ThreadPool::defaultThreadCount() {
+	return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void ThreadPool::enqueue(std::function<void()> p_task) {
+	{
+		std::lock_guard<std::mutex> lock{m_mutex};
+		m_tasks.push_back(std::move(p_task));
+	}
+
+	m_condition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+	while(true) {
+		std::function<void()> task;
+
+		{
+			std::unique_lock<std::mutex> lock{m_mutex};
+			m_condition.wait(lock, [this]() {return m_stopping || !m_tasks.empty();});
+
+			if(m_stopping && m_tasks.empty()) {
+				return;
+			}
+
+			task = std::move(m_tasks.front());
+			m_tasks.pop_front();
+		}
+
+		task();
+	}
+}
+
+void ThreadPool::parallelFor(size_t p_count, const std::function<void(size_t)>& p_body) {
+	if(p_count == 0) {
+		return;
+	}
+
+	if(p_count == 1) {
+		p_body(0);
+		return;
+	}
+
+	// Shared so helpers that only get scheduled after the loop finished still see valid state
+	struct State {
+		std::atomic<size_t> next{0};
+		std::atomic<size_t> done{0};
+		size_t count = 0;
+		const std::function<void(size_t)>* body = nullptr;
+		std::exception_ptr error = nullptr;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+
+	std::shared_ptr<State> state = std::make_shared<State>();
+	state->count = p_count;
+	state->body = &p_body;
+
+	auto work = [](State& p_state) {
+		size_t i;
+		while((i = p_state.next.fetch_add(1)) < p_state.count) {
+			try {
+				(*p_state.body)(i);
+			} catch(...) {
+				std::lock_guard<std::mutex> lock{p_state.mutex};
+				if(!p_state.error) {
+					p_state.error = std::current_exception();
+				}
+			}
+
+			if(p_state.done.fetch_add(1) + 1 == p_state.count) {
+				std::lock_guard<std::mutex> lock{p_state.mutex};
+				p_state.finished.notify_all();
+			}
+		}
+	};
+
+	size_t helperCount = std::min(p_count - 1, m_threads.size());
+	for(size_t i = 0; i < helperCount; i++) {
+		enqueue([state, work]() {work(*state);});
+	}
+
+	work(*state);
+
+	std::unique_lock<std::mutex> lock{state->mutex};
+	state->finished.wait(lock, [&state]() {return state->done.load() == state->count;});
+
+	if(state->error) {
+		std::rethrow_exception(state->error);
+	}
+}
+
+} // FFL
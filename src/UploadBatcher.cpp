@@ -0,0 +1,216 @@
+#include "UploadBatcher.hpp"
+#include "Device.hpp"
+
+// Libraries
+#include <vulkan/vulkan_core.h>
+
+// STD
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+namespace FFL {
+
+static VkDeviceSize alignUp(VkDeviceSize p_offset, VkDeviceSize p_alignment) {
+	return (p_offset + p_alignment - 1) & ~(p_alignment - 1);
+}
+
+UploadBatcher::UploadBatcher(Device& p_device, VkDeviceSize p_ringSize) : m_device{p_device}, m_ringSize{alignUp(p_ringSize, STAGING_ALIGNMENT)} {
+	m_ring = std::make_unique<Buffer>(m_device, 1, static_cast<uint32_t>(m_ringSize), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+	m_ring->map();
+	m_ringMemory = static_cast<uint8_t*>(m_ring->getMappedMemory());
+}
+
+UploadBatcher::~UploadBatcher() {
+	flush();
+}
+
+VkCommandBuffer UploadBatcher::recordingCommandBuffer() {
+	if(m_recording.commandBuffer == VK_NULL_HANDLE) {
+		m_recording.commandBuffer = m_device.beginSingleTimeCommands();
+	}
+
+	return m_recording.commandBuffer;
+}
+
+bool UploadBatcher::tryAllocate(VkDeviceSize p_size, VkDeviceSize& p_offset) {
+	if(m_used == 0) {
+		m_head = 0;
+	}
+
+	// The free space starts at m_head and wraps around, an allocation that does not fit before the end skips it
+	VkDeviceSize start = alignUp(m_head, STAGING_ALIGNMENT);
+	if(start + p_size > m_ringSize) {
+		start = 0;
+	}
+
+	VkDeviceSize padding = start >= m_head ? start - m_head : m_ringSize - m_head;
+	if(padding + p_size > m_ringSize - m_used) {
+		return false;
+	}
+
+	p_offset = start;
+	m_head = start + p_size;
+	m_used += padding + p_size;
+	m_recording.ringBytes += padding + p_size;
+
+	return true;
+}
+
+VkBuffer UploadBatcher::allocate(VkDeviceSize p_size, VkDeviceSize& p_offset, void*& p_memory) {
+	if(p_size > m_ringSize) {
+		std::unique_ptr<Buffer>& buffer = m_recording.dedicatedBuffers.emplace_back(std::make_unique<Buffer>(m_device, p_size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT));
+		buffer->map();
+
+		p_offset = 0;
+		p_memory = buffer->getMappedMemory();
+
+		return buffer->getBuffer();
+	}
+
+	while(!tryAllocate(p_size, p_offset)) {
+		if(m_inFlight.empty()) {
+			submit();
+		} else {
+			retire(true);
+		}
+	}
+
+	p_memory = m_ringMemory + p_offset;
+
+	return m_ring->getBuffer();
+}
+
+void* UploadBatcher::stageBuffer(VkBuffer p_dst, VkDeviceSize p_size, VkDeviceSize p_dstOffset) {
+	VkDeviceSize offset = 0;
+	void* memory = nullptr;
+	VkBuffer staging = allocate(p_size, offset, memory);
+
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = offset;
+	copyRegion.dstOffset = p_dstOffset;
+	copyRegion.size = p_size;
+	vkCmdCopyBuffer(recordingCommandBuffer(), staging, p_dst, 1, &copyRegion);
+
+	return memory;
+}
+
+void* UploadBatcher::stageImage(VkImage p_image, uint32_t p_w, uint32_t p_h, uint32_t p_layerCount, VkDeviceSize p_size) {
+	VkDeviceSize offset = 0;
+	void* memory = nullptr;
+	VkBuffer staging = allocate(p_size, offset, memory);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = offset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = p_layerCount;
+
+	region.imageOffset = {0, 0, 0};
+	region.imageExtent = {p_w, p_h, 1};
+
+	vkCmdCopyBufferToImage(recordingCommandBuffer(), staging, p_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	return memory;
+}
+
+void UploadBatcher::uploadBuffer(VkBuffer p_dst, const void* p_data, VkDeviceSize p_size, VkDeviceSize p_dstOffset) {
+	memcpy(stageBuffer(p_dst, p_size, p_dstOffset), p_data, p_size);
+}
+
+void UploadBatcher::copyBuffer(VkBuffer p_src, VkBuffer p_dst, VkDeviceSize p_size) {
+	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = 0; // Optional
+	copyRegion.dstOffset = 0; // Optional
+	copyRegion.size = p_size;
+	vkCmdCopyBuffer(recordingCommandBuffer(), p_src, p_dst, 1, &copyRegion);
+}
+
+void UploadBatcher::copyBufferToImage(VkBuffer p_buffer, VkImage p_image, uint32_t p_w, uint32_t p_h, uint32_t p_layerCount) {
+	VkBufferImageCopy region = {};
+	region.bufferOffset = 0;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = p_layerCount;
+
+	region.imageOffset = {0, 0, 0};
+	region.imageExtent = {p_w, p_h, 1};
+
+	vkCmdCopyBufferToImage(recordingCommandBuffer(), p_buffer, p_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+}
+
+uint64_t UploadBatcher::submit() {
+	if(m_recording.commandBuffer == VK_NULL_HANDLE) {
+		return 0;
+	}
+
+	// Later submissions to the queue read the copied data in whatever stage, so make it visible to all of them
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	vkCmdPipelineBarrier(m_recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	m_recording.ticket = m_nextTicket++;
+	m_recording.fence = m_device.submitSingleTimeCommands(m_recording.commandBuffer);
+
+	uint64_t ticket = m_recording.ticket;
+	m_inFlight.push_back(std::move(m_recording));
+	m_recording = {};
+
+	return ticket;
+}
+
+bool UploadBatcher::isComplete(uint64_t p_ticket) {
+	retire(false);
+
+	return p_ticket <= m_completedTicket;
+}
+
+void UploadBatcher::wait(uint64_t p_ticket) {
+	assert(p_ticket < m_nextTicket && "Ticket has not been submitted");
+
+	while(m_completedTicket < p_ticket && !m_inFlight.empty()) {
+		retire(true);
+	}
+}
+
+void UploadBatcher::flush() {
+	submit();
+
+	while(!m_inFlight.empty()) {
+		retire(true);
+	}
+}
+
+void UploadBatcher::retire(bool p_waitOldest) {
+	bool wait = p_waitOldest;
+
+	// Batches execute in submission order, so the ring is freed from its oldest allocation onwards
+	while(!m_inFlight.empty()) {
+		Batch& batch = m_inFlight.front();
+
+		if(!wait && vkGetFenceStatus(m_device.device(), batch.fence) != VK_SUCCESS) {
+			break;
+		}
+
+		m_device.releaseSingleTimeCommands(batch.commandBuffer, batch.fence);
+
+		m_used -= batch.ringBytes;
+		m_completedTicket = batch.ticket;
+		m_inFlight.pop_front();
+
+		wait = false;
+	}
+}
+
+} // FFL
@@ -0,0 +1,173 @@
+#include "MeshCodec.hpp"
+
+// STD
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static int g_failures = 0;
+
+static void check(bool p_condition, const std::string& p_message) {
+	if(!p_condition) {
+		std::cerr << "FAILED: " << p_message << '\n';
+		g_failures++;
+	}
+}
+
+// Smooth streams are what the codec is built for, random bytes force the widest groups
+static std::vector<uint8_t> makeVertices(size_t p_vertexCount, size_t p_vertexSize, bool p_smooth, std::mt19937& p_random) {
+	std::vector<uint8_t> vertices(p_vertexCount * p_vertexSize);
+	std::uniform_int_distribution<int> byte{0, 255};
+	std::uniform_int_distribution<int> step{-3, 3};
+
+	for(size_t i = 0; i < vertices.size(); i++) {
+		if(p_smooth && i >= p_vertexSize) {
+			vertices[i] = static_cast<uint8_t>(vertices[i - p_vertexSize] + step(p_random));
+		} else {
+			vertices[i] = static_cast<uint8_t>(byte(p_random));
+		}
+	}
+
+	return vertices;
+}
+
+// Every strict prefix of a stream is truncated and has to be rejected, decoding from an exactly sized copy lets
+// sanitizers catch reads past the end
+template<typename Decode>
+static void checkTruncated(const std::vector<uint8_t>& p_encoded, const Decode& p_decode, const std::string& p_name) {
+	size_t step = std::max<size_t>(1, p_encoded.size() / 64);
+
+	for(size_t size = 0; size < p_encoded.size(); size += size + step < p_encoded.size() ? step : 1) {
+		std::vector<uint8_t> truncated(p_encoded.begin(), p_encoded.begin() + size);
+		check(!p_decode(truncated.data(), truncated.size()), p_name + " accepted a stream truncated to " + std::to_string(size) + " bytes");
+	}
+}
+
+static void testVertices(std::mt19937& p_random) {
+	const size_t counts[] = {0, 1, 2, 15, 16, 17, 255, 256, 257, 1000, 4099};
+
+	for(size_t vertexSize = 4; vertexSize <= 48; vertexSize++) {
+		for(size_t vertexCount : counts) {
+			for(bool smooth : {false, true}) {
+				std::string name = "vertices size " + std::to_string(vertexSize) + " count " + std::to_string(vertexCount) + (smooth ? " smooth" : " random");
+
+				std::vector<uint8_t> vertices = makeVertices(vertexCount, vertexSize, smooth, p_random);
+				std::vector<uint8_t> encoded = FFL::MeshCodec::encodeVertices(vertices.data(), vertexCount, vertexSize);
+
+				std::vector<uint8_t> decoded(vertices.size());
+				check(FFL::MeshCodec::decodeVertices(decoded.data(), vertexCount, vertexSize, encoded.data(), encoded.size()), name + " failed to decode");
+				check(decoded == vertices, name + " did not round-trip");
+
+				// Truncation is checked on a subset, every prefix of every stream would take minutes
+				if(vertexSize % 12 == 4 && (vertexCount == 17 || vertexCount == 257)) {
+					checkTruncated(encoded, [&](const uint8_t* p_data, size_t p_size) {
+						return FFL::MeshCodec::decodeVertices(decoded.data(), vertexCount, vertexSize, p_data, p_size);
+					}, name);
+				}
+			}
+		}
+	}
+}
+
+static void testIndices(std::mt19937& p_random) {
+	const size_t triangleCounts[] = {0, 1, 2, 100, 1365};
+
+	for(size_t triangleCount : triangleCounts) {
+		for(uint32_t vertexCount : {3u, 1000u, 1u << 20}) {
+			std::string name = "indices triangles " + std::to_string(triangleCount) + " vertices " + std::to_string(vertexCount);
+
+			std::uniform_int_distribution<uint32_t> index{0, vertexCount - 1};
+			std::vector<uint32_t> indices(triangleCount * 3);
+			for(uint32_t& value : indices) {
+				value = index(p_random);
+			}
+
+			std::vector<uint8_t> encoded = FFL::MeshCodec::encodeIndices(indices.data(), indices.size());
+
+			std::vector<uint32_t> decoded(indices.size());
+			check(FFL::MeshCodec::decodeIndices(decoded.data(), decoded.size(), encoded.data(), encoded.size()), name + " failed to decode");
+
+			// Triangles may come back rotated, which keeps the winding
+			bool matches = true;
+			for(size_t i = 0; i < indices.size(); i += 3) {
+				bool rotated = false;
+				for(size_t r = 0; r < 3; r++) {
+					rotated |= decoded[i] == indices[i + r] && decoded[i + 1] == indices[i + (r + 1) % 3] && decoded[i + 2] == indices[i + (r + 2) % 3];
+				}
+
+				matches &= rotated;
+			}
+
+			check(matches, name + " did not round-trip");
+
+			checkTruncated(encoded, [&](const uint8_t* p_data, size_t p_size) {
+				return FFL::MeshCodec::decodeIndices(decoded.data(), decoded.size(), p_data, p_size);
+			}, name);
+		}
+	}
+
+	uint32_t indices[3] = {0, 1, 2};
+	check(!FFL::MeshCodec::decodeIndices(indices, 2, nullptr, 0), "indices accepted a count that is not a multiple of 3");
+}
+
+// Garbage has to be rejected or decoded into something, but never read or write out of bounds
+static void testCorrupt(std::mt19937& p_random) {
+	std::uniform_int_distribution<int> byte{0, 255};
+
+	std::vector<uint8_t> vertices = makeVertices(300, 20, true, p_random);
+	std::vector<uint8_t> encoded = FFL::MeshCodec::encodeVertices(vertices.data(), 300, 20);
+	std::vector<uint8_t> decoded(vertices.size());
+
+	for(int i = 0; i < 1000; i++) {
+		std::vector<uint8_t> corrupt = encoded;
+		corrupt[std::uniform_int_distribution<size_t>{0, corrupt.size() - 1}(p_random)] = static_cast<uint8_t>(byte(p_random));
+
+		FFL::MeshCodec::decodeVertices(decoded.data(), 300, 20, corrupt.data(), corrupt.size());
+	}
+
+	std::vector<uint32_t> indices = {0, 1, 2, 2, 1, 3, 3, 4, 5};
+	std::vector<uint8_t> encodedIndices = FFL::MeshCodec::encodeIndices(indices.data(), indices.size());
+	std::vector<uint32_t> decodedIndices(indices.size());
+
+	for(int i = 0; i < 1000; i++) {
+		std::vector<uint8_t> corrupt = encodedIndices;
+		corrupt[std::uniform_int_distribution<size_t>{0, corrupt.size() - 1}(p_random)] = static_cast<uint8_t>(byte(p_random));
+
+		FFL::MeshCodec::decodeIndices(decodedIndices.data(), decodedIndices.size(), corrupt.data(), corrupt.size());
+	}
+
+	// An index past the triangle's largest one cannot come from the encoder
+	std::vector<uint8_t> invalid = {0, 1, 0};
+	check(!FFL::MeshCodec::decodeIndices(decodedIndices.data(), 3, invalid.data(), invalid.size()), "indices accepted an offset larger than the first index");
+
+	// Trailing bytes mean the stream belongs to a different mesh
+	encodedIndices.push_back(0);
+	check(!FFL::MeshCodec::decodeIndices(decodedIndices.data(), decodedIndices.size(), encodedIndices.data(), encodedIndices.size()), "indices accepted trailing bytes");
+
+	encoded.push_back(0);
+	check(!FFL::MeshCodec::decodeVertices(decoded.data(), 300, 20, encoded.data(), encoded.size()), "vertices accepted trailing bytes");
+}
+
+// Round-trips vertex and index streams of many shapes through MeshCodec and feeds it truncated and corrupt data
+// Exits with a failure when anything does not match, run by ctest
+int main() {
+	std::mt19937 random{42};
+
+	testVertices(random);
+	testIndices(random);
+	testCorrupt(random);
+
+	if(g_failures > 0) {
+		std::cerr << g_failures << " checks failed" << '\n';
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "All MeshCodec checks passed" << '\n';
+
+	return EXIT_SUCCESS;
+}
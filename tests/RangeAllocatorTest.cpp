@@ -0,0 +1,151 @@
+#include "RangeAllocator.hpp"
+
+// STD
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+static int g_failures = 0;
+
+static void check(bool p_condition, const std::string& p_message) {
+	if(!p_condition) {
+		std::cerr << "FAILED: " << p_message << '\n';
+		g_failures++;
+	}
+}
+
+struct Allocation {
+	uint64_t offset = 0;
+	uint64_t size = 0;
+};
+
+// Mirrors the allocator with one flag per unit and compares the two after every operation
+class Reference {
+public:
+	explicit Reference(uint64_t p_capacity) : m_used(p_capacity, 0) {}
+
+	void mark(uint64_t p_offset, uint64_t p_size, bool p_used) {
+		for(uint64_t i = p_offset; i < p_offset + p_size; i++) {
+			m_used[i] = p_used ? 1 : 0;
+		}
+	}
+
+	// Lowest aligned offset with p_size free units after it, which is what first fit over coalesced ranges finds
+	uint64_t firstFit(uint64_t p_size, uint64_t p_alignment) const {
+		uint64_t freeRun = 0;
+
+		for(uint64_t i = 0; i < m_used.size(); i++) {
+			freeRun = m_used[i] ? 0 : freeRun + 1;
+
+			uint64_t offset = i + 1 - freeRun;
+			uint64_t aligned = (offset + p_alignment - 1) & ~(p_alignment - 1);
+			if(freeRun > 0 && aligned + p_size == i + 1) {
+				return aligned;
+			}
+		}
+
+		return FFL::RangeAllocator::INVALID_OFFSET;
+	}
+
+	void compare(const FFL::RangeAllocator& p_allocator, const std::string& p_step) const {
+		uint64_t freeSize = 0;
+		uint64_t largest = 0;
+		size_t rangeCount = 0;
+
+		for(uint64_t i = 0; i < m_used.size();) {
+			if(m_used[i]) {
+				i++;
+				continue;
+			}
+
+			uint64_t start = i;
+			while(i < m_used.size() && !m_used[i]) {
+				i++;
+			}
+
+			freeSize += i - start;
+			largest = std::max(largest, i - start);
+			rangeCount++;
+		}
+
+		check(p_allocator.freeSize() == freeSize, p_step + ": freeSize " + std::to_string(p_allocator.freeSize()) + ", expected " + std::to_string(freeSize));
+		check(p_allocator.largestFreeRange() == largest, p_step + ": largestFreeRange " + std::to_string(p_allocator.largestFreeRange()) + ", expected " + std::to_string(largest));
+		// Adjacent free ranges that were not merged show up as extra ranges
+		check(p_allocator.freeRangeCount() == rangeCount, p_step + ": " + std::to_string(p_allocator.freeRangeCount()) + " free ranges, expected " + std::to_string(rangeCount));
+	}
+private:
+	std::vector<uint8_t> m_used;
+};
+
+// Drives RangeAllocator with random allocations and frees of random sizes and alignments and checks it against a
+// unit-by-unit model: first-fit placement, freeSize(), largestFreeRange() and that free neighbours coalesce
+// Exits with a failure when anything does not match, run by ctest
+int main() {
+	static constexpr uint64_t CAPACITY = 2048;
+	static constexpr int OPERATIONS = 50000;
+
+	std::mt19937 random{7};
+	std::uniform_int_distribution<int> action{0, 99};
+	std::uniform_int_distribution<uint64_t> smallSize{1, 16};
+	std::uniform_int_distribution<uint64_t> largeSize{1, 256};
+	std::uniform_int_distribution<int> alignmentShift{0, 6};
+
+	FFL::RangeAllocator allocator{CAPACITY};
+	Reference reference{CAPACITY};
+	std::vector<Allocation> allocations = {};
+
+	check(allocator.allocate(0) == FFL::RangeAllocator::INVALID_OFFSET, "zero-sized allocation succeeded");
+	check(allocator.allocate(CAPACITY + 1) == FFL::RangeAllocator::INVALID_OFFSET, "allocation larger than the capacity succeeded");
+
+	for(int i = 0; i < OPERATIONS && g_failures == 0; i++) {
+		std::string step = "operation " + std::to_string(i);
+
+		// Slightly more allocations than frees, so the allocator fills up and fragments
+		if(allocations.empty() || action(random) < 55) {
+			uint64_t size = action(random) < 80 ? smallSize(random) : largeSize(random);
+			uint64_t alignment = uint64_t{1} << alignmentShift(random);
+
+			uint64_t expected = reference.firstFit(size, alignment);
+			uint64_t offset = allocator.allocate(size, alignment);
+
+			check(offset == expected, step + ": allocate(" + std::to_string(size) + ", " + std::to_string(alignment) + ") returned " + std::to_string(offset) + ", expected " + std::to_string(expected));
+
+			if(offset != FFL::RangeAllocator::INVALID_OFFSET && offset == expected) {
+				reference.mark(offset, size, true);
+				allocations.push_back({offset, size});
+			}
+		} else {
+			size_t index = std::uniform_int_distribution<size_t>{0, allocations.size() - 1}(random);
+			Allocation allocation = allocations[index];
+			allocations[index] = allocations.back();
+			allocations.pop_back();
+
+			allocator.free(allocation.offset, allocation.size);
+			reference.mark(allocation.offset, allocation.size, false);
+		}
+
+		reference.compare(allocator, step);
+	}
+
+	// Everything coalesces back into the one range the allocator started with
+	for(const Allocation& allocation : allocations) {
+		allocator.free(allocation.offset, allocation.size);
+		reference.mark(allocation.offset, allocation.size, false);
+	}
+
+	reference.compare(allocator, "after freeing everything");
+	check(allocator.freeRangeCount() == 1 && allocator.largestFreeRange() == CAPACITY, "freeing everything did not coalesce into a single range");
+
+	if(g_failures > 0) {
+		std::cerr << g_failures << " checks failed" << '\n';
+		return EXIT_FAILURE;
+	}
+
+	std::cout << "All RangeAllocator checks passed" << '\n';
+
+	return EXIT_SUCCESS;
+}
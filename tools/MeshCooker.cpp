@@ -0,0 +1,78 @@
+#include "MeshCache.hpp"
+#include "Model.hpp"
+
+// STD
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// Cooks OBJ files into binary mesh caches so the engine never parses them at startup
+// The options must match the Model::Builder::Options the engine loads with, otherwise it rejects the cache
+// --compress is the exception, it trades the engine's zero-copy mapping for smaller files and loads either way
+// Usage: MeshCooker [--no-optimize] [--overdraw] [--lods <count>] [--no-meshlets] [--compress] <model.obj>...
+int main(int argc, char** argv) {
+	FFL::Model::Builder::Options options = {};
+	int firstPath = 1;
+
+	for(; firstPath < argc && argv[firstPath][0] == '-'; firstPath++) {
+		std::string option = argv[firstPath];
+
+		if(option == "--no-optimize") {
+			options.optimizeVertexCache = false;
+			options.optimizeOverdraw = false;
+		} else if(option == "--overdraw") {
+			options.optimizeOverdraw = true;
+		} else if(option == "--lods" && firstPath + 1 < argc) {
+			options.lodCount = static_cast<uint32_t>(std::max(1, std::atoi(argv[++firstPath])));
+		} else if(option == "--no-meshlets") {
+			options.buildMeshlets = false;
+		} else if(option == "--compress") {
+			options.compressCache = true;
+		} else {
+			std::cerr << "Unknown option: " << option << '\n';
+			return EXIT_FAILURE;
+		}
+	}
+
+	if(firstPath >= argc) {
+		std::cerr << "Usage: " << argv[0] << " [--no-optimize] [--overdraw] [--lods <count>] [--no-meshlets] [--compress] <model.obj>..." << '\n';
+		return EXIT_FAILURE;
+	}
+
+	int result = EXIT_SUCCESS;
+
+	for(int i = firstPath; i < argc; i++) {
+		std::string sourcePath = argv[i];
+		std::string cachePath = FFL::MeshCache::cachePathFor(sourcePath);
+
+		try {
+			FFL::Model::Builder builder = {};
+			builder.options = options;
+			builder.loadObj(sourcePath);
+			builder.generateLods();
+
+			if(options.optimizeVertexCache || options.optimizeOverdraw) {
+				FFL::Model::Builder::OptimizationReport report = builder.optimize();
+
+				std::cout << sourcePath << ": ACMR " << report.before.acmr << " -> " << report.after.acmr << ", ATVR " << report.before.atvr << " -> " << report.after.atvr << '\n';
+			}
+
+			builder.buildMeshlets();
+
+			FFL::MeshCache::write(cachePath, sourcePath, builder);
+
+			std::cout << sourcePath << " -> " << cachePath << " (" << builder.vertexCount() << " vertices, " << builder.indexCount() << " indices, " << builder.meshletCount() << " meshlets)" << '\n';
+
+			for(uint32_t lod = 0; lod < builder.lodCount(); lod++) {
+				std::cout << "  LOD " << lod << ": " << builder.lodData()[lod].indexCount / 3 << " triangles, error " << builder.lodData()[lod].error << '\n';
+			}
+		} catch(const std::exception& e) {
+			std::cerr << sourcePath << ": " << e.what() << '\n';
+			result = EXIT_FAILURE;
+		}
+	}
+
+	return result;
+}